@@ -0,0 +1,120 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _BOILERPLATE_HISTOGRAM_H
+#define _BOILERPLATE_HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * Log-linear histogram of signed 64bit samples, in the spirit of
+ * HdrHistogram. Each power-of-two range of magnitudes is split into
+ * 2^(precision - 1) cells, so that any recorded value can be
+ * retrieved with a relative error below 2^-(precision - 1), over a
+ * range of values set at init time. Recording a sample is a
+ * constant-time operation which neither allocates memory nor
+ * issues any syscall, which makes it usable from a real-time
+ * context.
+ */
+struct histogram {
+	unsigned int sub_bits;
+	unsigned int nr_cells;
+	uint64_t *pos_cells;
+	uint64_t *neg_cells;
+	uint64_t count;
+	uint64_t overflows;
+	int64_t min;
+	int64_t max;
+	double sum;
+	double sumsq;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int histogram_init(struct histogram *h,
+		   uint64_t max_value, unsigned int precision);
+
+void histogram_destroy(struct histogram *h);
+
+void histogram_reset(struct histogram *h);
+
+int histogram_merge(struct histogram *dst,
+		    const struct histogram *src);
+
+int64_t histogram_percentile(const struct histogram *h, double pct);
+
+double histogram_mean(const struct histogram *h);
+
+double histogram_stddev(const struct histogram *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline unsigned int
+__histogram_index(const struct histogram *h, uint64_t v)
+{
+	unsigned int e;
+
+	if (v < (1ULL << h->sub_bits))
+		return (unsigned int)v;
+
+	e = 64 - __builtin_clzll(v) - h->sub_bits;
+
+	return (e << (h->sub_bits - 1)) + (unsigned int)(v >> e);
+}
+
+static inline void histogram_add_n(struct histogram *h,
+				   int64_t v, uint64_t n)
+{
+	uint64_t *cells = h->pos_cells, mag = v;
+	unsigned int idx;
+
+	if (n == 0 || h->nr_cells == 0)
+		return;
+
+	if (v < 0) {
+		cells = h->neg_cells;
+		mag = -(uint64_t)v;
+	}
+
+	idx = __histogram_index(h, mag);
+	if (idx >= h->nr_cells) {
+		idx = h->nr_cells - 1;
+		h->overflows += n;
+	}
+
+	cells[idx] += n;
+
+	if (h->count == 0)
+		h->min = h->max = v;
+	else if (v < h->min)
+		h->min = v;
+	else if (v > h->max)
+		h->max = v;
+
+	h->count += n;
+	h->sum += (double)v * n;
+	h->sumsq += (double)v * v * n;
+}
+
+static inline void histogram_add(struct histogram *h, int64_t v)
+{
+	histogram_add_n(h, v, 1);
+}
+
+#endif /* _BOILERPLATE_HISTOGRAM_H */
@@ -37,6 +37,8 @@
 #define XNPIPE_USER_WSYNC        0x40
 #define XNPIPE_USER_WSYNC_READY  0x80
 #define XNPIPE_USER_LCONN        0x100
+#define XNPIPE_USER_ZCOPY        0x200
+#define XNPIPE_USER_FRAMED       0x400
 
 #define XNPIPE_USER_ALL_WAIT \
 (XNPIPE_USER_WREAD|XNPIPE_USER_WSYNC)
@@ -69,9 +71,13 @@ struct xnpipe_state {
 	int nrinq;
 	struct list_head outq;		/* From kernel to user-space */
 	int nroutq;
+	struct list_head zcq;		/* Lent to user-space (zero-copy) */
+	int nrzcq;
 	struct xnsynch synchbase;
 	struct xnpipe_operations ops;
 	void *xstate;		/* Extra state managed by caller */
+	void *shmbase;		/* Memory shared with user-space */
+	size_t shmsize;
 
 	/* Linux kernel part */
 	unsigned long status;
@@ -80,6 +86,7 @@ struct xnpipe_state {
 	wait_queue_head_t syncq;	/* sync waiters */
 	int wcount;			/* number of waiters on this minor */
 	size_t ionrd;
+	size_t wmark;			/* reader wakeup threshold */
 };
 
 extern struct xnpipe_state xnpipe_states[];
@@ -111,6 +118,8 @@ ssize_t xnpipe_recv(int minor,
 
 int xnpipe_flush(int minor, int mode);
 
+int xnpipe_share(int minor, void *base, size_t size);
+
 int xnpipe_pollstate(int minor, unsigned int *mask_r);
 
 static inline unsigned int __xnpipe_pollstate(int minor)
@@ -124,6 +133,11 @@ static inline unsigned int __xnpipe_pollstate(int minor)
 	return mask;
 }
 
+static inline int xnpipe_zcopy_p(int minor)
+{
+	return (xnpipe_states[minor].status & XNPIPE_USER_ZCOPY) != 0;
+}
+
 static inline char *xnpipe_m_data(struct xnpipe_mh *mh)
 {
 	return (char *)(mh + 1);
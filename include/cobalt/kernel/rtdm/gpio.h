@@ -25,6 +25,7 @@
 struct class;
 struct device_node;
 struct gpio_desc;
+struct rtdm_gpio_chan;
 
 struct rtdm_gpio_pin {
 	struct rtdm_device dev;
@@ -33,6 +34,18 @@ struct rtdm_gpio_pin {
 	rtdm_event_t event;
 	char *name;
 	struct gpio_desc *desc;
+	/* # of fds driving the pin as an output. */
+	unsigned int nr_outputs;
+	/* Interrupt event ring, owned by the fd which set it up. */
+	rtdm_lock_t ev_lock;
+	atomic_t ev_readers;
+	struct rtdm_gpio_chan *ev_owner;
+	struct rtdm_gpio_event *events;
+	unsigned int ev_mask;
+	unsigned int ev_head;
+	unsigned int ev_tail;
+	unsigned int ev_seq;
+	unsigned int ev_overruns;
 };
 
 struct rtdm_gpio_chip {
@@ -41,6 +54,10 @@ struct rtdm_gpio_chip {
 	struct class *devclass;
 	struct list_head next;
 	rtdm_lock_t lock;
+	/* Bank device, for multi-pin accesses. */
+	struct rtdm_driver bank_driver;
+	struct rtdm_device bank_dev;
+	unsigned long *outputs;
 	struct rtdm_gpio_pin pins[0];
 };
 
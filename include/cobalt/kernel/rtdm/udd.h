@@ -318,6 +318,13 @@ struct udd_device {
 		} mapdev[UDD_NR_MAPS];
 		char *mapper_name;
 		int nr_maps;
+		rtdm_lock_t lock;
+		struct udd_irqstat *irqstat;
+		atomic_t notified;
+		u32 pending;
+		u32 coalesce_count;
+		nanosecs_rel_t coalesce_delay;
+		rtdm_timer_t coalesce_timer;
 	} __reserved;
 };
 
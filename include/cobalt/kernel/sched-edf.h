@@ -0,0 +1,99 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#ifndef _COBALT_KERNEL_SCHED_EDF_H
+#define _COBALT_KERNEL_SCHED_EDF_H
+
+#ifndef _COBALT_KERNEL_SCHED_H
+#error "please don't include cobalt/kernel/sched-edf.h directly"
+#endif
+
+/**
+ * @addtogroup cobalt_core_sched
+ * @{
+ */
+
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+
+/*
+ * All EDF threads share a single priority level within the class,
+ * the runqueue being ordered by absolute deadlines instead.
+ */
+#define XNSCHED_EDF_PRIO	0
+
+/* Fixed-point scale of bandwidth values (runtime / period). */
+#define XNSCHED_EDF_BW_SHIFT	20
+#define XNSCHED_EDF_BW_UNIT	(1UL << XNSCHED_EDF_BW_SHIFT)
+
+extern struct xnsched_class xnsched_class_edf;
+
+struct xnsched_edf_data {
+	struct xnthread *thread;
+	/** CPU slot the bandwidth is reserved on. */
+	struct xnsched *sched;
+	struct xnsched_edf_param param;
+	/** Reserved bandwidth, i.e. runtime / period. */
+	unsigned long bw;
+	/** Absolute deadline of the current job. */
+	xnticks_t deadline;
+	/** Runtime left for the current job. */
+	xnticks_t budget;
+	/** Date the thread was last switched in. */
+	xnticks_t run_start;
+	/** Budget accounting is active for the thread. */
+	int running;
+	/** Thread is held until replenishment. */
+	int throttled;
+	unsigned long nr_throttled;
+	struct xntimer drop_timer;
+	struct xntimer repl_timer;
+};
+
+struct xnsched_edf {
+	/** Runnable threads, by increasing deadline. */
+	struct list_head runnable;
+	/** Sum of the bandwidths reserved on this CPU. */
+	unsigned long bw_sum;
+};
+
+static inline int xnsched_edf_init_thread(struct xnthread *thread)
+{
+	thread->edf = NULL;
+	thread->edf_deadline = 0;
+
+	return 0;
+}
+
+int xnsched_edf_admit(struct xnthread *thread,
+		      const union xnsched_policy_param *p);
+
+void __xnsched_edf_charge(struct xnthread *thread);
+
+static inline void xnsched_edf_charge(struct xnthread *thread)
+{
+	if (thread->edf && thread->edf->running)
+		__xnsched_edf_charge(thread);
+}
+
+#else /* !CONFIG_XENO_OPT_SCHED_EDF */
+
+static inline void xnsched_edf_charge(struct xnthread *thread) { }
+
+#endif /* !CONFIG_XENO_OPT_SCHED_EDF */
+
+/** @} */
+
+#endif /* !_COBALT_KERNEL_SCHED_EDF_H */
@@ -27,6 +27,7 @@
 #include <cobalt/kernel/sched-weak.h>
 #include <cobalt/kernel/sched-sporadic.h>
 #include <cobalt/kernel/sched-quota.h>
+#include <cobalt/kernel/sched-edf.h>
 #include <cobalt/kernel/vfile.h>
 #include <cobalt/kernel/assert.h>
 #include <asm/xenomai/machine.h>
@@ -85,6 +86,10 @@ struct xnsched {
 #ifdef CONFIG_XENO_OPT_SCHED_QUOTA
 	/*!< Context of runtime quota scheduling. */
 	struct xnsched_quota quota;
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	/*!< Context of EDF scheduling class. */
+	struct xnsched_edf edf;
 #endif
 	/*!< Interrupt nesting level. */
 	volatile unsigned inesting;
@@ -113,12 +118,20 @@ struct xnsched {
 	/*!< Currently active account */
 	xnstat_exectime_t *current_account;
 #endif
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	/*!< Number of runnable threads assigned to this slot. */
+	int nr_runnable;
+#endif
 };
 
 DECLARE_PER_CPU(struct xnsched, nksched);
 
 extern cpumask_t cobalt_cpu_affinity;
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+extern cpumask_t xnsched_cluster_cpus;
+#endif
+
 extern struct list_head nkthreadq;
 
 extern int cobalt_nrthreads;
@@ -434,6 +447,31 @@ void xnsched_migrate(struct xnthread *thread,
 void xnsched_migrate_passive(struct xnthread *thread,
 			     struct xnsched *sched);
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+
+struct xnsched *xnsched_cluster_select(struct xnthread *thread,
+				       struct xnsched *from,
+				       const struct cpumask *allowed);
+
+static inline void xnsched_cluster_account(struct xnsched *sched, int nr)
+{
+	sched->nr_runnable += nr;
+}
+
+#else /* !CONFIG_XENO_OPT_SCHED_CLUSTER */
+
+static inline
+struct xnsched *xnsched_cluster_select(struct xnthread *thread,
+				       struct xnsched *from,
+				       const struct cpumask *allowed)
+{
+	return from;
+}
+
+static inline void xnsched_cluster_account(struct xnsched *sched, int nr) { }
+
+#endif /* !CONFIG_XENO_OPT_SCHED_CLUSTER */
+
 /**
  * @fn void xnsched_rotate(struct xnsched *sched, struct xnsched_class *sched_class, const union xnsched_policy_param *sched_param)
  * @brief Rotate a scheduler runqueue.
@@ -485,6 +523,11 @@ static inline int xnsched_init_thread(struct xnthread *thread)
 	if (ret)
 		return ret;
 #endif /* CONFIG_XENO_OPT_SCHED_QUOTA */
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	ret = xnsched_edf_init_thread(thread);
+	if (ret)
+		return ret;
+#endif /* CONFIG_XENO_OPT_SCHED_EDF */
 
 	return ret;
 }
@@ -108,6 +108,20 @@ static inline void xnstat_counter_set(xnstat_counter_t *c, unsigned long value)
 	c->counter = value;
 }
 
+struct xnthread;
+
+int xnstat_init_area(void);
+
+void xnstat_cleanup_area(void);
+
+void *xnstat_get_area(size_t *size_r);
+
+void xnstat_attach_record(struct xnthread *thread);
+
+void xnstat_detach_record(struct xnthread *thread);
+
+void __xnstat_publish(struct xnthread *thread);
+
 #else /* !CONFIG_XENO_OPT_STATS */
 typedef struct xnstat_exectime {
 } xnstat_exectime_t;
@@ -129,6 +143,21 @@ typedef struct xnstat_counter {
 #define xnstat_counter_inc(c) ({ do { } while(0); 0; })
 #define xnstat_counter_get(c) ({ 0; })
 #define xnstat_counter_set(c, value) do { } while (0)
+
+static inline int xnstat_init_area(void)
+{
+	return 0;
+}
+
+static inline void xnstat_cleanup_area(void) { }
+
+static inline void *xnstat_get_area(size_t *size_r)
+{
+	return NULL;
+}
+
+#define xnstat_attach_record(thread)	do { } while (0)
+#define xnstat_detach_record(thread)	do { } while (0)
 #endif /* CONFIG_XENO_OPT_STATS */
 
 /* Account the exectime of the current account until now, switch to
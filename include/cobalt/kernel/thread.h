@@ -107,6 +107,10 @@ struct xnthread {
 	struct xnsched_quota_group *quota; /* Quota scheduling group. */
 	struct list_head quota_expired;
 	struct list_head quota_next;
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	struct xnsched_edf_data *edf; /* EDF scheduling data. */
+	xnticks_t edf_deadline;	/* Effective deadline, i.e. EDF runqueue key. */
 #endif
 	cpumask_t affinity;	/* Processor affinity. */
 
@@ -171,8 +175,12 @@ struct xnthread {
 		xnstat_counter_t csw;	/* Context switches (includes secondary -> primary switches) */
 		xnstat_counter_t xsc;	/* Xenomai syscalls */
 		xnstat_counter_t pf;	/* Number of page faults */
+		xnstat_counter_t tmo;	/* Timed out resource waits */
 		xnstat_exectime_t account; /* Execution time accounting entity */
 		xnstat_exectime_t lastperiod; /* Interval marker for execution time reports */
+#ifdef CONFIG_XENO_OPT_STATS
+		struct xnstat_record *record; /* Binary export slot */
+#endif
 	} stat;
 
 	struct xnselector *selector;    /* For select. */
@@ -338,6 +346,14 @@ void xnthread_set_sync_window(struct xnthread *thread, int state_bits)
 	}
 }
 
+static inline void xnthread_publish_stat(struct xnthread *thread)
+{
+#ifdef CONFIG_XENO_OPT_STATS
+	if (thread->stat.record)
+		__xnstat_publish(thread);
+#endif
+}
+
 static inline int normalize_priority(int prio)
 {
 	return prio < MAX_RT_PRIO ? prio : MAX_RT_PRIO - 1;
@@ -41,6 +41,7 @@
 #   define _CC_COBALT_SCHED_SPORADIC	8
 #   define _CC_COBALT_SCHED_QUOTA	16
 #   define _CC_COBALT_SCHED_TP		32
+#   define _CC_COBALT_SCHED_EDF		64
 
 #define _CC_COBALT_GET_WATCHDOG		5
 #define _CC_COBALT_GET_CORE_STATUS	6
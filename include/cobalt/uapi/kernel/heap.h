@@ -23,6 +23,7 @@
 #define COBALT_MEMDEV_PRIVATE  "memdev-private"
 #define COBALT_MEMDEV_SHARED   "memdev-shared"
 #define COBALT_MEMDEV_SYS      "memdev-sys"
+#define COBALT_MEMDEV_STAT     "memdev-stat"
 
 struct cobalt_memdev_stat {
 	__u32 size;
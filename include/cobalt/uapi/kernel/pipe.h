@@ -18,6 +18,8 @@
 #ifndef _COBALT_UAPI_KERNEL_PIPE_H
 #define _COBALT_UAPI_KERNEL_PIPE_H
 
+#include <linux/types.h>
+
 #define	XNPIPE_IOCTL_BASE	'p'
 
 #define XNPIPEIOC_GET_NRDEV	_IOW(XNPIPE_IOCTL_BASE, 0, int)
@@ -25,6 +27,31 @@
 #define XNPIPEIOC_OFLUSH	_IO(XNPIPE_IOCTL_BASE, 2)
 #define XNPIPEIOC_FLUSH		XNPIPEIOC_OFLUSH
 #define XNPIPEIOC_SETSIG	_IO(XNPIPE_IOCTL_BASE, 3)
+#define XNPIPEIOC_ZCOPY		_IO(XNPIPE_IOCTL_BASE, 4)
+#define XNPIPEIOC_ZCRELEASE	_IO(XNPIPE_IOCTL_BASE, 5)
+#define XNPIPEIOC_FRAMED	_IO(XNPIPE_IOCTL_BASE, 6)
+#define XNPIPEIOC_SETWMARK	_IO(XNPIPE_IOCTL_BASE, 7)
+
+/*
+ * In zero-copy mode, read() returns an array of descriptors locating
+ * the messages in the memory shared by the real-time side, which
+ * the reader maps read-only from the pipe device. Each message must
+ * be given back by passing its offset to XNPIPEIOC_ZCRELEASE.
+ */
+struct xnpipe_zcdesc {
+	__u32 offset;
+	__u32 size;
+};
+
+/*
+ * In framed mode, read() returns as many whole messages as fit into
+ * the user buffer, each of them preceded by its length in bytes as
+ * a native __u32, with no padding in between. XNPIPEIOC_SETWMARK
+ * sets the amount of pending output (in bytes) below which sleeping
+ * readers are neither woken up nor notified as readable by poll();
+ * read() still returns any pending output immediately.
+ */
+#define XNPIPE_FRAME_HDRSZ	sizeof(__u32)
 
 #define XNPIPE_NORMAL	0x0
 #define XNPIPE_URGENT	0x1
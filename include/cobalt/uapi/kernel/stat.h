@@ -0,0 +1,66 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_KERNEL_STAT_H
+#define _COBALT_UAPI_KERNEL_STAT_H
+
+#include <cobalt/uapi/kernel/types.h>
+#include <cobalt/uapi/kernel/urw.h>
+
+/*
+ * Binary thread statistics exported by the Cobalt core through the
+ * COBALT_MEMDEV_STAT device (CONFIG_XENO_OPT_STATS). The area is
+ * mapped read-only; it starts with a struct xnstat_area header,
+ * followed by xnstat_area.nr_records thread records.
+ *
+ * Each record is updated by the core each time the thread it
+ * describes is switched out, under the protection of its own urw_t
+ * lock. Readers should sample records in an unsynced_read_block(),
+ * and may detect slot reuse by comparing the serial number before
+ * and after sampling. A zero serial denotes a free slot.
+ *
+ * Execution times and dates are expressed in core clock ticks,
+ * xnstat_area.clock_freq gives the tick frequency in Hz.
+ */
+
+#define XNSTAT_AREA_MAGIC  0x58535441	/* "XSTA" */
+
+struct xnstat_record {
+	urw_t lock;
+	__u32 serial;
+	__s32 pid;
+	__u32 cpu;
+	__u32 state;
+	__s32 cprio;
+	__u64 ssw;	/* Primary -> secondary mode switches */
+	__u64 csw;	/* Context switches */
+	__u64 xsc;	/* Cobalt syscalls */
+	__u64 pf;	/* Page faults */
+	__u64 tmo;	/* Timed out resource waits */
+	__u64 exectime;	/* Accumulated execution time */
+	__u64 date;	/* Date of last update */
+	char name[XNOBJECT_NAME_LEN];
+};
+
+struct xnstat_area {
+	__u32 magic;
+	__u32 nr_records;
+	__u32 record_size;
+	__u32 missed;	/* Threads which could not get a record */
+	__u64 clock_freq;
+	struct xnstat_record records[0];
+};
+
+#endif /* !_COBALT_UAPI_KERNEL_STAT_H */
@@ -83,6 +83,47 @@ typedef struct a4l_descriptor a4l_desc_t;
 
 /*! @} descriptor_sys */
 
+/* --- Scan reader structure --- */
+
+/**
+ * Maximum count of channels in a scan handled by a scan reader.
+ */
+#define A4L_SCAN_MAXCHANS 256
+
+/*!
+ * @brief Structure tracking the consumption of complete scans from
+ * a mapped asynchronous buffer
+ * @see a4l_scan_init()
+ */
+
+struct a4l_scan_reader {
+	a4l_desc_t *dsc;
+		     /**< Device descriptor. */
+	unsigned int idx_subd;
+			  /**< Input subdevice index. */
+	void *map;
+		  /**< Mapped ring-buffer. */
+	unsigned long buf_size;
+			   /**< Ring-buffer size. */
+	a4l_chinfo_t **chans;
+			 /**< Channel descriptors, in scan order. */
+	a4l_rnginfo_t **rngs;
+			 /**< Range descriptors, in scan order. */
+	int nb_chans;
+		 /**< Channels count in a scan. */
+	unsigned int scan_size;
+			   /**< Size of a scan in bytes. */
+	unsigned long offset;
+			 /**< Opaque field. */
+	unsigned long avail;
+			/**< Opaque field. */
+	unsigned long pending;
+			  /**< Opaque field. */
+	unsigned char bounce[A4L_SCAN_MAXCHANS * sizeof(lsampl_t)];
+			  /**< Opaque field. */
+};
+typedef struct a4l_scan_reader a4l_scanrd_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -222,8 +263,25 @@ int a4l_rawtof(a4l_chinfo_t *chan,
 int a4l_rawtod(a4l_chinfo_t *chan,
 	       a4l_rnginfo_t *rng, double *dst, void *src, int cnt);
 
+int a4l_rawtof_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nb_chans, float *dst, void *src, int nb_scans);
+
+int a4l_rawtod_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nb_chans, double *dst, void *src, int nb_scans);
+
 int a4l_ultoraw(a4l_chinfo_t *chan, void *dst, unsigned long *src, int cnt);
 
+int a4l_scan_init(a4l_scanrd_t *rd, a4l_desc_t *dsc,
+		  unsigned int idx_subd, void *map, unsigned long buf_size,
+		  a4l_chinfo_t **chans, a4l_rnginfo_t **rngs, int nb_chans);
+
+int a4l_scan_get(a4l_scanrd_t *rd, void **ptr, unsigned long ms_timeout);
+
+int a4l_scan_put(a4l_scanrd_t *rd, int nb_scans);
+
+int a4l_scan_readf(a4l_scanrd_t *rd, float **dst,
+		   int nb_scans, unsigned long ms_timeout);
+
 int a4l_ftoraw(a4l_chinfo_t *chan,
 	       a4l_rnginfo_t *rng, void *dst, float *src, int cnt);
 
@@ -23,4 +23,30 @@
 #include <rtdm/rtdm.h>
 #include <rtdm/uapi/ipc.h>
 
+/*
+ * Helpers for accessing a BUFP ring mapped from socket @a s. Like
+ * their syscall-based counterparts, bufp_ring_write() posts and
+ * bufp_ring_read() retrieves complete messages of @a len bytes,
+ * blocking unless MSG_DONTWAIT is given in @a flags. Both return the
+ * message length, or a negated error code.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct bufp_ring *bufp_ring_map(int s);
+
+void bufp_ring_unmap(struct bufp_ring *ring);
+
+ssize_t bufp_ring_write(struct bufp_ring *ring, int s,
+			const void *buf, size_t len, int flags);
+
+ssize_t bufp_ring_read(struct bufp_ring *ring, int s,
+		       void *buf, size_t len, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* !_RTDM_IPC_H */
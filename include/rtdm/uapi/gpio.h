@@ -18,12 +18,18 @@
 #ifndef _RTDM_UAPI_GPIO_H
 #define _RTDM_UAPI_GPIO_H
 
+#include <linux/types.h>
+
 #define GPIO_RTIOC_DIR_OUT		_IOW(RTDM_CLASS_GPIO, 0, int)
 #define GPIO_RTIOC_DIR_IN		_IO(RTDM_CLASS_GPIO, 1)
 #define GPIO_RTIOC_IRQEN		_IOW(RTDM_CLASS_GPIO, 2, int) /* GPIO trigger */
 #define GPIO_RTIOC_IRQDIS		_IO(RTDM_CLASS_GPIO, 3)
 #define GPIO_RTIOC_REQS                _IO(RTDM_CLASS_GPIO, 4)
 #define GPIO_RTIOC_RELS                _IO(RTDM_CLASS_GPIO, 5)
+#define GPIO_RTIOC_EVENTS		_IOW(RTDM_CLASS_GPIO, 6, int) /* ring depth */
+#define GPIO_RTIOC_EVSTAT		_IOR(RTDM_CLASS_GPIO, 7, struct rtdm_gpio_evstat)
+#define GPIO_RTIOC_BANK_GET		_IOWR(RTDM_CLASS_GPIO, 8, struct rtdm_gpio_bank)
+#define GPIO_RTIOC_BANK_SET		_IOW(RTDM_CLASS_GPIO, 9, struct rtdm_gpio_bank)
 
 #define GPIO_TRIGGER_NONE		0x0 /* unspecified */
 #define GPIO_TRIGGER_EDGE_RISING	0x1
@@ -32,4 +38,34 @@
 #define GPIO_TRIGGER_LEVEL_LOW		0x8
 #define GPIO_TRIGGER_MASK		0xf
 
+#define GPIO_EVENTS_MAX			4096
+
+/*
+ * Interrupt record, as returned by read(2) once an event ring was
+ * set up with GPIO_RTIOC_EVENTS. @seq is incremented for every
+ * interrupt, including those dropped on ring overflow.
+ */
+struct rtdm_gpio_event {
+	nanosecs_abs_t timestamp;
+	__u32 seq;
+	__s32 value;
+};
+
+struct rtdm_gpio_evstat {
+	__u32 pending;
+	__u32 overruns;
+};
+
+/*
+ * Masked access to up to 64 pins of a chip at once, through its bank
+ * device. Bit n of @mask and @bits stands for pin @offset + n of the
+ * chip.
+ */
+struct rtdm_gpio_bank {
+	__u32 offset;
+	__u32 __reserved;
+	__u64 mask;
+	__u64 bits;
+};
+
 #endif /* !_RTDM_UAPI_GPIO_H */
@@ -538,6 +538,17 @@ struct sockaddr_ipc {
  * @note: the pool memory is obtained from the host allocator by the
  * @ref bind__AF_RTIPC "bind call".
  *
+ * A local pool also enables the zero-copy mode for the non real-time
+ * endpoint: after mapping the pool read-only by calling @c mmap(2)
+ * on /dev/rtp@em N, and switching the descriptor to zero-copy mode
+ * with the XNPIPEIOC_ZCOPY ioctl, read(2) returns an array of struct
+ * xnpipe_zcdesc, each locating a message within the mapping instead
+ * of its contents. Every message received this way must be released
+ * by passing its offset to the XNPIPEIOC_ZCRELEASE ioctl. Streaming
+ * (see @ref XDDP_BUFSZ) is suspended while zero-copy is enabled, and
+ * XNPIPEIOC_ZCOPY fails with -EBUSY while messages are pending on the
+ * descriptor.
+ *
  * @param [in] level @ref sockopts_xddp "SOL_XDDP"
  * @param [in] optname @b XDDP_POOLSZ
  * @param [in] optval Pointer to a variable of type size_t, containing
@@ -765,6 +776,40 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define IDDP_POOLSZ		2
+/**
+ * IDDP fixed message size configuration
+ *
+ * When combined with a local pool (see @ref IDDP_POOLSZ), setting a
+ * maximum datagram size turns the local pool into a set of
+ * fixed-size slots, each large enough to convey a single datagram of
+ * up to this size. Allocating and releasing a slot are then
+ * constant-time operations, and releasing a slot wakes up at most a
+ * single sender waiting for buffer space. Sending a datagram larger
+ * than the configured size to such socket fails with -EMSGSIZE.
+ *
+ * This setting has no effect unless a local pool size is configured
+ * as well. Like the pool size, it must be set prior to binding the
+ * socket; the last value set will be used. Binding fails with
+ * -EINVAL if the local pool cannot hold a single datagram of this
+ * size.
+ *
+ * @param [in] level @ref sockopts_iddp "SOL_IDDP"
+ * @param [in] optname @b IDDP_MSGSZ
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the maximum size of a datagram in bytes
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid or *@a optval is zero)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define IDDP_MSGSZ		3
 /** @} */
 
 #define SOL_BUFP		313
@@ -834,6 +879,94 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define BUFP_BUFSZ		2
+/**
+ * BUFP mapped ring configuration
+ *
+ * Setting this option to a non-zero value before binding the socket
+ * turns its buffer into a ring shared with user-space, which both
+ * the reader and the writers may map via @c mmap(2) (see @ref
+ * bufp_ring "BUFP mapped ring"). In this mode, the buffer size
+ * configured with @ref BUFP_BUFSZ is rounded up to the next power of
+ * two, and the data is exchanged through the mapping only:
+ * sendmsg(), recvmsg(), read() and write() requests return
+ * -EOPNOTSUPP.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_RING
+ * @param [in] optval Pointer to a variable of type int, non-zero to
+ * enable the mapped ring mode
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_RING		3
+/** @} */
+
+/**
+ * @anchor bufp_ring @name BUFP mapped ring
+ *
+ * A BUFP socket bound with the @ref BUFP_RING option exposes its
+ * buffer as a single-producer, single-consumer byte ring, which
+ * user-space maps by calling @c mmap(2) on a RTIPC socket with a zero
+ * offset. Mapping the bound socket itself returns its own ring, for
+ * reading; mapping any other BUFP socket returns the ring of the
+ * port it is connected to, for writing.
+ *
+ * The mapping starts with a struct bufp_ring header, followed by the
+ * data area at offset @a data_offset. The writer advances @a head,
+ * the reader advances @a tail, both indices running freely modulo
+ * 2^32, so that the amount of pending data is always (head - tail).
+ * Data must be visible before the index moves past it.
+ *
+ * The kernel is entered only to block or to wake up the other side:
+ *
+ * - BUFP_RTIOC_WAITDATA blocks the reader until at least the given
+ *   number of bytes is pending in the ring, or the receive timeout
+ *   elapses (see SO_RCVTIMEO).
+ *
+ * - BUFP_RTIOC_WAITSPACE blocks the writer until the given number
+ *   of bytes is free in the ring, or the send timeout elapses (see
+ *   SO_SNDTIMEO).
+ *
+ * - BUFP_RTIOC_KICK wakes up the sleepers on the other side of the
+ *   ring. This call is needed only when the corresponding waiting
+ *   flag (@a rd_waiting for a writer, @a wr_waiting for a reader) is
+ *   set in the header, after the index was updated.
+ *
+ * The bufp_ring_read() and bufp_ring_write() helpers from
+ * <rtdm/ipc.h> implement this protocol.
+ * @{ */
+struct bufp_ring {
+	/** Size of the data area in bytes (power of two). */
+	__u32 size;
+	/** Offset of the data area from the start of the mapping. */
+	__u32 data_offset;
+	__u32 __reserved[14];
+	/** Write index, updated by the writer. */
+	__u32 head;
+	/** Set by the kernel while a reader waits for data. */
+	__u32 rd_waiting;
+	__u32 __pad1[14];
+	/** Read index, updated by the reader. */
+	__u32 tail;
+	/** Set by the kernel while a writer waits for space. */
+	__u32 wr_waiting;
+	__u32 __pad2[14];
+};
+
+#define RTIOC_TYPE_RTIPC	RTDM_CLASS_RTIPC
+
+#define BUFP_RTIOC_WAITDATA	_IOW(RTIOC_TYPE_RTIPC, 0x00, __u32)
+#define BUFP_RTIOC_WAITSPACE	_IOW(RTIOC_TYPE_RTIPC, 0x01, __u32)
+#define BUFP_RTIOC_KICK		_IO(RTIOC_TYPE_RTIPC, 0x02)
 /** @} */
 
 /**
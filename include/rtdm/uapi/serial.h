@@ -192,6 +192,17 @@
 #define RTSER_BREAK_CLR			0x00
 #define RTSER_BREAK_SET			0x01
 
+/*!
+ * @anchor RTSER_FRAMING_xxx   @name RTSER_FRAMING_xxx
+ * Reception framing modes
+ * @{ */
+#define RTSER_FRAMING_NONE		0x00
+#define RTSER_FRAMING_IDLE_GAP		0x01
+/** @} */
+
+/** frame status bit: frame data was truncated to the read buffer */
+#define RTSER_FRAME_TRUNCATED		0x0200
+
 
 /**
  * Serial device configuration
@@ -271,6 +282,40 @@ typedef struct rtser_event {
 } rtser_event_t;
 
 
+/**
+ * Reception framing configuration
+ */
+typedef struct rtser_framing {
+	/** framing mode, see @ref RTSER_FRAMING_xxx */
+	int		mode;
+
+	/** maximum frame length, 0 for the driver default */
+	int		max_length;
+
+	/** line idle time closing a frame, 0 for 3.5 character times */
+	nanosecs_rel_t	idle_gap;
+} rtser_framing_t;
+
+/**
+ * Frame header, preceding the frame data returned by read() when
+ * reception framing is enabled
+ */
+typedef struct rtser_frame {
+	/** reception timestamp of the first character */
+	nanosecs_abs_t	first_timestamp;
+
+	/** reception timestamp of the last character */
+	nanosecs_abs_t	last_timestamp;
+
+	/** frame length, which may exceed the returned data */
+	int		length;
+
+	/** line errors observed during reception, see @ref RTSER_LSR_xxx,
+	 *  and @c RTSER_FRAME_TRUNCATED */
+	int		status;
+} rtser_frame_t;
+
+
 #define RTIOC_TYPE_SERIAL		RTDM_CLASS_SERIAL
 
 
@@ -396,6 +441,31 @@ typedef struct rtser_event {
  */
 #define RTSER_RTIOC_BREAK_CTL	\
 	_IOR(RTIOC_TYPE_SERIAL, 0x06, int)
+
+/**
+ * Set reception framing mode
+ *
+ * @param[in] arg Pointer to framing settings (struct rtser_framing)
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if the settings are invalid.
+ *
+ * - -ENOTTY is returned if the device does not support framing.
+ *
+ * @coretags{task-unrestricted}
+ *
+ * @note Once framing is enabled, input characters are grouped into
+ * frames which end when the line stays idle for longer than the
+ * configured gap, or upon reaching the maximum frame length. Each
+ * read() then returns a single complete frame, as a struct
+ * rtser_frame header followed by the frame data. Changing the
+ * framing mode discards any pending input. Frame boundaries can
+ * only be detected at the granularity of the reception FIFO
+ * threshold, use @c RTSER_FIFO_DEPTH_1 for exact framing.
+ */
+#define RTSER_RTIOC_SET_FRAMING	\
+	_IOW(RTIOC_TYPE_SERIAL, 0x07, struct rtser_framing)
 /** @} */
 
 /*!
@@ -33,9 +33,39 @@ struct rtdm_spi_iobufs {
 	__u32 map_len;
 };
 
+/*
+ * Transfer descriptor for SPI_RTIOC_TRANSFER_LIST. @offset is
+ * relative to both the input and output areas of the I/O buffers,
+ * @speed_hz overrides the configured speed if non-zero, @delay_us
+ * is waited for after the transfer, up to SPI_XFER_DELAY_MAX, and a
+ * non-zero @cs_change deselects the slave between this transfer and
+ * the next one. Keeping the slave selected across transfers requires
+ * a chip select the master can hold on its own, i.e. a GPIO for
+ * bcm2835, whose native chip select is released at the end of every
+ * transfer regardless of @cs_change.
+ */
+struct rtdm_spi_xfer {
+	__u32 offset;
+	__u32 len;
+	__u32 speed_hz;
+	__u16 delay_us;
+	__u8 cs_change;
+	__u8 __pad;
+};
+
+struct rtdm_spi_xfer_list {
+	__u64 xfers;	/* struct rtdm_spi_xfer[] */
+	__u32 nr_xfers;
+	__u32 __pad;
+};
+
+#define SPI_XFER_LIST_MAX	64
+#define SPI_XFER_DELAY_MAX	50	/* us */
+
 #define SPI_RTIOC_SET_CONFIG		_IOW(RTDM_CLASS_SPI, 0, struct rtdm_spi_config)
 #define SPI_RTIOC_GET_CONFIG		_IOR(RTDM_CLASS_SPI, 1, struct rtdm_spi_config)
 #define SPI_RTIOC_SET_IOBUFS		_IOR(RTDM_CLASS_SPI, 2, struct rtdm_spi_iobufs)
 #define SPI_RTIOC_TRANSFER		_IO(RTDM_CLASS_SPI, 3)
+#define SPI_RTIOC_TRANSFER_LIST		_IOW(RTDM_CLASS_SPI, 4, struct rtdm_spi_xfer_list)
 
 #endif /* !_RTDM_UAPI_SPI_H */
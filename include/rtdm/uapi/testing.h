@@ -68,7 +68,7 @@ struct rttst_swtest_task {
 
 /* Possible values for struct rttst_swtest_task::flags. */
 #define RTTST_SWTEST_FPU		0x1
-#define RTTST_SWTEST_USE_FPU		0x2 /* Only for kernel-space tasks. */
+#define RTTST_SWTEST_USE_FPU		0x2 /* Informational for user-space tasks. */
 #define RTTST_SWTEST_FREEZE		0x4 /* Only for kernel-space tasks. */
 
 struct rttst_swtest_dir {
@@ -76,6 +76,77 @@ struct rttst_swtest_dir {
 	unsigned int to;
 };
 
+/*
+ * Switch timing breakdown. Each switch is timed from the point the
+ * outgoing task wakes up its successor, to the point the latter
+ * resumes in the switchtest driver, using the raw core clock (i.e.
+ * the same time source as cobalt_read_hrclock()). Timings are
+ * accounted per path, depending on the mode of both endpoints, and
+ * on whether either of them uses the FPU.
+ */
+#define RTTST_SWTEST_KERNEL		0 /* kernel-space task */
+#define RTTST_SWTEST_PRIMARY		1 /* user-space task, primary mode */
+#define RTTST_SWTEST_SECONDARY		2 /* user-space task, secondary mode */
+#define RTTST_SWTEST_NR_ENDPOINTS	3
+
+#define RTTST_SWTEST_PATH(__from, __to, __fpu)			\
+	(((__from) * RTTST_SWTEST_NR_ENDPOINTS + (__to)) * 2 + !!(__fpu))
+
+#define RTTST_SWTEST_NR_PATHS	\
+	(RTTST_SWTEST_NR_ENDPOINTS * RTTST_SWTEST_NR_ENDPOINTS * 2)
+
+/*
+ * Durations are collected into a log-linear histogram: each power of
+ * two range of clock ticks is split into 2^(SUBBITS - 1) cells,
+ * which bounds the relative error on any value to 1/16. Durations
+ * beyond 2^32 ticks are accounted in the last cell.
+ */
+#define RTTST_SWTEST_TIMING_SUBBITS	5
+#define RTTST_SWTEST_TIMING_CELLS	\
+	((32 - RTTST_SWTEST_TIMING_SUBBITS + 2) << (RTTST_SWTEST_TIMING_SUBBITS - 1))
+
+struct rttst_swtest_timing {
+	__u64 count;
+	__u64 min;
+	__u64 max;
+	__u64 sum;
+	__u64 cells[RTTST_SWTEST_TIMING_CELLS];
+};
+
+struct rttst_swtest_timings {
+	__u32 nr_paths;
+	struct rttst_swtest_timing *timings;
+};
+
+static inline unsigned int rttst_swtest_timing_cell(__u64 ticks)
+{
+	const unsigned int sub_bits = RTTST_SWTEST_TIMING_SUBBITS;
+	unsigned int e, cell;
+
+	if (ticks < (1ULL << sub_bits))
+		return (unsigned int)ticks;
+
+	e = 64 - __builtin_clzll(ticks) - sub_bits;
+	cell = (e << (sub_bits - 1)) + (unsigned int)(ticks >> e);
+
+	return cell < RTTST_SWTEST_TIMING_CELLS ?
+		cell : RTTST_SWTEST_TIMING_CELLS - 1;
+}
+
+/* Lowest tick count accounted in @cell. */
+static inline __u64 rttst_swtest_timing_base(unsigned int cell)
+{
+	const unsigned int half = 1U << (RTTST_SWTEST_TIMING_SUBBITS - 1);
+	unsigned int e;
+
+	if (cell < (1U << RTTST_SWTEST_TIMING_SUBBITS))
+		return cell;
+
+	e = cell / half - 1;
+
+	return (__u64)(cell - e * half) << e;
+}
+
 struct rttst_swtest_error {
 	struct rttst_swtest_dir last_switch;
 	unsigned int fp_val;
@@ -175,6 +246,12 @@ struct rttst_heap_stathdr {
 #define RTTST_RTIOC_SWTEST_SET_PAUSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x38, __u32)
 
+#define RTTST_RTIOC_SWTEST_SET_TIMING \
+	_IOW(RTIOC_TYPE_TESTING, 0x39, __u32)
+
+#define RTTST_RTIOC_SWTEST_GET_TIMINGS \
+	_IOWR(RTIOC_TYPE_TESTING, 0x3a, struct rttst_swtest_timings)
+
 #define RTTST_RTIOC_RTDM_DEFER_CLOSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x40, __u32)
 
@@ -21,6 +21,8 @@
 #ifndef _RTDM_UAPI_UDD_H
 #define _RTDM_UAPI_UDD_H
 
+#include <linux/types.h>
+
 /**
  * @addtogroup rtdm_udd
  *
@@ -56,6 +58,53 @@ struct udd_signotify {
 	int sig;
 };
 
+/**
+ * @anchor udd_coalesce
+ * @brief UDD event coalescing descriptor
+ *
+ * This structure shall be used to pass the coalescing settings for
+ * interrupt notifications. Waiters are woken up, and the signal
+ * notification if any is sent, once @a count interrupts were received
+ * since the last notification, or @a delay_us microseconds after the
+ * first of them, whichever comes first.
+ */
+struct udd_coalesce {
+	/**
+	 * Number of interrupts to receive before notifying. Zero
+	 * and one both disable coalescing.
+	 */
+	__u32 count;
+	/**
+	 * Maximum notification delay in microseconds after the first
+	 * pending interrupt, zero for unbounded. This value is not
+	 * considered if coalescing is disabled.
+	 */
+	__u32 delay_us;
+};
+
+/**
+ * @anchor udd_irqstat
+ * @brief UDD interrupt status page
+ *
+ * This structure is found at the start of the page obtained by
+ * mapping the UDD device itself (not one of its memory regions) via
+ * mmap(2), read-only. It is updated on every interrupt received,
+ * regardless of event coalescing, so that user-space drivers may poll
+ * for interrupts without issuing any system call.
+ *
+ * A consistent snapshot of @a count and @a timestamp is obtained by
+ * reading @a seq before and after the other fields, retrying while
+ * the values differ or are odd.
+ */
+struct udd_irqstat {
+	/** Update sequence, odd while an update is in progress. */
+	__u32 seq;
+	/** Count of interrupts received since registration. */
+	__u32 count;
+	/** Receipt date of the last interrupt (CLOCK_MONOTONIC, ns). */
+	__u64 timestamp;
+};
+
 /**
  * @anchor udd_ioctl_codes @name UDD_IOCTL
  * IOCTL requests
@@ -91,6 +140,14 @@ struct udd_signotify {
  * receives -EIO from the UDD core.
  */
 #define UDD_RTIOC_IRQSIG	_IOW(RTDM_CLASS_UDD, 2, struct udd_signotify)
+/**
+ * Set the coalescing parameters for interrupt notifications. A valid
+ * @ref udd_coalesce "coalescing descriptor" must be passed along
+ * with this request, which is handled by the UDD core directly.
+ * Coalescing applies to read(2), select(2) and signal
+ * notifications alike, the interrupt status page is not affected.
+ */
+#define UDD_RTIOC_COALESCE	_IOW(RTDM_CLASS_UDD, 3, struct udd_coalesce)
 
 /** @} */
 /** @} */
@@ -22,6 +22,7 @@
 #include <pthread.h>
 #include <boilerplate/list.h>
 #include <boilerplate/libc.h>
+#include <boilerplate/histogram.h>
 #include <copperplate/clockobj.h>
 #include <xenomai/init.h>
 
@@ -213,6 +214,13 @@ struct smokey_barrier {
 	int signaled;
 };
 
+struct smokey_bench {
+	struct smokey_test *test;
+	const char *name;
+	struct timespec start;
+	struct histogram hist;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -254,6 +262,23 @@ int smokey_barrier_timedwait(struct smokey_barrier *b,
 void smokey_barrier_release(struct smokey_barrier *b);
 
 int smokey_fork_exec(const char *path, const char *arg);
+
+int smokey_bench_init(struct smokey_bench *b,
+		      struct smokey_test *t, const char *name);
+
+void smokey_bench_start(struct smokey_bench *b);
+
+void smokey_bench_stop(struct smokey_bench *b);
+
+int smokey_bench_report(struct smokey_bench *b);
+
+int smokey_bench_metric(struct smokey_test *t, const char *name,
+			double value, const char *unit);
+
+int smokey_bench_run(struct smokey_test *t, const char *name,
+		     int (*op)(void *arg), void *arg);
+
+int smokey_bench_send_recv(void *arg);
 	
 #ifdef __cplusplus
 }
@@ -267,4 +292,10 @@ extern int smokey_verbose_mode;
 
 extern int smokey_on_vm;
 
+extern int smokey_bench_mode;
+
+extern int smokey_bench_iterations;
+
+extern int smokey_bench_warmup;
+
 #endif /* _XENOMAI_SMOKEY_SMOKEY_H */
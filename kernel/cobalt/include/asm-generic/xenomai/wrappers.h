@@ -55,6 +55,24 @@
 #define cobalt_gpiochip_dev(__gc)	((__gc)->parent)
 #endif
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3,19,0)
+#define cobalt_gpiochip_has_set_multiple(__gc)	0
+#define cobalt_gpiochip_set_multiple(__gc, __mask, __bits)	do { } while (0)
+#else
+#define cobalt_gpiochip_has_set_multiple(__gc)	((__gc)->set_multiple != NULL)
+#define cobalt_gpiochip_set_multiple(__gc, __mask, __bits)	\
+	(__gc)->set_multiple(__gc, __mask, __bits)
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,13,0)
+#define cobalt_gpiochip_has_get_multiple(__gc)	0
+#define cobalt_gpiochip_get_multiple(__gc, __mask, __bits)	(-EOPNOTSUPP)
+#else
+#define cobalt_gpiochip_has_get_multiple(__gc)	((__gc)->get_multiple != NULL)
+#define cobalt_gpiochip_get_multiple(__gc, __mask, __bits)	\
+	(__gc)->get_multiple(__gc, __mask, __bits)
+#endif
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,0,0)
 #define cobalt_get_restart_block(p)	(&task_thread_info(p)->restart_block)
 #else
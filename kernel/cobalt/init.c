@@ -156,6 +156,7 @@ static void sys_shutdown(void)
 	membase = xnheap_get_membase(&cobalt_heap);
 	xnheap_destroy(&cobalt_heap);
 	xnheap_vfree(membase);
+	xnstat_cleanup_area();
 }
 
 static int __init mach_setup(void)
@@ -295,6 +296,13 @@ static __init int sys_init(void)
 	}
 	xnheap_set_name(&cobalt_heap, "system heap");
 
+	ret = xnstat_init_area();
+	if (ret) {
+		xnheap_destroy(&cobalt_heap);
+		xnheap_vfree(heapaddr);
+		return ret;
+	}
+
 	for_each_online_cpu(cpu) {
 		sched = &per_cpu(nksched, cpu);
 		xnsched_init(sched, cpu);
@@ -348,6 +356,9 @@ static int __init xenomai_init(void)
 		return 0;
 	}
 	cobalt_cpu_affinity = xnsched_realtime_cpus;
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	xnsched_cluster_cpus = xnsched_realtime_cpus;
+#endif
 #endif /* CONFIG_SMP */
 
 	xnsched_register_classes();
@@ -26,6 +26,8 @@
 #include <linux/termios.h>
 #include <linux/spinlock.h>
 #include <linux/device.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <asm/io.h>
 #include <asm/uaccess.h>
 #include <cobalt/kernel/sched.h>
@@ -111,6 +113,17 @@ static inline void xnpipe_dequeue_all(struct xnpipe_state *state, int mask)
 	}
 }
 
+/*
+ * Readers are only deemed ready once the amount of pending output
+ * reaches the wakeup watermark, so that a stream of small messages
+ * does not cost one wakeup each. Must be entered with nklock held,
+ * interrupts off.
+ */
+static inline int xnpipe_readable_p(struct xnpipe_state *state)
+{
+	return !list_empty(&state->outq) && state->ionrd >= state->wmark;
+}
+
 /* Must be entered with nklock held, interrupts off. */
 #define xnpipe_wait(__state, __mask, __s, __cond)			\
 ({									\
@@ -338,6 +351,8 @@ int xnpipe_connect(int minor, struct xnpipe_operations *ops, void *xstate)
 	xnsynch_init(&state->synchbase, XNSYNCH_FIFO, NULL);
 	state->xstate = xstate;
 	state->ionrd = 0;
+	state->shmbase = NULL;
+	state->shmsize = 0;
 
 	if (state->status & XNPIPE_USER_CONN) {
 		if (state->status & XNPIPE_USER_WREAD) {
@@ -470,6 +485,11 @@ ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 		return (ssize_t) size;
 	}
 
+	if (!xnpipe_readable_p(state)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return (ssize_t) size;
+	}
+
 	if (state->status & XNPIPE_USER_WREAD) {
 		/*
 		 * Wake up the regular Linux task waiting for input
@@ -516,6 +536,16 @@ ssize_t xnpipe_mfixup(int minor, struct xnpipe_mh *mh, ssize_t size)
 	xnpipe_m_size(mh) += size;
 	state->ionrd += size;
 
+	/*
+	 * Appending to a queued message may be what brings the
+	 * pending output over the reader watermark.
+	 */
+	if (state->wmark > 0 && (state->status & XNPIPE_USER_WREAD) &&
+	    xnpipe_readable_p(state)) {
+		state->status |= XNPIPE_USER_WREAD_READY;
+		xnpipe_schedule_request();
+	}
+
 	xnlock_put_irqrestore(&nklock, s);
 
 	return (ssize_t) size;
@@ -636,6 +666,40 @@ int xnpipe_flush(int minor, int mode)
 }
 EXPORT_SYMBOL_GPL(xnpipe_flush);
 
+/*
+ * Make the vmalloc'ed memory range [base, base + size[ available for
+ * read-only mapping to the user-space endpoint, enabling the
+ * zero-copy mode. All outgoing messages must be allocated from this
+ * range for this mode to be usable.
+ */
+int xnpipe_share(int minor, void *base, size_t size)
+{
+	struct xnpipe_state *state;
+	int ret = 0;
+	spl_t s;
+
+	if (minor < 0 || minor >= XNPIPE_NDEVS)
+		return -ENODEV;
+
+	if (!PAGE_ALIGNED(base) || !PAGE_ALIGNED(size))
+		return -EINVAL;
+
+	state = &xnpipe_states[minor];
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (state->status & XNPIPE_KERN_CONN) {
+		state->shmbase = base;
+		state->shmsize = size;
+	} else
+		ret = -EBADF;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnpipe_share);
+
 int xnpipe_pollstate(int minor, unsigned int *mask_r)
 {
 	struct xnpipe_state *state;
@@ -666,8 +730,10 @@ EXPORT_SYMBOL_GPL(xnpipe_pollstate);
 #define xnpipe_cleanup_user_conn(__state, __s)				\
 	do {								\
 		xnpipe_flushq((__state), outq, free_obuf, (__s));	\
+		xnpipe_flushq((__state), zcq, free_obuf, (__s));	\
 		xnpipe_flushq((__state), inq, free_ibuf, (__s));	\
-		(__state)->status &= ~XNPIPE_USER_CONN;			\
+		(__state)->status &= ~(XNPIPE_USER_CONN|XNPIPE_USER_ZCOPY| \
+				       XNPIPE_USER_FRAMED);		\
 		if ((__state)->status & XNPIPE_KERN_LCLOSE) {		\
 			(__state)->status &= ~XNPIPE_KERN_LCLOSE;	\
 			xnlock_put_irqrestore(&nklock, (__s));		\
@@ -715,6 +781,7 @@ static int xnpipe_open(struct inode *inode, struct file *file)
 	state->status |= XNPIPE_USER_CONN;
 	state->status &= ~XNPIPE_USER_LCONN;
 	state->wcount = 0;
+	state->wmark = 0;
 
 	state->status &=
 		~(XNPIPE_USER_ALL_WAIT | XNPIPE_USER_ALL_READY |
@@ -785,6 +852,142 @@ static int xnpipe_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/*
+ * Zero-copy read: lend as many messages as we have descriptor slots
+ * in the user buffer, moving them to the zero-copy queue until they
+ * are released. Must be entered with nklock held, interrupts off,
+ * output queue non-empty.
+ */
+static ssize_t xnpipe_read_zc(struct xnpipe_state *state,
+			      char *buf, size_t count, spl_t *s)
+{
+	struct xnpipe_zcdesc desc;
+	struct xnpipe_mh *mh;
+	size_t inbytes = 0;
+
+	if (count < sizeof(desc))
+		return -EINVAL;
+
+	while (!list_empty(&state->outq) && inbytes + sizeof(desc) <= count) {
+		mh = list_get_entry(&state->outq, struct xnpipe_mh, link);
+		state->nroutq--;
+		list_add_tail(&mh->link, &state->zcq);
+		state->nrzcq++;
+		desc.offset = xnpipe_m_data(mh) + xnpipe_m_rdoff(mh) -
+			(char *)state->shmbase;
+		desc.size = xnpipe_m_size(mh) - xnpipe_m_rdoff(mh);
+		state->ionrd -= desc.size;
+		if (state->ops.output)
+			state->ops.output(mh, state->xstate);
+		xnlock_put_irqrestore(&nklock, *s);
+		/* The message stays on zcq upon failure, until close. */
+		if (__copy_to_user(buf + inbytes, &desc, sizeof(desc))) {
+			xnlock_get_irqsave(&nklock, *s);
+			return -EFAULT;
+		}
+		xnlock_get_irqsave(&nklock, *s);
+		inbytes += sizeof(desc);
+	}
+
+	return inbytes;
+}
+
+static int xnpipe_release_zc(struct xnpipe_state *state, unsigned long offset)
+{
+	struct xnpipe_mh *mh;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	list_for_each_entry(mh, &state->zcq, link) {
+		if (xnpipe_m_data(mh) + xnpipe_m_rdoff(mh) ==
+		    (char *)state->shmbase + offset)
+			goto found;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return -EINVAL;
+found:
+	list_del(&mh->link);
+	state->nrzcq--;
+	xnlock_put_irqrestore(&nklock, s);
+	state->ops.free_obuf(mh, state->xstate);
+	xnlock_get_irqsave(&nklock, s);
+	if (state->status & XNPIPE_USER_WSYNC) {
+		state->status |= XNPIPE_USER_WSYNC_READY;
+		xnpipe_schedule_request();
+	}
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/*
+ * Framed read: drain as many whole messages as fit into the user
+ * buffer, each preceded by a length header. Must be entered with
+ * nklock held, interrupts off, output queue non-empty.
+ */
+static ssize_t xnpipe_read_framed(struct xnpipe_state *state,
+				  char *buf, size_t count, spl_t *s)
+{
+	size_t inbytes = 0, nbytes;
+	struct xnpipe_mh *mh;
+	int err = 0, kick = 0;
+	__u32 hdr;
+
+	while (!list_empty(&state->outq)) {
+		mh = list_first_entry(&state->outq, struct xnpipe_mh, link);
+		nbytes = xnpipe_m_size(mh) - xnpipe_m_rdoff(mh);
+		if (inbytes + sizeof(hdr) + nbytes > count) {
+			if (inbytes == 0)
+				err = -EMSGSIZE;
+			break;
+		}
+
+		list_del(&mh->link);
+		state->nroutq--;
+		state->ionrd -= nbytes;
+		hdr = nbytes;
+
+		xnlock_put_irqrestore(&nklock, *s);
+		/* More data could be appended while doing this: */
+		err = __copy_to_user(buf + inbytes, &hdr, sizeof(hdr)) ||
+			__copy_to_user(buf + inbytes + sizeof(hdr),
+				       xnpipe_m_data(mh) + xnpipe_m_rdoff(mh),
+				       nbytes);
+		xnlock_get_irqsave(&nklock, *s);
+
+		xnpipe_m_rdoff(mh) += nbytes;
+		if (xnpipe_m_size(mh) > xnpipe_m_rdoff(mh)) {
+			/* Data was appended, return it as the next frame. */
+			list_add(&mh->link, &state->outq);
+			state->nroutq++;
+		} else {
+			if (state->ops.output)
+				state->ops.output(mh, state->xstate);
+			xnlock_put_irqrestore(&nklock, *s);
+			state->ops.free_obuf(mh, state->xstate);
+			xnlock_get_irqsave(&nklock, *s);
+			kick = 1;
+		}
+
+		if (err) {
+			err = -EFAULT;
+			break;
+		}
+
+		inbytes += sizeof(hdr) + nbytes;
+	}
+
+	if (kick && (state->status & XNPIPE_USER_WSYNC)) {
+		state->status |= XNPIPE_USER_WSYNC_READY;
+		xnpipe_schedule_request();
+	}
+
+	return err ?: inbytes;
+}
+
 static ssize_t xnpipe_read(struct file *file,
 			   char *buf, size_t count, loff_t *ppos)
 {
@@ -806,7 +1009,9 @@ static ssize_t xnpipe_read(struct file *file,
 	}
 	/*
 	 * Queue probe and proc enqueuing must be seen atomically,
-	 * including from the Xenomai side.
+	 * including from the Xenomai side. The watermark only delays
+	 * the wakeup of a sleeping reader, whatever is queued is
+	 * returned to the caller right away.
 	 */
 	if (list_empty(&state->outq)) {
 		if (file->f_flags & O_NONBLOCK) {
@@ -815,7 +1020,7 @@ static ssize_t xnpipe_read(struct file *file,
 		}
 
 		sigpending = xnpipe_wait(state, XNPIPE_USER_WREAD, s,
-					 !list_empty(&state->outq));
+					 xnpipe_readable_p(state));
 
 		if (list_empty(&state->outq)) {
 			xnlock_put_irqrestore(&nklock, s);
@@ -823,6 +1028,18 @@ static ssize_t xnpipe_read(struct file *file,
 		}
 	}
 
+	if (state->status & XNPIPE_USER_ZCOPY) {
+		ret = xnpipe_read_zc(state, buf, count, &s);
+		xnlock_put_irqrestore(&nklock, s);
+		return ret;
+	}
+
+	if (state->status & XNPIPE_USER_FRAMED) {
+		ret = xnpipe_read_framed(state, buf, count, &s);
+		xnlock_put_irqrestore(&nklock, s);
+		return ret;
+	}
+
 	mh = list_get_entry(&state->outq, struct xnpipe_mh, link);
 	state->nroutq--;
 
@@ -1028,6 +1245,65 @@ static long xnpipe_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		xnpipe_asyncsig = arg;
 		break;
 
+	case XNPIPEIOC_ZCOPY:
+
+		xnlock_get_irqsave(&nklock, s);
+
+		if ((state->status & XNPIPE_KERN_CONN) == 0)
+			ret = -EPIPE;
+		else if (state->shmbase == NULL)
+			ret = -EOPNOTSUPP;
+		else if (arg) {
+			/*
+			 * Queued messages may still grow through
+			 * xnpipe_mfixup(), which must never happen
+			 * to a buffer lent to user-space. Only
+			 * switch to zero-copy with an empty output
+			 * queue, from which point the owner knows
+			 * not to append to its messages anymore.
+			 */
+			if (state->nroutq > 0)
+				ret = -EBUSY;
+			else
+				state->status |= XNPIPE_USER_ZCOPY;
+		}
+		else if (state->nrzcq > 0)
+			ret = -EBUSY;
+		else
+			state->status &= ~XNPIPE_USER_ZCOPY;
+
+		xnlock_put_irqrestore(&nklock, s);
+		break;
+
+	case XNPIPEIOC_ZCRELEASE:
+
+		return xnpipe_release_zc(state, arg);
+
+	case XNPIPEIOC_FRAMED:
+
+		xnlock_get_irqsave(&nklock, s);
+
+		if (arg)
+			state->status |= XNPIPE_USER_FRAMED;
+		else
+			state->status &= ~XNPIPE_USER_FRAMED;
+
+		xnlock_put_irqrestore(&nklock, s);
+		break;
+
+	case XNPIPEIOC_SETWMARK:
+
+		xnlock_get_irqsave(&nklock, s);
+		state->wmark = arg;
+		/* Lowering the watermark may release a sleeping reader. */
+		if ((state->status & XNPIPE_USER_WREAD) &&
+		    xnpipe_readable_p(state)) {
+			state->status |= XNPIPE_USER_WREAD_READY;
+			xnpipe_schedule_request();
+		}
+		xnlock_put_irqrestore(&nklock, s);
+		break;
+
 	case FIONREAD:
 
 		n = (state->status & XNPIPE_KERN_CONN) ? state->ionrd : 0;
@@ -1073,6 +1349,68 @@ static int xnpipe_fasync(int fd, struct file *file, int on)
 	return ret;
 }
 
+/*
+ * Map the memory shared by the owner via xnpipe_share(), read-only,
+ * starting from its base address.
+ */
+static int xnpipe_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct xnpipe_state *state = file->private_data;
+	unsigned long len, addr;
+	size_t shmsize;
+	void *shmbase;
+	int ret;
+	spl_t s;
+
+	/*
+	 * The shared memory also contains the message headers and
+	 * the allocator metadata, user-space may only read from it.
+	 */
+	if (vma->vm_flags & VM_WRITE)
+		return -EACCES;
+
+	/*
+	 * The owner releases the shared memory from its ->release()
+	 * handler, which xnpipe_disconnect() postpones until
+	 * xnpipe_release() runs as long as the user endpoint is
+	 * connected (lingering close). Since the file is held by the
+	 * caller, our connection pins the memory across the insert
+	 * loop below, provided it was established when shmbase was
+	 * sampled.
+	 */
+	xnlock_get_irqsave(&nklock, s);
+	if (state->status & XNPIPE_USER_CONN) {
+		shmbase = state->shmbase;
+		shmsize = state->shmsize;
+	} else
+		shmbase = NULL;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (shmbase == NULL)
+		return -ENODEV;
+
+	len = vma->vm_end - vma->vm_start;
+	if (vma->vm_pgoff != 0 || len > shmsize)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	/*
+	 * vm_insert_page() holds a reference on every page we map,
+	 * so the pages remain valid until this mapping goes away,
+	 * even if the owner releases the shared memory after we are
+	 * done.
+	 */
+	for (addr = vma->vm_start; addr < vma->vm_end; addr += PAGE_SIZE) {
+		ret = vm_insert_page(vma, addr,
+				     vmalloc_to_page(shmbase + addr - vma->vm_start));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 {
 	struct xnpipe_state *state = file->private_data;
@@ -1088,7 +1426,7 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	else
 		r_mask |= POLLHUP;
 
-	if (!list_empty(&state->outq))
+	if (xnpipe_readable_p(state))
 		r_mask |= (POLLIN | POLLRDNORM);
 	else
 		/*
@@ -1109,6 +1447,7 @@ static struct file_operations xnpipe_fops = {
 	.write = xnpipe_write,
 	.poll = xnpipe_poll,
 	.unlocked_ioctl = xnpipe_ioctl,
+	.mmap = xnpipe_mmap,
 	.open = xnpipe_open,
 	.release = xnpipe_release,
 	.fasync = xnpipe_fasync
@@ -1128,6 +1467,9 @@ int xnpipe_mount(void)
 		state->nrinq = 0;
 		INIT_LIST_HEAD(&state->outq);
 		state->nroutq = 0;
+		INIT_LIST_HEAD(&state->zcq);
+		state->nrzcq = 0;
+		state->shmbase = NULL;
 	}
 
 	xnpipe_class = class_create(THIS_MODULE, "rtpipe");
@@ -57,6 +57,8 @@ static int do_conf_option(int option, void __user *u_buf, size_t u_bufsz)
 			val |= _CC_COBALT_SCHED_SPORADIC;
 		if (IS_ENABLED(CONFIG_XENO_OPT_SCHED_QUOTA))
 			val |= _CC_COBALT_SCHED_QUOTA;
+		if (IS_ENABLED(CONFIG_XENO_OPT_SCHED_EDF))
+			val |= _CC_COBALT_SCHED_EDF;
 		if (IS_ENABLED(CONFIG_XENO_OPT_SCHED_TP))
 			val |= _CC_COBALT_SCHED_TP;
 		break;
@@ -24,6 +24,7 @@
 #include <linux/vmalloc.h>
 #include <rtdm/driver.h>
 #include <cobalt/kernel/vdso.h>
+#include <cobalt/kernel/stat.h>
 #include "process.h"
 #include "memory.h"
 
@@ -205,6 +206,115 @@ static int sysmem_ioctl_nrt(struct rtdm_fd *fd,
 	return do_sysmem_ioctls(fd, request, arg);
 }
 
+#ifdef CONFIG_XENO_OPT_STATS
+
+static int statdev_open(struct rtdm_fd *fd, int oflags)
+{
+	if ((oflags & O_ACCMODE) != O_RDONLY)
+		return -EACCES;
+
+	return 0;
+}
+
+static int statdev_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	size_t len, size;
+	void *area;
+
+	area = xnstat_get_area(&size);
+	if (area == NULL)
+		return -ENODEV;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EACCES;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	len = vma->vm_end - vma->vm_start;
+	if (len != size)
+		return -EINVAL;
+
+	if (xnarch_cache_aliasing())
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return rtdm_mmap_vmem(vma, area);
+}
+
+static int do_statdev_ioctls(struct rtdm_fd *fd,
+			     unsigned int request, void __user *arg)
+{
+	struct cobalt_memdev_stat stat;
+	size_t size;
+	int ret;
+
+	switch (request) {
+	case MEMDEV_RTIOC_STAT:
+		if (xnstat_get_area(&size) == NULL)
+			return -ENODEV;
+		stat.size = size;
+		stat.free = 0;
+		ret = rtdm_safe_copy_to_user(fd, arg, &stat, sizeof(stat));
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int statdev_ioctl_rt(struct rtdm_fd *fd,
+			    unsigned int request, void __user *arg)
+{
+	return do_statdev_ioctls(fd, request, arg);
+}
+
+static int statdev_ioctl_nrt(struct rtdm_fd *fd,
+			     unsigned int request, void __user *arg)
+{
+	return do_statdev_ioctls(fd, request, arg);
+}
+
+static struct rtdm_driver statdev_driver = {
+	.profile_info	=	RTDM_PROFILE_INFO(statdev,
+						  RTDM_CLASS_MEMORY,
+						  RTDM_SUBCLASS_GENERIC,
+						  0),
+	.device_flags	=	RTDM_NAMED_DEVICE,
+	.device_count	=	1,
+	.ops = {
+		.open		=	statdev_open,
+		.ioctl_rt	=	statdev_ioctl_rt,
+		.ioctl_nrt	=	statdev_ioctl_nrt,
+		.mmap		=	statdev_mmap,
+	},
+};
+
+static struct rtdm_device statdev_device = {
+	.driver = &statdev_driver,
+	.label = COBALT_MEMDEV_STAT,
+};
+
+static inline int register_statdev(void)
+{
+	return rtdm_dev_register(&statdev_device);
+}
+
+static inline void unregister_statdev(void)
+{
+	rtdm_dev_unregister(&statdev_device);
+}
+
+#else /* !CONFIG_XENO_OPT_STATS */
+
+static inline int register_statdev(void)
+{
+	return 0;
+}
+
+static inline void unregister_statdev(void) { }
+
+#endif /* !CONFIG_XENO_OPT_STATS */
+
 static struct rtdm_driver umm_driver = {
 	.profile_info	=	RTDM_PROFILE_INFO(umm,
 						  RTDM_CLASS_MEMORY,
@@ -289,8 +399,14 @@ int cobalt_memdev_init(void)
 	if (ret)
 		goto fail_sysmem;
 
+	ret = register_statdev();
+	if (ret)
+		goto fail_statdev;
+
 	return 0;
 
+fail_statdev:
+	rtdm_dev_unregister(&sysmem_device);
 fail_sysmem:
 	rtdm_dev_unregister(umm_devices + UMM_SHARED);
 fail_shared:
@@ -305,6 +421,7 @@ fail_vdso:
 
 void cobalt_memdev_cleanup(void)
 {
+	unregister_statdev();
 	rtdm_dev_unregister(&sysmem_device);
 	rtdm_dev_unregister(umm_devices + UMM_SHARED);
 	rtdm_dev_unregister(umm_devices + UMM_PRIVATE);
@@ -110,6 +110,20 @@ cobalt_sched_policy_param(union xnsched_policy_param *param,
 		param->quota.tgid = param_ex->sched_quota_group;
 		sched_class = &xnsched_class_quota;
 		break;
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	case SCHED_EDF:
+		/* EDF threads are not given any priority level. */
+		if (prio)
+			return NULL;
+		param->edf.runtime = ts2ns(&param_ex->sched_edf_runtime);
+		param->edf.deadline = ts2ns(&param_ex->sched_edf_deadline);
+		param->edf.period = ts2ns(&param_ex->sched_edf_period);
+		/* Implicit deadline, if unspecified. */
+		if (param->edf.deadline == 0)
+			param->edf.deadline = param->edf.period;
+		sched_class = &xnsched_class_edf;
+		break;
 #endif
 	default:
 		return NULL;
@@ -138,6 +152,7 @@ COBALT_SYSCALL(sched_minprio, current, (int policy))
 		break;
 	case SCHED_NORMAL:
 	case SCHED_WEAK:
+	case SCHED_EDF:
 		ret = 0;
 		break;
 	default:
@@ -165,6 +180,7 @@ COBALT_SYSCALL(sched_maxprio, current, (int policy))
 		ret = XNSCHED_CORE_MAX_PRIO;
 		break;
 	case SCHED_NORMAL:
+	case SCHED_EDF:
 		ret = 0;
 		break;
 	case SCHED_WEAK:
@@ -0,0 +1,565 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#include <linux/math64.h>
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/heap.h>
+#include <cobalt/uapi/sched.h>
+
+/*
+ * With this policy, each thread reserves a runtime budget Q over a
+ * period P, and should be given that much CPU time before a
+ * relative deadline D (Q <= D <= P) following the beginning of each
+ * period. Each per-CPU scheduler slot maintains its own runqueue of
+ * EDF threads, ordered by increasing absolute deadline.
+ *
+ * The budget is enforced by a constant bandwidth server (CBS) with
+ * hard reservation:
+ *
+ * - when a thread becomes runnable, it keeps its current deadline
+ * and remaining budget unless consuming the latter before the
+ * former would exceed its density (Q / D), in which case a new job
+ * is started: deadline = now + D, budget = Q.
+ *
+ * - the runtime consumed by an outgoing thread is charged to its
+ * budget each time the core picks the next thread to run
+ * (xnsched_edf_charge()). When a thread is switched in, a timer is
+ * armed to fire when its budget would be exhausted, would it run
+ * unpreempted until then.
+ *
+ * - a thread which exhausts its budget is held (XNHELD) until the
+ * beginning of its next period, at which point a new job starts.
+ *
+ * Since all EDF threads share the same priority level, and the EDF
+ * class stacks below the built-in RT class, the PI and PP protocols
+ * still work across classes: an EDF thread may be boosted to the RT
+ * class, and a thread from a lower class blocking an EDF thread
+ * inherits the deadline of the latter. However, no inheritance
+ * takes place between EDF threads. Boosted threads and threads
+ * which have to relax run without budget enforcement.
+ *
+ * The sum of the bandwidths (Q / P) reserved on any CPU may not
+ * exceed CONFIG_XENO_OPT_SCHED_EDF_MAXBW percent. This admission
+ * test is applied each time the EDF parameters of a thread are set.
+ */
+
+#define EDF_MAX_BW	\
+	(((unsigned long)CONFIG_XENO_OPT_SCHED_EDF_MAXBW << XNSCHED_EDF_BW_SHIFT) / 100)
+
+/* Longest period we can compute a bandwidth value for. */
+#define EDF_MAX_PERIOD	(1ULL << (63 - XNSCHED_EDF_BW_SHIFT))
+
+static inline unsigned long edf_ratio(xnticks_t num, xnticks_t den)
+{
+	return (unsigned long)div64_u64(num << XNSCHED_EDF_BW_SHIFT, den);
+}
+
+static inline void edf_renew_job(struct xnsched_edf_data *edf, xnticks_t now)
+{
+	edf->deadline = now + edf->param.deadline;
+	edf->budget = edf->param.runtime;
+}
+
+static void edf_addq(struct xnthread *thread, bool head)
+{
+	struct list_head *q = &thread->sched->edf.runnable;
+	struct xnthread *pos;
+	xnsticks_t delta;
+
+	/*
+	 * Threads with equal deadlines are queued FIFO, unless @head
+	 * is set, which moves @thread ahead of them.
+	 */
+	list_for_each_entry_reverse(pos, q, rlink) {
+		delta = (xnsticks_t)(thread->edf_deadline - pos->edf_deadline);
+		if (delta > 0 || (delta == 0 && !head))
+			break;
+	}
+
+	list_add(&thread->rlink, &pos->rlink);
+}
+
+static void edf_set_key(struct xnthread *thread, xnticks_t deadline)
+{
+	if (xnthread_test_state(thread, XNREADY)) {
+		list_del(&thread->rlink);
+		thread->edf_deadline = deadline;
+		edf_addq(thread, false);
+	} else
+		thread->edf_deadline = deadline;
+}
+
+/* CBS wakeup rule. */
+static void edf_check_activation(struct xnsched_edf_data *edf)
+{
+	xnticks_t now = xnclock_read_monotonic(&nkclock);
+	xnsticks_t laxity = (xnsticks_t)(edf->deadline - now);
+	unsigned long density;
+
+	if (laxity <= 0)
+		goto renew;
+
+	density = edf_ratio(edf->param.runtime, edf->param.deadline);
+	if (edf->budget > (((xnticks_t)laxity * density) >> XNSCHED_EDF_BW_SHIFT))
+		goto renew;
+
+	return;
+renew:
+	edf_renew_job(edf, now);
+}
+
+void __xnsched_edf_charge(struct xnthread *thread)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+	xnticks_t elapsed;
+
+	xntimer_stop(&edf->drop_timer);
+	elapsed = xnclock_read_monotonic(&nkclock) - edf->run_start;
+	edf->budget = elapsed < edf->budget ? edf->budget - elapsed : 0;
+	edf->running = 0;
+}
+
+static void edf_start_account(struct xnthread *thread)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	edf->run_start = xnclock_read_monotonic(&nkclock);
+	edf->running = 1;
+	xntimer_set_affinity(&edf->drop_timer, thread->sched);
+	xntimer_start(&edf->drop_timer, edf->budget,
+		      XN_INFINITE, XN_RELATIVE);
+}
+
+static void edf_replenish_handler(struct xntimer *timer)
+{
+	struct xnsched_edf_data *edf;
+	struct xnthread *thread;
+
+	edf = container_of(timer, struct xnsched_edf_data, repl_timer);
+	thread = edf->thread;
+
+	edf->throttled = 0;
+	edf_renew_job(edf, xnclock_read_monotonic(&nkclock));
+	if (thread->sched_class == &xnsched_class_edf)
+		edf_set_key(thread, edf->deadline);
+
+	if (xnthread_test_state(thread, XNHELD))
+		xnthread_resume(thread, XNHELD);
+}
+
+static void edf_drop_handler(struct xntimer *timer)
+{
+	struct xnsched_edf_data *edf;
+	struct xnthread *thread;
+	xnticks_t next;
+	int ret;
+
+	edf = container_of(timer, struct xnsched_edf_data, drop_timer);
+	thread = edf->thread;
+
+	/* The thread ran unpreempted until its budget is exhausted. */
+	edf->budget = 0;
+	edf->running = 0;
+
+	/*
+	 * Don't throttle a thread boosted to another class, or which
+	 * has to relax asap.
+	 */
+	if (thread->sched_class != &xnsched_class_edf ||
+	    xnthread_test_info(thread, XNKICKED))
+		return;
+
+	edf->nr_throttled++;
+
+	if (!edf->throttled) {
+		/* The next job may not start before the next period. */
+		next = edf->deadline - edf->param.deadline + edf->param.period;
+		edf->throttled = 1;
+		xntimer_set_affinity(&edf->repl_timer, thread->sched);
+		ret = xntimer_start(&edf->repl_timer, next,
+				    XN_INFINITE, XN_ABSOLUTE);
+		if (ret == -ETIMEDOUT) {
+			edf_replenish_handler(&edf->repl_timer);
+			xnsched_set_resched(thread->sched);
+			return;
+		}
+	}
+
+	xnthread_suspend(thread, XNHELD, XN_INFINITE, XN_RELATIVE, NULL);
+}
+
+static void xnsched_edf_init(struct xnsched *sched)
+{
+	INIT_LIST_HEAD(&sched->edf.runnable);
+	sched->edf.bw_sum = 0;
+}
+
+int xnsched_edf_admit(struct xnthread *thread,
+		      const union xnsched_policy_param *p)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+	unsigned long bw, bw_sum;
+
+	if (p->edf.runtime == 0 ||
+	    p->edf.runtime > p->edf.deadline ||
+	    p->edf.deadline > p->edf.period ||
+	    p->edf.period >= EDF_MAX_PERIOD)
+		return -EINVAL;
+
+	bw = edf_ratio(p->edf.runtime, p->edf.period);
+	bw_sum = thread->sched->edf.bw_sum;
+	/* The reservation of a member is moving to a new value. */
+	if (edf && edf->sched == thread->sched)
+		bw_sum -= edf->bw;
+
+	if (bw_sum + bw > EDF_MAX_BW)
+		return -EBUSY;
+
+	return 0;
+}
+
+static bool xnsched_edf_setparam(struct xnthread *thread,
+				 const union xnsched_policy_param *p)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	xnthread_clear_state(thread, XNWEAK);
+
+	edf->sched->edf.bw_sum -= edf->bw;
+	edf->sched = thread->sched;
+	edf->param = p->edf;
+	edf->bw = edf_ratio(p->edf.runtime, p->edf.period);
+	edf->sched->edf.bw_sum += edf->bw;
+
+	/*
+	 * Start over with a fresh job, unless throttled, in which
+	 * case the new settings apply from the next replenishment.
+	 */
+	if (!edf->throttled) {
+		edf_renew_job(edf, xnclock_read_monotonic(&nkclock));
+		thread->edf_deadline = edf->deadline;
+	}
+
+	return xnsched_set_effective_priority(thread, XNSCHED_EDF_PRIO);
+}
+
+static void xnsched_edf_getparam(struct xnthread *thread,
+				 union xnsched_policy_param *p)
+{
+	if (thread->edf)
+		p->edf = thread->edf->param;
+	else
+		memset(&p->edf, 0, sizeof(p->edf));
+
+	p->edf.current_deadline = thread->edf_deadline;
+}
+
+static void xnsched_edf_trackprio(struct xnthread *thread,
+				  const union xnsched_policy_param *p)
+{
+	if (p) {
+		/* Inherit the deadline of the thread we block. */
+		thread->cprio = XNSCHED_EDF_PRIO;
+		thread->edf_deadline = p->edf.current_deadline;
+	} else {
+		thread->cprio = thread->bprio;
+		if (thread->edf)
+			thread->edf_deadline = thread->edf->deadline;
+	}
+}
+
+static void xnsched_edf_protectprio(struct xnthread *thread, int prio)
+{
+	/* PP boosts always move threads to the RT class. */
+	thread->cprio = XNSCHED_EDF_PRIO;
+}
+
+static int xnsched_edf_declare(struct xnthread *thread,
+			       const union xnsched_policy_param *p)
+{
+	struct xnsched_edf_data *edf;
+	int ret;
+
+	ret = xnsched_edf_admit(thread, p);
+	if (ret)
+		return ret;
+
+	edf = xnmalloc(sizeof(*edf));
+	if (edf == NULL)
+		return -ENOMEM;
+
+	memset(edf, 0, sizeof(*edf));
+	xntimer_init(&edf->drop_timer, &nkclock, edf_drop_handler,
+		     thread->sched, XNTIMER_IGRAVITY);
+	xntimer_set_name(&edf->drop_timer, "edf-drop");
+	xntimer_init(&edf->repl_timer, &nkclock, edf_replenish_handler,
+		     thread->sched, XNTIMER_IGRAVITY);
+	xntimer_set_name(&edf->repl_timer, "edf-replenish");
+	edf->thread = thread;
+	edf->sched = thread->sched;
+	thread->edf = edf;
+
+	return 0;
+}
+
+static void xnsched_edf_forget(struct xnthread *thread)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	edf->sched->edf.bw_sum -= edf->bw;
+	xntimer_destroy(&edf->drop_timer);
+	xntimer_destroy(&edf->repl_timer);
+
+	/*
+	 * A throttled thread leaving the class is released
+	 * immediately; xnsched_set_policy() queues it to its new
+	 * class if runnable.
+	 */
+	if (edf->throttled && xnthread_test_state(thread, XNHELD)) {
+		xnthread_clear_state(thread, XNHELD);
+		if (!xnthread_test_state(thread, XNTHREAD_BLOCK_BITS))
+			xnthread_set_state(thread, XNREADY);
+	}
+
+	xnfree(edf);
+	thread->edf = NULL;
+}
+
+static void xnsched_edf_enqueue(struct xnthread *thread)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	if (edf && !edf->throttled) {
+		edf_check_activation(edf);
+		thread->edf_deadline = edf->deadline;
+	}
+
+	edf_addq(thread, false);
+}
+
+static void xnsched_edf_dequeue(struct xnthread *thread)
+{
+	list_del(&thread->rlink);
+}
+
+static void xnsched_edf_requeue(struct xnthread *thread)
+{
+	edf_addq(thread, true);
+}
+
+static struct xnthread *xnsched_edf_pick(struct xnsched *sched)
+{
+	struct list_head *q = &sched->edf.runnable;
+	struct xnthread *next;
+
+	if (list_empty(q))
+		return NULL;
+
+	next = list_get_entry(q, struct xnthread, rlink);
+
+	/*
+	 * Threads inheriting a deadline, kicked threads and members
+	 * which were forcibly unblocked while throttled run with no
+	 * budget enforcement.
+	 */
+	if (next->edf && next->edf->budget > 0 &&
+	    !xnthread_test_info(next, XNKICKED))
+		edf_start_account(next);
+
+	return next;
+}
+
+static void xnsched_edf_migrate(struct xnthread *thread, struct xnsched *sched)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	/*
+	 * The reservation follows the thread, regardless of the
+	 * bandwidth already reserved on the destination CPU.
+	 */
+	if (edf) {
+		edf->sched->edf.bw_sum -= edf->bw;
+		edf->sched = sched;
+		sched->edf.bw_sum += edf->bw;
+	}
+}
+
+static void xnsched_edf_kick(struct xnthread *thread)
+{
+	struct xnsched_edf_data *edf = thread->edf;
+
+	/* Release a throttled thread, so that it may relax. */
+	if (edf->throttled && xnthread_test_state(thread, XNHELD))
+		xnthread_resume(thread, XNHELD);
+}
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+struct xnvfile_directory sched_edf_vfroot;
+
+struct vfile_sched_edf_priv {
+	struct xnthread *curr;
+};
+
+struct vfile_sched_edf_data {
+	int cpu;
+	pid_t pid;
+	xnticks_t runtime;
+	xnticks_t deadline;
+	xnticks_t period;
+	unsigned long bw;
+	unsigned long nr_throttled;
+	char name[XNOBJECT_NAME_LEN];
+};
+
+static struct xnvfile_snapshot_ops vfile_sched_edf_ops;
+
+static struct xnvfile_snapshot vfile_sched_edf = {
+	.privsz = sizeof(struct vfile_sched_edf_priv),
+	.datasz = sizeof(struct vfile_sched_edf_data),
+	.tag = &nkthreadlist_tag,
+	.ops = &vfile_sched_edf_ops,
+};
+
+static int vfile_sched_edf_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct vfile_sched_edf_priv *priv = xnvfile_iterator_priv(it);
+	int nrthreads = xnsched_class_edf.nthreads;
+
+	if (nrthreads == 0)
+		return -ESRCH;
+
+	priv->curr = list_first_entry(&nkthreadq, struct xnthread, glink);
+
+	return nrthreads;
+}
+
+static int vfile_sched_edf_next(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	struct vfile_sched_edf_priv *priv = xnvfile_iterator_priv(it);
+	struct vfile_sched_edf_data *p = data;
+	struct xnthread *thread;
+
+	if (priv->curr == NULL)
+		return 0;	/* All done. */
+
+	thread = priv->curr;
+	if (list_is_last(&thread->glink, &nkthreadq))
+		priv->curr = NULL;
+	else
+		priv->curr = list_next_entry(thread, glink);
+
+	if (thread->base_class != &xnsched_class_edf)
+		return VFILE_SEQ_SKIP;
+
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_host_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	p->runtime = thread->edf->param.runtime;
+	p->deadline = thread->edf->param.deadline;
+	p->period = thread->edf->param.period;
+	p->bw = thread->edf->bw;
+	p->nr_throttled = thread->edf->nr_throttled;
+
+	return 1;
+}
+
+static int vfile_sched_edf_show(struct xnvfile_snapshot_iterator *it,
+				void *data)
+{
+	char rtbuf[16], dlbuf[16], ptbuf[16];
+	struct vfile_sched_edf_data *p = data;
+	unsigned long permil;
+
+	if (p == NULL)
+		xnvfile_printf(it,
+			       "%-3s  %-6s %-10s %-10s %-10s %-6s %-8s %s\n",
+			       "CPU", "PID", "RUNTIME", "DEADLINE", "PERIOD",
+			       "BW%", "THROTTLE", "NAME");
+	else {
+		xntimer_format_time(p->runtime, rtbuf, sizeof(rtbuf));
+		xntimer_format_time(p->deadline, dlbuf, sizeof(dlbuf));
+		xntimer_format_time(p->period, ptbuf, sizeof(ptbuf));
+		permil = (p->bw * 1000) >> XNSCHED_EDF_BW_SHIFT;
+
+		xnvfile_printf(it,
+			       "%3u  %-6d %-10s %-10s %-10s %3lu.%lu %-8lu %s\n",
+			       p->cpu,
+			       p->pid,
+			       rtbuf,
+			       dlbuf,
+			       ptbuf,
+			       permil / 10, permil % 10,
+			       p->nr_throttled,
+			       p->name);
+	}
+
+	return 0;
+}
+
+static struct xnvfile_snapshot_ops vfile_sched_edf_ops = {
+	.rewind = vfile_sched_edf_rewind,
+	.next = vfile_sched_edf_next,
+	.show = vfile_sched_edf_show,
+};
+
+static int xnsched_edf_init_vfile(struct xnsched_class *schedclass,
+				  struct xnvfile_directory *vfroot)
+{
+	int ret;
+
+	ret = xnvfile_init_dir(schedclass->name, &sched_edf_vfroot, vfroot);
+	if (ret)
+		return ret;
+
+	return xnvfile_init_snapshot("threads", &vfile_sched_edf,
+				     &sched_edf_vfroot);
+}
+
+static void xnsched_edf_cleanup_vfile(struct xnsched_class *schedclass)
+{
+	xnvfile_destroy_snapshot(&vfile_sched_edf);
+	xnvfile_destroy_dir(&sched_edf_vfroot);
+}
+
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+struct xnsched_class xnsched_class_edf = {
+	.sched_init		=	xnsched_edf_init,
+	.sched_enqueue		=	xnsched_edf_enqueue,
+	.sched_dequeue		=	xnsched_edf_dequeue,
+	.sched_requeue		=	xnsched_edf_requeue,
+	.sched_pick		=	xnsched_edf_pick,
+	.sched_tick		=	NULL,
+	.sched_rotate		=	NULL,
+	.sched_migrate		=	xnsched_edf_migrate,
+	.sched_setparam		=	xnsched_edf_setparam,
+	.sched_getparam		=	xnsched_edf_getparam,
+	.sched_trackprio	=	xnsched_edf_trackprio,
+	.sched_protectprio	=	xnsched_edf_protectprio,
+	.sched_declare		=	xnsched_edf_declare,
+	.sched_forget		=	xnsched_edf_forget,
+	.sched_kick		=	xnsched_edf_kick,
+#ifdef CONFIG_XENO_OPT_VFILE
+	.sched_init_vfile	=	xnsched_edf_init_vfile,
+	.sched_cleanup_vfile	=	xnsched_edf_cleanup_vfile,
+#endif
+	.weight			=	XNSCHED_CLASS_WEIGHT(3),
+	.policy			=	SCHED_EDF,
+	.name			=	"edf"
+};
+EXPORT_SYMBOL_GPL(xnsched_class_edf);
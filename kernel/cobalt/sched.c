@@ -42,6 +42,10 @@ EXPORT_PER_CPU_SYMBOL_GPL(nksched);
 cpumask_t cobalt_cpu_affinity = CPU_MASK_ALL;
 EXPORT_SYMBOL_GPL(cobalt_cpu_affinity);
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+cpumask_t xnsched_cluster_cpus = CPU_MASK_ALL;
+#endif
+
 LIST_HEAD(nkthreadq);
 
 int cobalt_nrthreads;
@@ -84,6 +88,9 @@ void xnsched_register_classes(void)
 #endif
 #ifdef CONFIG_XENO_OPT_SCHED_QUOTA
 	xnsched_register_class(&xnsched_class_quota);
+#endif
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	xnsched_register_class(&xnsched_class_edf);
 #endif
 	xnsched_register_class(&xnsched_class_rt);
 }
@@ -178,6 +185,9 @@ void xnsched_init(struct xnsched *sched, int cpu)
 	sched->lflags = XNIDLE;
 	sched->inesting = 0;
 	sched->curr = &sched->rootcb;
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	sched->nr_runnable = 0;
+#endif
 
 	attr.flags = XNROOT | XNFPU;
 	attr.name = root_name;
@@ -210,6 +220,7 @@ void xnsched_init(struct xnsched *sched, int cpu)
 	xnthread_init_root_tcb(&sched->rootcb);
 	list_add_tail(&sched->rootcb.glink, &nkthreadq);
 	cobalt_nrthreads++;
+	xnstat_attach_record(&sched->rootcb);
 
 #ifdef CONFIG_XENO_OPT_WATCHDOG
 	xntimer_init(&sched->wdtimer, &nkclock, watchdog_handler,
@@ -268,6 +279,9 @@ struct xnthread *xnsched_pick_next(struct xnsched *sched)
 		}
 	}
 
+	/* Charge the runtime consumed by an outgoing EDF thread. */
+	xnsched_edf_charge(curr);
+
 	/*
 	 * Find the runnable thread having the highest priority among
 	 * all scheduling classes, scanned by decreasing priority.
@@ -395,6 +409,17 @@ int xnsched_set_policy(struct xnthread *thread,
 		if (ret)
 			return ret;
 	}
+#ifdef CONFIG_XENO_OPT_SCHED_EDF
+	/*
+	 * EDF reservations are subject to admission control each
+	 * time they change, not only when joining the class.
+	 */
+	else if (sched_class == &xnsched_class_edf) {
+		ret = xnsched_edf_admit(thread, p);
+		if (ret)
+			return ret;
+	}
+#endif
 
 	/*
 	 * As a special case, we may be called from __xnthread_init()
@@ -557,6 +582,10 @@ static void migrate_thread(struct xnthread *thread, struct xnsched *sched)
 	 * WARNING: the scheduling class may have just changed as a
 	 * result of calling the per-class migration hook.
 	 */
+	if (!xnthread_test_state(thread, XNTHREAD_BLOCK_BITS)) {
+		xnsched_cluster_account(thread->sched, -1);
+		xnsched_cluster_account(sched, 1);
+	}
 	thread->sched = sched;
 }
 
@@ -596,6 +625,56 @@ void xnsched_migrate_passive(struct xnthread *thread, struct xnsched *sched)
 	}
 }
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+
+/*
+ * Pick the CPU slot @thread should move to from @from, among the
+ * clustered CPUs it has affinity with, which its host task is
+ * also @allowed to run on. The thread leaves @from only for a slot
+ * with fewer runnable threads, and which does not run any thread
+ * it could not preempt right now. Since Cobalt may not move a
+ * thread to another CPU while it runs in primary mode, this is
+ * called on the way to hardening, the actual migration being
+ * carried out by the host kernel. @thread is blocked at this
+ * point, so it does not weigh on the load of @from.
+ */
+struct xnsched *xnsched_cluster_select(struct xnthread *thread,
+				       struct xnsched *from,
+				       const struct cpumask *allowed)
+{
+	struct xnsched *sched, *best = from;
+	int cpu, load, best_load;
+	spl_t s;
+
+	if (!cpumask_test_cpu(xnsched_cpu(from), &xnsched_cluster_cpus))
+		return from;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	best_load = from->nr_runnable;
+
+	for_each_cpu(cpu, &xnsched_cluster_cpus) {
+		if (!cpumask_test_cpu(cpu, &thread->affinity) ||
+		    !cpumask_test_cpu(cpu, allowed) ||
+		    !xnsched_supported_cpu(cpu))
+			continue;
+		sched = xnsched_struct(cpu);
+		if (sched == from || sched->curr->wprio >= thread->wprio)
+			continue;
+		load = sched->nr_runnable;
+		if (load < best_load) {
+			best = sched;
+			best_load = load;
+		}
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return best;
+}
+
+#endif /* CONFIG_XENO_OPT_SCHED_CLUSTER */
+
 #ifdef CONFIG_XENO_OPT_SCALABLE_SCHED
 
 void xnsched_initq(struct xnsched_mlq *q)
@@ -955,6 +1034,7 @@ reschedule:
 
 	xnstat_exectime_switch(sched, &next->stat.account);
 	xnstat_counter_inc(&next->stat.csw);
+	xnthread_publish_stat(prev);
 
 	switch_context(sched, prev, next);
 
@@ -1444,6 +1524,66 @@ static struct xnvfile_regular affinity_vfile = {
 	.ops = &affinity_vfile_ops,
 };
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+
+static int cluster_vfile_show(struct xnvfile_regular_iterator *it,
+			      void *data)
+{
+	unsigned long val = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < BITS_PER_LONG; cpu++)
+		if (cpumask_test_cpu(cpu, &xnsched_cluster_cpus))
+			val |= (1UL << cpu);
+
+	xnvfile_printf(it, "%08lx\n", val);
+
+	return 0;
+}
+
+static ssize_t cluster_vfile_store(struct xnvfile_input *input)
+{
+	cpumask_t cluster;
+	ssize_t ret;
+	long val;
+	int cpu;
+	spl_t s;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val == 0)
+		cluster = xnsched_realtime_cpus; /* Reset to default. */
+	else {
+		cpumask_clear(&cluster);
+		for (cpu = 0; cpu < BITS_PER_LONG; cpu++, val >>= 1) {
+			if (val & 1)
+				cpumask_set_cpu(cpu, &cluster);
+		}
+		cpumask_and(&cluster, &cluster, &xnsched_realtime_cpus);
+		if (cpumask_empty(&cluster))
+			return -EINVAL;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	xnsched_cluster_cpus = cluster;
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops cluster_vfile_ops = {
+	.show = cluster_vfile_show,
+	.store = cluster_vfile_store,
+};
+
+static struct xnvfile_regular cluster_vfile = {
+	.ops = &cluster_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_SCHED_CLUSTER */
+
 #endif /* CONFIG_SMP */
 
 int xnsched_init_proc(void)
@@ -1479,6 +1619,9 @@ int xnsched_init_proc(void)
 #ifdef CONFIG_SMP
 	xnvfile_init_regular("affinity", &affinity_vfile, &cobalt_vfroot);
 #endif /* CONFIG_SMP */
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	xnvfile_init_regular("cluster", &cluster_vfile, &sched_vfroot);
+#endif /* CONFIG_XENO_OPT_SCHED_CLUSTER */
 
 	return 0;
 }
@@ -1492,6 +1635,9 @@ void xnsched_cleanup_proc(void)
 			p->sched_cleanup_vfile(p);
 	}
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	xnvfile_destroy_regular(&cluster_vfile);
+#endif /* CONFIG_XENO_OPT_SCHED_CLUSTER */
 #ifdef CONFIG_SMP
 	xnvfile_destroy_regular(&affinity_vfile);
 #endif /* CONFIG_SMP */
@@ -0,0 +1,166 @@
+/*
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#include <linux/vmalloc.h>
+#include <linux/bitmap.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/thread.h>
+#include <cobalt/kernel/clock.h>
+#include <cobalt/kernel/stat.h>
+#include <cobalt/uapi/kernel/stat.h>
+
+/**
+ * @ingroup cobalt_core_stat
+ *
+ * The binary statistics area mirrors the per-thread counters into
+ * an array of fixed-size records, which user-space may map
+ * read-only via the COBALT_MEMDEV_STAT device. Unlike the
+ * /proc/xenomai/sched/{stat,acct} snapshots, sampling this area
+ * involves neither formatting nor grabbing the nklock.
+ *
+ * Records are refreshed when the thread they describe is switched
+ * out, so the figures of a thread which is currently running may lag
+ * by one scheduling period.
+ *
+ * @{
+ */
+
+static struct xnstat_area *statarea;
+
+static size_t statarea_size;
+
+static unsigned long *statmap;
+
+static __u32 statserial;
+
+int xnstat_init_area(void)
+{
+	int nr = CONFIG_XENO_OPT_STATS_RECORDS;
+
+	statarea_size = PAGE_ALIGN(sizeof(*statarea) +
+				   nr * sizeof(struct xnstat_record));
+	statarea = __vmalloc(statarea_size, GFP_KERNEL|__GFP_ZERO,
+			     xnarch_cache_aliasing() ?
+			     pgprot_noncached(PAGE_KERNEL) : PAGE_KERNEL);
+	if (statarea == NULL)
+		return -ENOMEM;
+
+	statmap = kzalloc(BITS_TO_LONGS(nr) * sizeof(long), GFP_KERNEL);
+	if (statmap == NULL) {
+		vfree(statarea);
+		statarea = NULL;
+		return -ENOMEM;
+	}
+
+	statarea->nr_records = nr;
+	statarea->record_size = sizeof(struct xnstat_record);
+	statarea->clock_freq = cobalt_pipeline.clock_freq;
+	smp_wmb();
+	statarea->magic = XNSTAT_AREA_MAGIC;
+
+	return 0;
+}
+
+void xnstat_cleanup_area(void)
+{
+	kfree(statmap);
+	vfree(statarea);
+	statarea = NULL;
+}
+
+void *xnstat_get_area(size_t *size_r)
+{
+	*size_r = statarea_size;
+
+	return statarea;
+}
+
+static inline void fill_record(struct xnstat_record *rec,
+			       struct xnthread *thread)
+{
+	rec->cpu = xnsched_cpu(thread->sched);
+	rec->state = xnthread_get_state(thread);
+	if (thread->lock_count > 0)
+		rec->state |= XNLOCK;
+	rec->cprio = thread->cprio;
+	rec->ssw = xnstat_counter_get(&thread->stat.ssw);
+	rec->csw = xnstat_counter_get(&thread->stat.csw);
+	rec->xsc = xnstat_counter_get(&thread->stat.xsc);
+	rec->pf = xnstat_counter_get(&thread->stat.pf);
+	rec->tmo = xnstat_counter_get(&thread->stat.tmo);
+	rec->exectime = xnstat_exectime_get_total(&thread->stat.account);
+	rec->date = xnstat_exectime_get_last_switch(thread->sched);
+}
+
+/* nklock held, irqs off */
+void xnstat_attach_record(struct xnthread *thread)
+{
+	struct xnstat_record *rec;
+	urwstate_t tmp;
+	int slot;
+
+	if (statarea == NULL)
+		return;
+
+	slot = find_first_zero_bit(statmap, statarea->nr_records);
+	if (slot >= statarea->nr_records) {
+		statarea->missed++;
+		return;
+	}
+
+	__set_bit(slot, statmap);
+	rec = statarea->records + slot;
+	thread->stat.record = rec;
+
+	unsynced_write_block(&tmp, &rec->lock) {
+		if (++statserial == 0)
+			statserial = 1;
+		rec->serial = statserial;
+		rec->pid = xnthread_host_pid(thread);
+		memcpy(rec->name, thread->name, sizeof(rec->name));
+		fill_record(rec, thread);
+	}
+}
+
+/* nklock held, irqs off */
+void xnstat_detach_record(struct xnthread *thread)
+{
+	struct xnstat_record *rec = thread->stat.record;
+	urwstate_t tmp;
+
+	if (rec == NULL)
+		return;
+
+	unsynced_write_block(&tmp, &rec->lock)
+		rec->serial = 0;
+
+	__clear_bit(rec - statarea->records, statmap);
+	thread->stat.record = NULL;
+}
+
+/* nklock held, irqs off */
+void __xnstat_publish(struct xnthread *thread)
+{
+	struct xnstat_record *rec = thread->stat.record;
+	urwstate_t tmp;
+
+	unsynced_write_block(&tmp, &rec->lock)
+		fill_record(rec, thread);
+}
+
+/** @} */
@@ -55,6 +55,8 @@ static void timeout_handler(struct xntimer *timer)
 	struct xnthread *thread = container_of(timer, struct xnthread, rtimer);
 
 	xnthread_set_info(thread, XNTIMEO);	/* Interrupts are off. */
+	if (xnthread_test_state(thread, XNPEND))
+		xnstat_counter_inc(&thread->stat.tmo);
 	xnthread_resume(thread, XNDELAY);
 }
 
@@ -80,6 +82,7 @@ static inline void enlist_new_thread(struct xnthread *thread)
 	list_add_tail(&thread->glink, &nkthreadq);
 	cobalt_nrthreads++;
 	xnvfile_touch_tag(&nkthreadlist_tag);
+	xnstat_attach_record(thread);
 }
 
 struct kthread_arg {
@@ -474,7 +477,10 @@ static inline void cleanup_tcb(struct xnthread *curr) /* nklock held, irqs off *
 
 	list_del(&curr->glink);
 	cobalt_nrthreads--;
+	if (!xnthread_test_state(curr, XNTHREAD_BLOCK_BITS))
+		xnsched_cluster_account(sched, -1);
 	xnvfile_touch_tag(&nkthreadlist_tag);
+	xnstat_detach_record(curr);
 
 	if (xnthread_test_state(curr, XNREADY)) {
 		XENO_BUG_ON(COBALT, xnthread_test_state(curr, XNTHREAD_BLOCK_BITS));
@@ -549,7 +555,10 @@ void __xnthread_discard(struct xnthread *thread)
 	if (!list_empty(&thread->glink)) {
 		list_del(&thread->glink);
 		cobalt_nrthreads--;
+		if (!xnthread_test_state(thread, XNTHREAD_BLOCK_BITS))
+			xnsched_cluster_account(thread->sched, -1);
 		xnvfile_touch_tag(&nkthreadlist_tag);
+		xnstat_detach_record(thread);
 	}
 	xnthread_deregister(thread);
 	xnlock_put_irqrestore(&nklock, s);
@@ -934,6 +943,7 @@ void xnthread_suspend(struct xnthread *thread, int mask,
 			if (wchan) {
 				thread->wchan = wchan;
 				xnsynch_forget_sleeper(thread);
+				xnstat_counter_inc(&thread->stat.tmo);
 			}
 			xnthread_set_info(thread, XNTIMEO);
 			goto out;
@@ -946,6 +956,9 @@ void xnthread_suspend(struct xnthread *thread, int mask,
 		xnthread_clear_state(thread, XNREADY);
 	}
 
+	if ((oldstate & XNTHREAD_BLOCK_BITS) == 0)
+		xnsched_cluster_account(sched, -1);
+
 	xnthread_set_state(thread, mask);
 
 	/*
@@ -1166,6 +1179,8 @@ recheck_state:
 		goto unlock_and_exit;
 
 clear_wchan:
+	xnsched_cluster_account(sched, 1);
+
 	if ((mask & ~XNDELAY) != 0 && thread->wchan != NULL)
 		/*
 		 * If the thread was actually suspended, clear the
@@ -1941,6 +1956,25 @@ int xnthread_harden(void)
 
 	trace_cobalt_shadow_gohard(thread);
 
+#ifdef CONFIG_XENO_OPT_SCHED_CLUSTER
+	/*
+	 * Move to a less loaded CPU of the cluster if need be, among
+	 * those our host task may run on. The host kernel migrates
+	 * us right away, after which the original CPU mask is
+	 * restored, so that user-defined affinity is preserved;
+	 * check_affinity() then reflects the move into the Cobalt
+	 * scheduler state.
+	 */
+	sched = xnsched_cluster_select(thread, thread->sched,
+				       tsk_cpus_allowed(p));
+	if (sched != thread->sched) {
+		cpumask_t allowed = *tsk_cpus_allowed(p);
+
+		set_cpus_allowed_ptr(p, cpumask_of(xnsched_cpu(sched)));
+		set_cpus_allowed_ptr(p, &allowed);
+	}
+#endif
+
 	xnthread_clear_sync_window(thread, XNRELAX);
 
 	ret = __ipipe_migrate_head();
@@ -2404,6 +2438,11 @@ void xnthread_pin_initial(struct xnthread *thread)
 	if (!cpumask_test_cpu(cpu, &thread->affinity))
 		cpu = cpumask_first(&thread->affinity);
 
+	/* Clustered CPUs may pick a less loaded one though. */
+	sched = xnsched_cluster_select(thread, xnsched_struct(cpu),
+				       tsk_cpus_allowed(p));
+	cpu = xnsched_cpu(sched);
+
 	set_cpus_allowed_ptr(p, cpumask_of(cpu));
 	/*
 	 * @thread is still unstarted Xenomai-wise, we are precisely
@@ -200,6 +200,7 @@ DECLARE_EVENT_CLASS(syscall_exit,
 			 {SCHED_RR, "rr"},			\
 			 {SCHED_TP, "tp"},			\
 			 {SCHED_QUOTA, "quota"},		\
+			 {SCHED_EDF, "edf"},			\
 			 {SCHED_SPORADIC, "sporadic"},		\
 			 {SCHED_COBALT, "cobalt"},		\
 			 {SCHED_WEAK, "weak"},			\
@@ -22,6 +22,7 @@
 #include <linux/irq.h>
 #include <linux/slab.h>
 #include <linux/err.h>
+#include <linux/log2.h>
 #include <rtdm/gpio.h>
 
 struct rtdm_gpio_chan {
@@ -35,17 +36,165 @@ static LIST_HEAD(rtdm_gpio_chips);
 
 static DEFINE_MUTEX(chip_lock);
 
+/*
+ * The event ring belongs to the pin, but only the fd which set it up
+ * (pin->ev_owner) may read from, resize or release it.
+ *
+ * The producer side, i.e. the interrupt handler or
+ * rtdm_gpiochip_post_event(), owns ev_head and never overwrites a
+ * record which was not consumed yet. pin->ev_lock only serializes
+ * producers with each other and with ring swaps, readers never take
+ * it: they copy records out without locking, then claim them by
+ * moving ev_tail forward with cmpxchg(), starting over if another
+ * reader of the same fd won the race. Readers are counted in
+ * pin->ev_readers while they access the ring, which is detached
+ * first, then freed only once they are all gone.
+ */
+static void push_pin_event(struct rtdm_gpio_pin *pin)
+{
+	struct rtdm_gpio_event *ev;
+	unsigned int head, tail;
+	rtdm_lockctx_t s;
+
+	rtdm_lock_get_irqsave(&pin->ev_lock, s);
+
+	if (pin->events == NULL)
+		goto out;
+
+	head = pin->ev_head;
+	tail = READ_ONCE(pin->ev_tail);
+	if (head - tail > pin->ev_mask) {
+		pin->ev_overruns++;
+		pin->ev_seq++;
+		goto out;
+	}
+
+	/* Readers are done with this slot once ev_tail moved past it. */
+	smp_mb();
+	ev = pin->events + (head & pin->ev_mask);
+	ev->timestamp = rtdm_clock_read_monotonic();
+	ev->seq = pin->ev_seq++;
+	ev->value = gpiod_get_raw_value(pin->desc);
+	smp_wmb();
+	WRITE_ONCE(pin->ev_head, head + 1);
+out:
+	rtdm_lock_put_irqrestore(&pin->ev_lock, s);
+}
+
+static int pull_pin_events(struct rtdm_gpio_pin *pin,
+			   struct rtdm_gpio_chan *chan,
+			   struct rtdm_gpio_event *batch,
+			   unsigned int max)
+{
+	struct rtdm_gpio_event *events;
+	unsigned int head, tail, mask;
+	int count, n;
+
+	atomic_inc(&pin->ev_readers);
+	smp_mb__after_atomic();
+
+	events = READ_ONCE(pin->events);
+	if (events == NULL) {
+		/* Being resized by the owner, or released. */
+		count = pin->ev_owner == chan ? 0 : -EIDRM;
+		goto out;
+	}
+
+	smp_rmb();
+	mask = pin->ev_mask;
+
+	do {
+		tail = READ_ONCE(pin->ev_tail);
+		head = READ_ONCE(pin->ev_head);
+		smp_rmb();
+		count = min(head - tail, max);
+		for (n = 0; n < count; n++)
+			batch[n] = events[(tail + n) & mask];
+	} while (count > 0 &&
+		 cmpxchg(&pin->ev_tail, tail, tail + count) != tail);
+out:
+	smp_mb__before_atomic();
+	atomic_dec(&pin->ev_readers);
+
+	return count;
+}
+
 static int gpio_pin_interrupt(rtdm_irq_t *irqh)
 {
 	struct rtdm_gpio_pin *pin;
 
 	pin = rtdm_irq_get_arg(irqh, struct rtdm_gpio_pin);
 
+	push_pin_event(pin);
 	rtdm_event_signal(&pin->event);
 
 	return RTDM_IRQ_HANDLED;
 }
 
+static struct rtdm_gpio_event *
+swap_pin_events(struct rtdm_gpio_pin *pin, struct rtdm_gpio_chan *owner,
+		struct rtdm_gpio_event *events, int depth)
+{
+	struct rtdm_gpio_event *old;
+	rtdm_lockctx_t s;
+
+	/* Detach the current ring, then wait for its readers to leave. */
+	rtdm_lock_get_irqsave(&pin->ev_lock, s);
+	old = pin->events;
+	pin->events = NULL;
+	rtdm_lock_put_irqrestore(&pin->ev_lock, s);
+
+	smp_mb();
+	while (atomic_read(&pin->ev_readers))
+		cpu_relax();
+
+	rtdm_lock_get_irqsave(&pin->ev_lock, s);
+	pin->ev_owner = owner;
+	pin->ev_mask = depth - 1;
+	pin->ev_head = 0;
+	pin->ev_tail = 0;
+	pin->ev_seq = 0;
+	pin->ev_overruns = 0;
+	smp_wmb();
+	pin->events = events;
+	rtdm_lock_put_irqrestore(&pin->ev_lock, s);
+
+	return old;
+}
+
+static int setup_pin_events(struct rtdm_gpio_pin *pin,
+			    struct rtdm_gpio_chan *chan, int depth)
+{
+	struct rtdm_gpio_event *events = NULL;
+
+	if (chan->is_interrupt)
+		return -EBUSY;
+
+	if (depth < 0 || depth > GPIO_EVENTS_MAX)
+		return -EINVAL;
+
+	if (pin->ev_owner && pin->ev_owner != chan)
+		return -EBUSY;
+
+	if (depth > 0) {
+		depth = roundup_pow_of_two(depth);
+		events = kmalloc(depth * sizeof(*events), GFP_KERNEL);
+		if (events == NULL)
+			return -ENOMEM;
+	}
+
+	kfree(swap_pin_events(pin, events ? chan : NULL, events, depth));
+
+	return 0;
+}
+
+static void release_pin_events(struct rtdm_gpio_pin *pin,
+			       struct rtdm_gpio_chan *chan)
+{
+	if (pin->ev_owner == chan)
+		kfree(swap_pin_events(pin, NULL, NULL, 0));
+}
+
 static int request_gpio_irq(unsigned int gpio, struct rtdm_gpio_pin *pin,
 			    struct rtdm_gpio_chan *chan,
 			    int trigger)
@@ -132,11 +281,40 @@ static void release_gpio_irq(unsigned int gpio, struct rtdm_gpio_pin *pin,
 	chan->requested = false;
 }
 
+/*
+ * Track the fds driving a pin as an output, the bank device may only
+ * drive the pin while at least one of them does.
+ */
+static void set_pin_output(struct rtdm_gpio_chip *rgc,
+			   struct rtdm_gpio_pin *pin,
+			   struct rtdm_gpio_chan *chan, bool output)
+{
+	unsigned int offset = pin - rgc->pins;
+	rtdm_lockctx_t s;
+
+	rtdm_lock_get_irqsave(&rgc->lock, s);
+
+	if (output && !chan->is_output)
+		pin->nr_outputs++;
+	else if (!output && chan->is_output)
+		pin->nr_outputs--;
+
+	chan->is_output = output;
+
+	if (output)
+		set_bit(offset, rgc->outputs);
+	else if (pin->nr_outputs == 0)
+		clear_bit(offset, rgc->outputs);
+
+	rtdm_lock_put_irqrestore(&rgc->lock, s);
+}
+
 static int gpio_pin_ioctl_nrt(struct rtdm_fd *fd,
 			      unsigned int request, void *arg)
 {
 	struct rtdm_gpio_chan *chan = rtdm_fd_to_private(fd);
 	struct rtdm_device *dev = rtdm_fd_device(fd);
+	struct rtdm_gpio_chip *rgc = dev->device_data;
 	unsigned int gpio = rtdm_fd_minor(fd);
 	int ret = 0, val, trigger;
 	struct rtdm_gpio_pin *pin;
@@ -151,13 +329,15 @@ static int gpio_pin_ioctl_nrt(struct rtdm_fd *fd,
 		ret = gpio_direction_output(gpio, val);
 		if (ret == 0) {
 			chan->has_direction = true;
-			chan->is_output = true;
+			set_pin_output(rgc, pin, chan, true);
 		}
 		break;
 	case GPIO_RTIOC_DIR_IN:
 		ret = gpio_direction_input(gpio);
-		if (ret == 0)
+		if (ret == 0) {
 			chan->has_direction = true;
+			set_pin_output(rgc, pin, chan, false);
+		}
 		break;
 	case GPIO_RTIOC_IRQEN:
 		if (chan->is_interrupt) {
@@ -167,6 +347,7 @@ static int gpio_pin_ioctl_nrt(struct rtdm_fd *fd,
 					       arg, sizeof(trigger));
 		if (ret)
 			return ret;
+		set_pin_output(rgc, pin, chan, false);
 		ret = request_gpio_irq(gpio, pin, chan, trigger);
 		break;
 	case GPIO_RTIOC_IRQDIS:
@@ -187,6 +368,12 @@ static int gpio_pin_ioctl_nrt(struct rtdm_fd *fd,
 		gpio_free(gpio);
 		chan->requested = false;
 		break;
+	case GPIO_RTIOC_EVENTS:
+		ret = rtdm_safe_copy_from_user(fd, &val, arg, sizeof(val));
+		if (ret)
+			return ret;
+		ret = setup_pin_events(pin, chan, val);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -194,6 +381,77 @@ static int gpio_pin_ioctl_nrt(struct rtdm_fd *fd,
 	return ret;
 }
 
+static int gpio_pin_ioctl_rt(struct rtdm_fd *fd,
+			     unsigned int request, void *arg)
+{
+	struct rtdm_gpio_chan *chan = rtdm_fd_to_private(fd);
+	struct rtdm_device *dev = rtdm_fd_device(fd);
+	struct rtdm_gpio_evstat stat;
+	struct rtdm_gpio_pin *pin;
+	unsigned int tail;
+
+	pin = container_of(dev, struct rtdm_gpio_pin, dev);
+
+	switch (request) {
+	case GPIO_RTIOC_EVSTAT:
+		if (pin->ev_owner != chan)
+			return -EINVAL;
+		tail = READ_ONCE(pin->ev_tail);
+		smp_rmb();
+		stat.pending = min(READ_ONCE(pin->ev_head) - tail,
+				   pin->ev_mask + 1);
+		stat.overruns = READ_ONCE(pin->ev_overruns);
+		return rtdm_safe_copy_to_user(fd, arg, &stat, sizeof(stat));
+	default:
+		return -ENOSYS;
+	}
+}
+
+/* Records claimed at once, bounds the retry cost on contention. */
+#define GPIO_EVENTS_BATCH	16
+
+static ssize_t read_pin_events(struct rtdm_fd *fd, struct rtdm_gpio_pin *pin,
+			       void __user *buf, size_t len)
+{
+	struct rtdm_gpio_chan *chan = rtdm_fd_to_private(fd);
+	struct rtdm_gpio_event batch[GPIO_EVENTS_BATCH];
+	const size_t evsz = sizeof(struct rtdm_gpio_event);
+	unsigned int max, done = 0;
+	int count, ret;
+
+	max = len / evsz;
+	if (max == 0)
+		return -EINVAL;
+
+	for (;;) {
+		count = pull_pin_events(pin, chan, batch,
+					min_t(unsigned int, max - done,
+					      GPIO_EVENTS_BATCH));
+		if (count < 0)
+			return done ? done * evsz : count;
+
+		if (count > 0) {
+			ret = rtdm_safe_copy_to_user(fd, buf + done * evsz,
+						     batch, count * evsz);
+			if (ret)
+				return ret;
+			done += count;
+			if (done < max && count == GPIO_EVENTS_BATCH)
+				continue;
+		}
+
+		if (done > 0)
+			return done * evsz;
+
+		if (fd->oflags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = rtdm_event_wait(&pin->event);
+		if (ret)
+			return ret;
+	}
+}
+
 static ssize_t gpio_pin_read_rt(struct rtdm_fd *fd,
 				void __user *buf, size_t len)
 {
@@ -213,6 +471,9 @@ static ssize_t gpio_pin_read_rt(struct rtdm_fd *fd,
 
 	pin = container_of(dev, struct rtdm_gpio_pin, dev);
 
+	if (pin->ev_owner == chan)
+		return read_pin_events(fd, pin, buf, len);
+
 	if (!(fd->oflags & O_NONBLOCK)) {
 		ret = rtdm_event_wait(&pin->event);
 		if (ret)
@@ -294,13 +555,16 @@ static void gpio_pin_close(struct rtdm_fd *fd)
 {
 	struct rtdm_gpio_chan *chan = rtdm_fd_to_private(fd);
 	struct rtdm_device *dev = rtdm_fd_device(fd);
+	struct rtdm_gpio_chip *rgc = dev->device_data;
 	unsigned int gpio = rtdm_fd_minor(fd);
 	struct rtdm_gpio_pin *pin;
 
-	if (chan->requested) {
-		pin = container_of(dev, struct rtdm_gpio_pin, dev);
+	pin = container_of(dev, struct rtdm_gpio_pin, dev);
+	set_pin_output(rgc, pin, chan, false);
+	if (chan->requested)
 		release_gpio_irq(gpio, pin, chan);
-	}
+
+	release_pin_events(pin, chan);
 }
 
 static void delete_pin_devices(struct rtdm_gpio_chip *rgc)
@@ -345,6 +609,8 @@ static int create_pin_devices(struct rtdm_gpio_chip *rgc)
 			goto fail_label;
 		dev->minor = gpio;
 		dev->device_data = rgc;
+		rtdm_lock_init(&pin->ev_lock);
+		atomic_set(&pin->ev_readers, 0);
 		ret = rtdm_dev_register(dev);
 		if (ret)
 			goto fail_register;
@@ -364,6 +630,175 @@ fail_name:
 	return ret;
 }
 
+/*
+ * Pins beyond this count in a chip are accessed one by one, since
+ * the bank bitmaps live on the stack.
+ */
+#define GPIO_BANK_MAXPINS	512
+
+static int gpio_bank_access(struct rtdm_gpio_chip *rgc,
+			    struct rtdm_gpio_bank *b, bool set)
+{
+	DECLARE_BITMAP(mask, GPIO_BANK_MAXPINS);
+	DECLARE_BITMAP(bits, GPIO_BANK_MAXPINS);
+	struct gpio_chip *gc = rgc->gc;
+	unsigned int n, span;
+	bool native;
+	u64 m, val;
+	int ret;
+
+	if (b->offset >= gc->ngpio)
+		return -EINVAL;
+
+	span = gc->ngpio - b->offset;
+	if (span < 64 && (b->mask >> span))
+		return -EINVAL;
+
+	/* Only drive pins set as outputs through their pin device. */
+	if (set) {
+		for (m = b->mask; m; m &= m - 1) {
+			n = __ffs64(m);
+			if (!test_bit(b->offset + n, rgc->outputs))
+				return -EPERM;
+		}
+	}
+
+	native = gc->ngpio <= GPIO_BANK_MAXPINS &&
+		(set ? cobalt_gpiochip_has_set_multiple(gc) :
+		 cobalt_gpiochip_has_get_multiple(gc));
+
+	if (!native) {
+		if (set ? gc->set == NULL : gc->get == NULL)
+			return -EOPNOTSUPP;
+		val = 0;
+		for (m = b->mask; m; m &= m - 1) {
+			n = __ffs64(m);
+			if (set) {
+				gc->set(gc, b->offset + n, (b->bits >> n) & 1);
+				continue;
+			}
+			ret = gc->get(gc, b->offset + n);
+			if (ret < 0)
+				return ret;
+			if (ret)
+				val |= 1ULL << n;
+		}
+		b->bits = val;
+		return 0;
+	}
+
+	bitmap_zero(mask, gc->ngpio);
+	bitmap_zero(bits, gc->ngpio);
+	for (m = b->mask; m; m &= m - 1) {
+		n = __ffs64(m);
+		__set_bit(b->offset + n, mask);
+		if ((b->bits >> n) & 1)
+			__set_bit(b->offset + n, bits);
+	}
+
+	if (set) {
+		/* A single register update per bank, no glitch. */
+		cobalt_gpiochip_set_multiple(gc, mask, bits);
+		return 0;
+	}
+
+	ret = cobalt_gpiochip_get_multiple(gc, mask, bits);
+	if (ret)
+		return ret;
+
+	val = 0;
+	for (m = b->mask; m; m &= m - 1) {
+		n = __ffs64(m);
+		if (test_bit(b->offset + n, bits))
+			val |= 1ULL << n;
+	}
+	b->bits = val;
+
+	return 0;
+}
+
+static int gpio_bank_ioctl(struct rtdm_fd *fd,
+			   unsigned int request, void *arg)
+{
+	struct rtdm_device *dev = rtdm_fd_device(fd);
+	struct rtdm_gpio_chip *rgc = dev->device_data;
+	struct rtdm_gpio_bank b;
+	int ret;
+
+	switch (request) {
+	case GPIO_RTIOC_BANK_GET:
+	case GPIO_RTIOC_BANK_SET:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	ret = rtdm_safe_copy_from_user(fd, &b, arg, sizeof(b));
+	if (ret)
+		return ret;
+
+	ret = gpio_bank_access(rgc, &b, request == GPIO_RTIOC_BANK_SET);
+	if (ret || request == GPIO_RTIOC_BANK_SET)
+		return ret;
+
+	return rtdm_safe_copy_to_user(fd, arg, &b, sizeof(b));
+}
+
+static int create_bank_device(struct rtdm_gpio_chip *rgc, int gpio_subclass)
+{
+	struct gpio_chip *gc = rgc->gc;
+	struct rtdm_device *dev = &rgc->bank_dev;
+	int ret;
+
+	rgc->outputs = kcalloc(BITS_TO_LONGS(gc->ngpio),
+			       sizeof(unsigned long), GFP_KERNEL);
+	if (rgc->outputs == NULL)
+		return -ENOMEM;
+
+	rgc->bank_driver.profile_info = (struct rtdm_profile_info)
+		RTDM_PROFILE_INFO(rtdm_gpio_bank,
+				  RTDM_CLASS_GPIO,
+				  gpio_subclass,
+				  0);
+	rgc->bank_driver.device_flags = RTDM_NAMED_DEVICE;
+	rgc->bank_driver.device_count = 1;
+	rgc->bank_driver.context_size = 0;
+	rgc->bank_driver.ops = (struct rtdm_fd_ops){
+		.ioctl_rt	=	gpio_bank_ioctl,
+		.ioctl_nrt	=	gpio_bank_ioctl,
+	};
+
+	rtdm_drv_set_sysclass(&rgc->bank_driver, rgc->devclass);
+
+	dev->driver = &rgc->bank_driver;
+	dev->label = kasprintf(GFP_KERNEL, "%s/bank", gc->label);
+	if (dev->label == NULL) {
+		ret = -ENOMEM;
+		goto fail_label;
+	}
+	dev->device_data = rgc;
+
+	ret = rtdm_dev_register(dev);
+	if (ret)
+		goto fail_register;
+
+	return 0;
+
+fail_register:
+	kfree(dev->label);
+fail_label:
+	kfree(rgc->outputs);
+
+	return ret;
+}
+
+static void delete_bank_device(struct rtdm_gpio_chip *rgc)
+{
+	rtdm_dev_unregister(&rgc->bank_dev);
+	kfree(rgc->bank_dev.label);
+	kfree(rgc->outputs);
+}
+
 static char *gpio_pin_devnode(struct device *dev, umode_t *mode)
 {
 	return kasprintf(GFP_KERNEL, "rtdm/%s/%s",
@@ -395,6 +830,7 @@ int rtdm_gpiochip_add(struct rtdm_gpio_chip *rgc,
 	rgc->driver.ops = (struct rtdm_fd_ops){
 		.open		=	gpio_pin_open,
 		.close		=	gpio_pin_close,
+		.ioctl_rt	=	gpio_pin_ioctl_rt,
 		.ioctl_nrt	=	gpio_pin_ioctl_nrt,
 		.read_rt	=	gpio_pin_read_rt,
 		.write_rt	=	gpio_pin_write_rt,
@@ -406,9 +842,20 @@ int rtdm_gpiochip_add(struct rtdm_gpio_chip *rgc,
 	rgc->gc = gc;
 	rtdm_lock_init(&rgc->lock);
 
+	ret = create_bank_device(rgc, gpio_subclass);
+	if (ret)
+		goto fail_bank;
+
 	ret = create_pin_devices(rgc);
 	if (ret)
-		class_destroy(rgc->devclass);
+		goto fail_pins;
+
+	return 0;
+
+fail_pins:
+	delete_bank_device(rgc);
+fail_bank:
+	class_destroy(rgc->devclass);
 	
 	return ret;
 }
@@ -449,6 +896,7 @@ void rtdm_gpiochip_remove(struct rtdm_gpio_chip *rgc)
 	list_del(&rgc->next);
 	mutex_unlock(&chip_lock);
 	delete_pin_devices(rgc);
+	delete_bank_device(rgc);
 	class_destroy(rgc->devclass);
 }
 EXPORT_SYMBOL_GPL(rtdm_gpiochip_remove);
@@ -462,6 +910,7 @@ int rtdm_gpiochip_post_event(struct rtdm_gpio_chip *rgc,
 		return -EINVAL;
 
 	pin = rgc->pins + offset;
+	push_pin_event(pin);
 	rtdm_event_signal(&pin->event);
 	
 	return 0;
@@ -22,6 +22,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/log2.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/map.h>
 #include <cobalt/kernel/bufd.h>
@@ -37,6 +38,8 @@ struct bufp_socket {
 
 	void *bufmem;
 	size_t bufsz;
+	struct bufp_ring *ring;	/* Mapped ring header, if any. */
+	int ringmode;
 	u_long status;
 	xnhandle_t handle;
 	char label[XNOBJECT_NAME_LEN];
@@ -112,6 +115,8 @@ static int bufp_socket(struct rtdm_fd *fd)
 	sk->peer = nullsa;
 	sk->bufmem = NULL;
 	sk->bufsz = 0;
+	sk->ring = NULL;
+	sk->ringmode = 0;
 	sk->rdoff = 0;
 	sk->wroff = 0;
 	sk->fillsz = 0;
@@ -307,6 +312,9 @@ static ssize_t __bufp_recvmsg(struct rtdm_fd *fd,
 	if (!test_bit(_BUFP_BOUND, &sk->status))
 		return -EAGAIN;
 
+	if (sk->ring)
+		return -EOPNOTSUPP;
+
 	len = rtdm_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
 		return 0;
@@ -562,6 +570,11 @@ static ssize_t __bufp_sendmsg(struct rtdm_fd *fd,
 		return -ECONNREFUSED;
 	}
 
+	if (rsk->ring) {
+		ret = -EOPNOTSUPP;
+		goto fail;
+	}
+
 	/*
 	 * We may only send complete messages, so there is no point in
 	 * accepting messages which are larger than what the buffer
@@ -667,6 +680,33 @@ static ssize_t bufp_write(struct rtdm_fd *fd,
 	return __bufp_sendmsg(fd, &iov, 1, 0, &sk->peer);
 }
 
+/*
+ * The ring header occupies the first page of the buffer memory, the
+ * data area follows. Since the pages are mapped to user-space with
+ * their own reference, a mapping outliving the socket keeps them
+ * around until it goes away.
+ */
+static int __bufp_init_ring(struct bufp_socket *sk)
+{
+	size_t size;
+
+	if (sk->bufsz > (1UL << 31))
+		return -EINVAL;
+
+	size = roundup_pow_of_two(PAGE_ALIGN(sk->bufsz));
+	sk->bufmem = xnheap_vmalloc(PAGE_SIZE + size);
+	if (sk->bufmem == NULL)
+		return -ENOMEM;
+
+	memset(sk->bufmem, 0, PAGE_SIZE);
+	sk->ring = sk->bufmem;
+	sk->ring->size = size;
+	sk->ring->data_offset = PAGE_SIZE;
+	sk->bufsz = size;
+
+	return 0;
+}
+
 static int __bufp_bind_socket(struct rtipc_private *priv,
 			      struct sockaddr_ipc *sa)
 {
@@ -709,10 +749,16 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 	if (sk->bufsz == 0)
 		return -ENOBUFS;
 
-	sk->bufmem = xnheap_vmalloc(sk->bufsz);
-	if (sk->bufmem == NULL) {
-		ret = -ENOMEM;
-		goto fail;
+	if (sk->ringmode) {
+		ret = __bufp_init_ring(sk);
+		if (ret)
+			goto fail;
+	} else {
+		sk->bufmem = xnheap_vmalloc(sk->bufsz);
+		if (sk->bufmem == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
 	}
 
 	sk->name = *sa;
@@ -725,6 +771,8 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 				       &sk->handle, &__bufp_pnode.node);
 		if (ret) {
 			xnheap_vfree(sk->bufmem);
+			sk->bufmem = NULL;
+			sk->ring = NULL;
 			goto fail;
 		}
 	}
@@ -828,8 +876,8 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 	struct rtipc_port_label plabel;
 	struct timeval tv;
 	rtdm_lockctx_t s;
+	int ret, val;
 	size_t len;
-	int ret;
 
 	ret = rtipc_get_sockoptin(fd, &sopt, arg);
 	if (ret)
@@ -883,6 +931,20 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 		cobalt_atomic_leave(s);
 		break;
 
+	case BUFP_RING:
+		if (sopt.optlen != sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &val, sopt.optval, sizeof(val)))
+			return -EFAULT;
+		cobalt_atomic_enter(s);
+		if (test_bit(_BUFP_BOUND, &sk->status) ||
+		    test_bit(_BUFP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else
+			sk->ringmode = !!val;
+		cobalt_atomic_leave(s);
+		break;
+
 	case BUFP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -973,6 +1035,202 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 	return ret;
 }
 
+/*
+ * Return the ring the socket gives access to, i.e. its own ring if
+ * it was bound in ring mode, or the ring of its peer otherwise. On
+ * success, *rfdp is set to the file descriptor to unlock when done
+ * with the ring, if any.
+ */
+static struct bufp_socket *__bufp_get_ring(struct bufp_socket *sk,
+					   struct rtdm_fd **rfdp)
+{
+	struct bufp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+
+	*rfdp = NULL;
+
+	if (sk->ring)
+		return sk;
+
+	if (sk->peer.sipc_port < 0)
+		return ERR_PTR(-EDESTADDRREQ);
+
+	cobalt_atomic_enter(s);
+	rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+	if (rfd && rtdm_fd_lock(rfd) < 0)
+		rfd = NULL;
+	cobalt_atomic_leave(s);
+	if (rfd == NULL)
+		return ERR_PTR(-ECONNRESET);
+
+	rsk = rtipc_fd_to_state(rfd);
+	if (!test_bit(_BUFP_BOUND, &rsk->status) || rsk->ring == NULL) {
+		rtdm_fd_unlock(rfd);
+		return ERR_PTR(-ENXIO);
+	}
+
+	*rfdp = rfd;
+
+	return rsk;
+}
+
+static inline u32 __bufp_ring_fill(struct bufp_ring *ring)
+{
+	return READ_ONCE(ring->head) - READ_ONCE(ring->tail);
+}
+
+static int __bufp_ring_wait(struct bufp_socket *sk,
+			    struct bufp_socket *rsk, u32 len, int reader)
+{
+	struct bufp_ring *ring = rsk->ring;
+	struct bufp_wait_context wait;
+	nanosecs_rel_t timeout;
+	rtdm_toseq_t toseq;
+	rtdm_event_t *event;
+	rtdm_lockctx_t s;
+	u32 *waiting;
+	int ret = 0;
+
+	if (len == 0 || len > ring->size)
+		return -EINVAL;
+
+	if (reader) {
+		event = &rsk->i_event;
+		waiting = &ring->rd_waiting;
+		timeout = sk->rx_timeout;
+	} else {
+		event = &rsk->o_event;
+		waiting = &ring->wr_waiting;
+		timeout = sk->tx_timeout;
+	}
+
+	rtdm_toseq_init(&toseq, timeout);
+
+	cobalt_atomic_enter(s);
+
+	for (;;) {
+		/*
+		 * Raise the waiting flag before checking the indices
+		 * again, so that the other side cannot miss it after
+		 * moving its own index (it issues a full barrier
+		 * before reading the flag).
+		 */
+		WRITE_ONCE(*waiting, 1);
+		smp_mb();
+		if (reader) {
+			if (__bufp_ring_fill(ring) >= len)
+				break;
+		} else if (ring->size - __bufp_ring_fill(ring) >= len)
+			break;
+
+		wait.len = len;
+		wait.sk = rsk;
+		rtipc_prepare_wait(&wait.wc);
+		ret = rtdm_event_timedwait(event, timeout, &toseq);
+		if (unlikely(ret))
+			break;
+	}
+
+	if (rtipc_peek_wait_head(event) == NULL)
+		WRITE_ONCE(*waiting, 0);
+
+	cobalt_atomic_leave(s);
+
+	return ret;
+}
+
+static int __bufp_ring_kick(struct bufp_socket *sk,
+			    struct bufp_socket *rsk)
+{
+	struct bufp_ring *ring = rsk->ring;
+	rtdm_lockctx_t s;
+	u32 fill;
+
+	cobalt_atomic_enter(s);
+
+	fill = __bufp_ring_fill(ring);
+
+	if (sk == rsk) {
+		/* The reader released some space, wake up writers. */
+		if (fill < ring->size)
+			xnselect_signal(&rsk->priv->send_block, POLLOUT);
+		if (fill == 0)
+			xnselect_signal(&rsk->priv->recv_block, 0);
+		if (rtipc_peek_wait_head(&rsk->o_event))
+			rtdm_event_pulse(&rsk->o_event);
+	} else {
+		/* A writer posted some data, wake up the reader. */
+		if (fill > 0)
+			xnselect_signal(&rsk->priv->recv_block, POLLIN);
+		if (rtipc_peek_wait_head(&rsk->i_event))
+			rtdm_event_pulse(&rsk->i_event);
+	}
+
+	xnsched_run();
+
+	cobalt_atomic_leave(s);
+
+	return 0;
+}
+
+static int __bufp_ring_ioctl(struct rtdm_fd *fd,
+			     unsigned int request, void *arg)
+{
+	struct bufp_socket *sk = rtipc_fd_to_state(fd), *rsk;
+	struct rtdm_fd *rfd;
+	int ret;
+	u32 len;
+
+	rsk = __bufp_get_ring(sk, &rfd);
+	if (IS_ERR(rsk))
+		return PTR_ERR(rsk);
+
+	switch (request) {
+	case BUFP_RTIOC_WAITDATA:
+	case BUFP_RTIOC_WAITSPACE:
+		ret = rtipc_get_arg(fd, &len, arg, sizeof(len));
+		if (ret)
+			break;
+		ret = __bufp_ring_wait(sk, rsk, len,
+				       request == BUFP_RTIOC_WAITDATA);
+		break;
+	default:
+		ret = __bufp_ring_kick(sk, rsk);
+	}
+
+	if (rfd)
+		rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
+static int bufp_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	struct bufp_socket *sk = rtipc_fd_to_state(fd), *rsk;
+	struct rtdm_fd *rfd;
+	size_t len;
+	int ret;
+
+	if (vma->vm_pgoff != 0)
+		return -EINVAL;
+
+	rsk = __bufp_get_ring(sk, &rfd);
+	if (IS_ERR(rsk))
+		return PTR_ERR(rsk);
+
+	len = vma->vm_end - vma->vm_start;
+	if (len > PAGE_SIZE + rsk->bufsz)
+		ret = -EINVAL;
+	else
+		ret = rtdm_mmap_vmem(vma, rsk->bufmem);
+
+	if (rfd)
+		rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
 static int __bufp_ioctl(struct rtdm_fd *fd,
 			unsigned int request, void *arg)
 {
@@ -1024,6 +1282,12 @@ static int __bufp_ioctl(struct rtdm_fd *fd,
 		ret = -ENOTCONN;
 		break;
 
+	case BUFP_RTIOC_WAITDATA:
+	case BUFP_RTIOC_WAITSPACE:
+	case BUFP_RTIOC_KICK:
+		ret = __bufp_ring_ioctl(fd, request, arg);
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -1040,6 +1304,13 @@ static int bufp_ioctl(struct rtdm_fd *fd,
 	COMPAT_CASE(_RTIOC_BIND):
 		if (rtdm_in_rt_context())
 			return -ENOSYS;	/* Try downgrading to NRT */
+		ret = __bufp_ioctl(fd, request, arg);
+		break;
+	case BUFP_RTIOC_WAITDATA:
+	case BUFP_RTIOC_WAITSPACE:
+		if (!rtdm_in_rt_context())
+			return -ENOSYS;	/* Try upgrading to RT */
+		/* fall through */
 	default:
 		ret = __bufp_ioctl(fd, request, arg);
 	}
@@ -1047,6 +1318,11 @@ static int bufp_ioctl(struct rtdm_fd *fd,
 	return ret;
 }
 
+static inline size_t __bufp_fillsz(struct bufp_socket *sk)
+{
+	return sk->ring ? __bufp_ring_fill(sk->ring) : sk->fillsz;
+}
+
 static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -1054,7 +1330,7 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 	unsigned int mask = 0;
 	struct rtdm_fd *rfd;
 
-	if (test_bit(_BUFP_BOUND, &sk->status) && sk->fillsz > 0)
+	if (test_bit(_BUFP_BOUND, &sk->status) && __bufp_fillsz(sk) > 0)
 		mask |= POLLIN;
 
 	/*
@@ -1067,7 +1343,7 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
 		if (rfd) {
 			rsk = rtipc_fd_to_state(rfd);
-			if (rsk->fillsz < rsk->bufsz)
+			if (__bufp_fillsz(rsk) < rsk->bufsz)
 				mask |= POLLOUT;
 		}
 	} else
@@ -1104,5 +1380,6 @@ struct rtipc_protocol bufp_proto_driver = {
 		.write = bufp_write,
 		.ioctl = bufp_ioctl,
 		.pollstate = bufp_pollstate,
+		.mmap = bufp_mmap,
 	}
 };
@@ -47,6 +47,12 @@ struct iddp_socket {
 	rtdm_waitqueue_t *poolwaitq;
 	rtdm_waitqueue_t privwaitq;
 	size_t poolsz;
+	size_t msgsz;		/* Fixed datagram size (slab mode). */
+	void *slabmem;
+	u16 *slabnext;
+	size_t slotsz;
+	atomic_t slabhead;
+	int slabwaiters;
 	rtdm_sem_t insem;
 	struct list_head inq;
 	u_long status;
@@ -67,6 +73,15 @@ static struct xnmap *portmap;
 
 static rtdm_waitqueue_t poolwaitq;
 
+/*
+ * Slab free list head: slot index in the low 16 bits, generation
+ * count in the high 16 bits, bumped on every update to detect ABA
+ * races between lock-free pop and push operations.
+ */
+#define IDDP_SLAB_EMPTY		0xffff
+#define IDDP_SLAB_MAXSLOTS	IDDP_SLAB_EMPTY
+#define IDDP_SLAB_GEN		0x10000
+
 #define _IDDP_BINDING   0
 #define _IDDP_BOUND     1
 #define _IDDP_CONNECTED 2
@@ -108,6 +123,109 @@ static inline void __iddp_init_mbuf(struct iddp_message *mbuf, size_t len)
 	INIT_LIST_HEAD(&mbuf->next);
 }
 
+static struct iddp_message *__iddp_slab_pop(struct iddp_socket *sk)
+{
+	unsigned int old, new, idx;
+
+	do {
+		old = atomic_read(&sk->slabhead);
+		idx = old & IDDP_SLAB_EMPTY;
+		if (idx == IDDP_SLAB_EMPTY)
+			return NULL;
+		new = ((old + IDDP_SLAB_GEN) & ~IDDP_SLAB_EMPTY) |
+			READ_ONCE(sk->slabnext[idx]);
+	} while (atomic_cmpxchg(&sk->slabhead, old, new) != old);
+
+	return sk->slabmem + idx * sk->slotsz;
+}
+
+static void __iddp_slab_push(struct iddp_socket *sk,
+			     struct iddp_message *mbuf)
+{
+	unsigned int old, new, idx;
+
+	idx = ((void *)mbuf - sk->slabmem) / sk->slotsz;
+
+	do {
+		old = atomic_read(&sk->slabhead);
+		WRITE_ONCE(sk->slabnext[idx], old & IDDP_SLAB_EMPTY);
+		new = ((old + IDDP_SLAB_GEN) & ~IDDP_SLAB_EMPTY) | idx;
+	} while (atomic_cmpxchg(&sk->slabhead, old, new) != old);
+}
+
+/*
+ * Slab mode: slots are pulled from a lock-free free list. Waiters
+ * sleep on the pool wait queue only after re-checking the free list
+ * while holding the queue lock, so that a release never has to wake
+ * up more than a single waiter per slot.
+ */
+static struct iddp_message *
+__iddp_alloc_slot(struct iddp_socket *sk, size_t len,
+		  nanosecs_rel_t timeout, int flags, int *pret)
+{
+	struct iddp_message *mbuf;
+	rtdm_toseq_t timeout_seq;
+	rtdm_lockctx_t s;
+	int ret = 0;
+
+	if (len > sk->msgsz) {
+		*pret = -EMSGSIZE;
+		return NULL;
+	}
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	for (;;) {
+		mbuf = __iddp_slab_pop(sk);
+		if (mbuf) {
+			__iddp_init_mbuf(mbuf, len);
+			break;
+		}
+		if (flags & MSG_DONTWAIT) {
+			ret = -EAGAIN;
+			break;
+		}
+		rtdm_waitqueue_lock(sk->poolwaitq, s);
+		sk->slabwaiters++;
+		smp_mb();	/* Pairs with __iddp_free_slot(). */
+		mbuf = __iddp_slab_pop(sk);
+		if (mbuf == NULL) {
+			++sk->stalls;
+			ret = rtdm_timedwait_locked(sk->poolwaitq,
+						    timeout, &timeout_seq);
+		}
+		sk->slabwaiters--;
+		rtdm_waitqueue_unlock(sk->poolwaitq, s);
+		if (mbuf) {
+			__iddp_init_mbuf(mbuf, len);
+			break;
+		}
+		if (unlikely(ret == -EIDRM))
+			ret = -ECONNRESET;
+		if (ret)
+			break;
+	}
+
+	*pret = ret;
+
+	return mbuf;
+}
+
+static void __iddp_free_slot(struct iddp_socket *sk,
+			     struct iddp_message *mbuf)
+{
+	rtdm_lockctx_t s;
+
+	__iddp_slab_push(sk, mbuf);	/* Implies a full barrier. */
+
+	if (READ_ONCE(sk->slabwaiters) == 0)
+		return;
+
+	rtdm_waitqueue_lock(sk->poolwaitq, s);
+	rtdm_waitqueue_signal(sk->poolwaitq);
+	rtdm_waitqueue_unlock(sk->poolwaitq, s);
+}
+
 static struct iddp_message *
 __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		  nanosecs_rel_t timeout, int flags, int *pret)
@@ -117,6 +235,9 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 	rtdm_lockctx_t s;
 	int ret = 0;
 
+	if (sk->slabmem)
+		return __iddp_alloc_slot(sk, len, timeout, flags, pret);
+
 	rtdm_toseq_init(&timeout_seq, timeout);
 
 	for (;;) {
@@ -154,6 +275,11 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 static void __iddp_free_mbuf(struct iddp_socket *sk,
 			     struct iddp_message *mbuf)
 {
+	if (sk->slabmem) {
+		__iddp_free_slot(sk, mbuf);
+		return;
+	}
+
 	xnheap_free(sk->bufpool, mbuf);
 	rtdm_waitqueue_broadcast(sk->poolwaitq);
 }
@@ -169,6 +295,9 @@ static int iddp_socket(struct rtdm_fd *fd)
 	sk->bufpool = &cobalt_heap;
 	sk->poolwaitq = &poolwaitq;
 	sk->poolsz = 0;
+	sk->msgsz = 0;
+	sk->slabmem = NULL;
+	sk->slabwaiters = 0;
 	sk->status = 0;
 	sk->handle = 0;
 	sk->rx_timeout = RTDM_TIMEOUT_INFINITE;
@@ -203,12 +332,16 @@ static void iddp_close(struct rtdm_fd *fd)
 			xnmap_remove(portmap, sk->name.sipc_port);
 			cobalt_atomic_leave(s);
 		}
+		if (sk->slabmem) {
+			xnheap_vfree(sk->slabmem);
+			goto out;
+		}
 		if (sk->bufpool != &cobalt_heap) {
 			poolmem = xnheap_get_membase(&sk->privpool);
 			poolsz = xnheap_get_size(&sk->privpool);
 			xnheap_destroy(&sk->privpool);
 			xnheap_vfree(poolmem);
-			return;
+			goto out;
 		}
 	}
 
@@ -218,7 +351,7 @@ static void iddp_close(struct rtdm_fd *fd)
 		list_del(&mbuf->next);
 		xnheap_free(&cobalt_heap, mbuf);
 	}
-
+out:
 	kfree(sk);
 
 	return;
@@ -528,6 +661,45 @@ static ssize_t iddp_write(struct rtdm_fd *fd,
 	return __iddp_sendmsg(fd, &iov, 1, 0, &sk->peer);
 }
 
+/*
+ * Carve the local pool into fixed-size slots, each large enough for
+ * a datagram of sk->msgsz bytes. The array of free list links sits
+ * past the last slot.
+ */
+static int __iddp_init_slab(struct iddp_socket *sk, size_t poolsz)
+{
+	unsigned int nrslots, n;
+	size_t slotsz;
+	void *mem;
+
+	/* A slot has to fit in the pool, which also bounds slotsz. */
+	if (poolsz < sizeof(struct iddp_message) + sizeof(u16) ||
+	    sk->msgsz > poolsz - sizeof(struct iddp_message) - sizeof(u16))
+		return -EINVAL;
+
+	slotsz = ALIGN(sizeof(struct iddp_message) + sk->msgsz,
+		       sizeof(long));
+	nrslots = poolsz / (slotsz + sizeof(u16));
+	if (nrslots == 0)
+		return -EINVAL;
+	if (nrslots > IDDP_SLAB_MAXSLOTS)
+		nrslots = IDDP_SLAB_MAXSLOTS;
+
+	mem = xnheap_vmalloc(PAGE_ALIGN(nrslots * (slotsz + sizeof(u16))));
+	if (mem == NULL)
+		return -ENOMEM;
+
+	sk->slabnext = mem + nrslots * slotsz;
+	for (n = 0; n < nrslots - 1; n++)
+		sk->slabnext[n] = n + 1;
+	sk->slabnext[n] = IDDP_SLAB_EMPTY;
+	sk->slotsz = slotsz;
+	atomic_set(&sk->slabhead, 0);
+	sk->slabmem = mem;
+
+	return 0;
+}
+
 static int __iddp_bind_socket(struct rtdm_fd *fd,
 			      struct sockaddr_ipc *sa)
 {
@@ -568,7 +740,12 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 	 * setsockopt() before we got there.
 	 */
 	poolsz = sk->poolsz;
-	if (poolsz > 0) {
+	if (poolsz > 0 && sk->msgsz > 0) {
+		ret = __iddp_init_slab(sk, poolsz);
+		if (ret)
+			goto fail;
+		sk->poolwaitq = &sk->privwaitq;
+	} else if (poolsz > 0) {
 		poolsz = PAGE_ALIGN(poolsz);
 		poolmem = xnheap_vmalloc(poolsz);
 		if (poolmem == NULL) {
@@ -595,7 +772,10 @@ static int __iddp_bind_socket(struct rtdm_fd *fd,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__iddp_pnode.node);
 		if (ret) {
-			if (poolsz > 0) {
+			if (sk->slabmem) {
+				xnheap_vfree(sk->slabmem);
+				sk->slabmem = NULL;
+			} else if (poolsz > 0) {
 				xnheap_destroy(&sk->privpool);
 				xnheap_vfree(poolmem);
 			}
@@ -757,6 +937,21 @@ static int __iddp_setsockopt(struct iddp_socket *sk,
 		cobalt_atomic_leave(s);
 		break;
 
+	case IDDP_MSGSZ:
+		ret = rtipc_get_length(fd, &len, sopt.optval, sopt.optlen);
+		if (ret)
+			return ret;
+		if (len == 0)
+			return -EINVAL;
+		cobalt_atomic_enter(s);
+		if (test_bit(_IDDP_BOUND, &sk->status) ||
+		    test_bit(_IDDP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else
+			sk->msgsz = len;
+		cobalt_atomic_leave(s);
+		break;
+
 	case IDDP_LABEL:
 		if (sopt.optlen < sizeof(plabel))
 			return -EINVAL;
@@ -402,13 +402,17 @@ static ssize_t __xddp_stream(struct xddp_socket *sk,
 	rtdm_lock_get_irqsave(&sk->lock, s);
 
 	/*
-	 * There are two cases in which we must remove the cork
+	 * There are three cases in which we must remove the cork
 	 * unconditionally and send the incoming data as a standalone
 	 * datagram: the destination port does not support streaming,
-	 * or its streaming buffer is already filled with data issued
-	 * from another port.
+	 * its streaming buffer is already filled with data issued
+	 * from another port, or the reader runs in zero-copy mode,
+	 * in which case a buffer lent to it may not grow anymore.
+	 * The pipe refuses to enter zero-copy mode while messages are
+	 * queued, so no streaming buffer may be pending at the time
+	 * this mode is enabled.
 	 */
-	if (sk->curbufsz == 0 ||
+	if (sk->curbufsz == 0 || xnpipe_zcopy_p(sk->minor) ||
 	    (sk->buffer_port >= 0 && sk->buffer_port != from)) {
 		/* This will end up into a standalone datagram. */
 		outbytes = 0;
@@ -748,8 +752,19 @@ static int __xddp_bind_socket(struct rtipc_private *priv,
 	if (sk->peer.sipc_port < 0)
 		sk->peer = *sa;
 
-	if (poolsz > 0)
+	if (poolsz > 0) {
 		xnheap_set_name(sk->bufpool, "xddp-pool@%d", sa->sipc_port);
+		/*
+		 * All messages are pulled from the local pool, so
+		 * the reader may map it and receive them in place.
+		 */
+		ret = xnpipe_share(sk->minor, poolmem, poolsz);
+		if (ret) {
+			/* The release handler will cleanup the pool for us. */
+			xnpipe_disconnect(sk->minor);
+			return ret;
+		}
+	}
 
 	if (*sk->label) {
 		ret = xnregistry_enter(sk->label, sk, &sk->handle,
@@ -27,9 +27,16 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/sched.h>
+#include <linux/miscdevice.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/log2.h>
+#include <linux/uaccess.h>
 
 #include <rtdev.h>
 #include <rtnet_chrdev.h>
+#include <rtcap_chrdev.h>
 #include <rtnet_port.h> /* for netdev_priv() */
 
 MODULE_LICENSE("GPL");
@@ -39,6 +46,19 @@ module_param(rtcap_rtskbs, uint, 0444);
 MODULE_PARM_DESC(rtcap_rtskbs, "Number of real-time socket buffers per "
 		 "real-time device");
 
+/* upper bound of the mapping, keeps its size within 32 bits */
+#define RTCAP_RING_MAX_SIZE (256 * 1024 * 1024)
+
+static unsigned int rtcap_ring_slots = 512;
+module_param(rtcap_ring_slots, uint, 0444);
+MODULE_PARM_DESC(rtcap_ring_slots, "Number of frames the capture ring can "
+		 "hold (rounded up to a power of two, 0 disables the ring)");
+
+static unsigned int rtcap_snaplen = ETH_FRAME_LEN + ETH_FCS_LEN;
+module_param(rtcap_snaplen, uint, 0444);
+MODULE_PARM_DESC(rtcap_snaplen, "Maximum number of bytes stored per frame "
+		 "in the capture ring");
+
 #define TAP_DEV             1
 #define RTMAC_TAP_DEV       2
 #define XMIT_HOOK           4
@@ -56,12 +76,84 @@ static struct tap_device_t {
 					 struct rtnet_device *dev);
 } tap_device[MAX_RT_DEVICES];
 
+static struct rtcap_ring    *cap_ring;
+static unsigned int         cap_ring_size;
+static unsigned int         cap_slot_size;
+static int                  cap_ring_active;
+static atomic_t             cap_ring_users = ATOMIC_INIT(0);
+
+
+
+static inline int tap_active(struct tap_device_t *tap_dev)
+{
+    /* the Linux side only gets frames while one of the taps is up */
+    if ((tap_dev->present & TAP_DEV) == 0)
+	return 0;
+
+    return (tap_dev->tap_dev->flags & IFF_UP) ||
+	((tap_dev->present & RTMAC_TAP_DEV) &&
+	 (tap_dev->rtmac_tap_dev->flags & IFF_UP));
+}
+
+
+
+/* rtcap_lock must be held */
+static void rtcap_ring_put(struct rtskb *rtskb, unsigned int dir)
+{
+    struct rtcap_ring   *ring = cap_ring;
+    struct rtcap_slot   *slot;
+    unsigned int        caplen;
+    u32                 head;
+    u32                 rem;
+
+
+    if (!cap_ring_active)
+	return;
+
+    head = ring->head;
+    if (head - READ_ONCE(ring->tail) >= rtcap_ring_slots) {
+	ring->dropped++;
+	return;
+    }
+
+    /* do not overwrite the slot before the reader is done with it */
+    smp_mb();
+
+    slot = (struct rtcap_slot *)((char *)ring + PAGE_SIZE +
+	(head & (rtcap_ring_slots - 1)) * cap_slot_size);
+
+    caplen = min(rtskb->cap_len, rtcap_snaplen);
+
+    slot->ifindex     = rtskb->rtdev->ifindex;
+    slot->dir         = dir;
+    slot->hdr.ts_sec  = div_u64_rem(rtskb->time_stamp, NSEC_PER_SEC, &rem);
+    slot->hdr.ts_nsec = rem;
+    slot->hdr.caplen  = caplen;
+    slot->hdr.len     = rtskb->cap_len;
+    memcpy(slot + 1, rtskb->cap_start, caplen);
+
+    /* publish the slot before moving the head */
+    smp_wmb();
+    ring->head = head + 1;
+}
+
 
 
 void rtcap_rx_hook(struct rtskb *rtskb)
 {
+    struct tap_device_t *tap_dev = &tap_device[rtskb->rtdev->ifindex];
+
+
+    if (tap_dev->present == 0)
+	return;
+
+    rtcap_ring_put(rtskb, RTCAP_DIR_RX);
+
+    if (!tap_active(tap_dev))
+	return;
+
     if ((rtskb->cap_comp_skb = rtskb_pool_dequeue(&cap_pool)) == 0) {
-	tap_device[rtskb->rtdev->ifindex].tap_dev_stats.rx_dropped++;
+	tap_dev->tap_dev_stats.rx_dropped++;
 	return;
     }
 
@@ -85,18 +177,29 @@ int rtcap_xmit_hook(struct rtskb *rtskb, struct rtnet_device *rtdev)
     rtdm_lockctx_t      context;
 
 
+    rtskb->cap_start = rtskb->data;
+    /* segments of multi-segment rtskbs are not captured */
+    rtskb->cap_len   = rtskb_headlen(rtskb);
+
+    rtskb->time_stamp = rtdm_clock_read();
+
+    if (cap_ring_active) {
+	rtdm_lock_get_irqsave(&rtcap_lock, context);
+	rtcap_ring_put(rtskb, RTCAP_DIR_TX);
+	rtdm_lock_put_irqrestore(&rtcap_lock, context);
+    }
+
+    if (!tap_active(tap_dev))
+	return tap_dev->orig_xmit(rtskb, rtdev);
+
     if ((rtskb->cap_comp_skb = rtskb_pool_dequeue(&cap_pool)) == 0) {
 	tap_dev->tap_dev_stats.rx_dropped++;
 	return tap_dev->orig_xmit(rtskb, rtdev);
     }
 
     rtskb->cap_next  = NULL;
-    rtskb->cap_start = rtskb->data;
-    rtskb->cap_len   = rtskb->len;
     rtskb->cap_flags |= RTSKB_CAP_SHARED;
 
-    rtskb->time_stamp = rtdm_clock_read();
-
     rtdm_lock_get_irqsave(&rtcap_lock, context);
 
     if (cap_queue.first == NULL)
@@ -327,6 +430,110 @@ static void tap_dev_setup(struct net_device *dev)
 
 
 
+static int rtcap_ring_open(struct inode *inode, struct file *file)
+{
+    rtdm_lockctx_t  context;
+
+
+    /* one reader at a time */
+    if (atomic_cmpxchg(&cap_ring_users, 0, 1) != 0)
+	return -EBUSY;
+
+    rtdm_lock_get_irqsave(&rtcap_lock, context);
+    cap_ring->head    = 0;
+    cap_ring->tail    = 0;
+    cap_ring->dropped = 0;
+    cap_ring_active   = 1;
+    rtdm_lock_put_irqrestore(&rtcap_lock, context);
+
+    return 0;
+}
+
+static int rtcap_ring_release(struct inode *inode, struct file *file)
+{
+    cap_ring_active = 0;
+    atomic_set(&cap_ring_users, 0);
+
+    return 0;
+}
+
+static int rtcap_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    return remap_vmalloc_range(vma, cap_ring, vma->vm_pgoff);
+}
+
+static long rtcap_ring_ioctl(struct file *file, unsigned int request,
+			     unsigned long arg)
+{
+    struct rtcap_ring_info info;
+
+
+    if (request != RTCAP_IOC_INFO)
+	return -ENOTTY;
+
+    memset(&info, 0, sizeof(info));
+    info.map_len     = cap_ring_size;
+    info.data_offset = PAGE_SIZE;
+    info.nr_slots    = rtcap_ring_slots;
+    info.slot_size   = cap_slot_size;
+    info.snaplen     = rtcap_snaplen;
+
+    if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+	return -EFAULT;
+
+    return 0;
+}
+
+
+
+static struct file_operations rtcap_ring_fops = {
+    .owner          = THIS_MODULE,
+    .open           = rtcap_ring_open,
+    .release        = rtcap_ring_release,
+    .mmap           = rtcap_ring_mmap,
+    .unlocked_ioctl = rtcap_ring_ioctl,
+};
+
+static struct miscdevice rtcap_ring_dev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "rtcap",
+    .fops  = &rtcap_ring_fops,
+};
+
+
+
+static int __init rtcap_ring_init(void)
+{
+    int ret;
+
+
+    if ((rtcap_snaplen == 0) || (rtcap_snaplen > 65535) ||
+	(rtcap_ring_slots > 65536))
+	return -EINVAL;
+
+    rtcap_ring_slots = roundup_pow_of_two(rtcap_ring_slots);
+    cap_slot_size = ALIGN(sizeof(struct rtcap_slot) + rtcap_snaplen,
+			  L1_CACHE_BYTES);
+    if (rtcap_ring_slots > (RTCAP_RING_MAX_SIZE - PAGE_SIZE) / cap_slot_size)
+	return -EINVAL;
+    /* ring header on the first page, slots afterwards */
+    cap_ring_size = PAGE_ALIGN(PAGE_SIZE + rtcap_ring_slots * cap_slot_size);
+
+    cap_ring = vmalloc_user(cap_ring_size);
+    if (cap_ring == NULL)
+	return -ENOMEM;
+
+    ret = misc_register(&rtcap_ring_dev);
+    if (ret < 0) {
+	vfree(cap_ring);
+	cap_ring = NULL;
+    }
+
+    return ret;
+}
+
+
+
 void cleanup_tap_devices(void)
 {
     int                 i;
@@ -469,6 +676,15 @@ int __init rtcap_init(void)
 	goto error2;
     }
 
+    if (rtcap_ring_slots > 0) {
+	ret = rtcap_ring_init();
+	if (ret < 0) {
+	    printk("RTcap: unable to set up capture ring (error %d)\n", ret);
+	    rtskb_pool_release(&cap_pool);
+	    goto error2;
+	}
+    }
+
     /* register capturing handlers with RTnet core
      * (adding the handler need no locking) */
     rtcap_handler = rtcap_rx_hook;
@@ -507,6 +723,11 @@ void rtcap_cleanup(void)
 
     cleanup_tap_devices();
 
+    if (cap_ring != NULL) {
+	misc_deregister(&rtcap_ring_dev);
+	vfree(cap_ring);
+    }
+
     rtskb_pool_release(&cap_pool);
 
     printk("RTcap: unloaded\n");
@@ -65,7 +65,7 @@ static struct net_device *dev_rtnetproxy;
 /* **************************************************************************
  *  SKB pool management (JK):
  * ************************************************************************ */
-#define DEFAULT_PROXY_RTSKBS        32
+#define DEFAULT_PROXY_RTSKBS        64
 
 static unsigned int proxy_rtskbs = DEFAULT_PROXY_RTSKBS;
 module_param(proxy_rtskbs, uint, 0444);
@@ -84,6 +84,9 @@ static rtdm_task_t rtnetproxy_tx_task;
 
 static rtdm_event_t rtnetproxy_tx_event;
 
+/* frames queued for transmission since the last tx task wakeup */
+static unsigned int tx_batched;
+
 #ifdef CONFIG_XENO_DRIVERS_NET_ADDON_PROXY_ARP
 static char* rtdev_attach = "rteth0";
 module_param(rtdev_attach, charp, 0444);
@@ -101,13 +104,22 @@ struct rtnet_device *rtnetproxy_rtdev;
 static void rtnetproxy_tx_loop(void *arg)
 {
     struct rtnet_device *rtdev;
-    struct rtskb *rtskb;
+    struct rtskb *rtskb, *next;
+    rtdm_lockctx_t context;
 
     while (!rtdm_task_should_stop()) {
 	if (rtdm_event_wait(&rtnetproxy_tx_event) < 0)
 	    break;
 
-	while ((rtskb = rtskb_dequeue(&tx_queue)) != NULL) {
+	/* take the whole batch at once */
+	rtdm_lock_get_irqsave(&tx_queue.lock, context);
+	next = tx_queue.first;
+	tx_queue.first = NULL;
+	rtdm_lock_put_irqrestore(&tx_queue.lock, context);
+
+	while ((rtskb = next) != NULL) {
+	    next = rtskb->next;
+	    rtskb->next = NULL;
 	    rtdev = rtskb->rtdev;
 	    rtdev_xmit_proxy(rtskb);
 	    rtdev_dereference(rtdev);
@@ -116,6 +128,31 @@ static void rtnetproxy_tx_loop(void *arg)
 }
 
 
+/* ************************************************************************
+ *  Returns true when the stack is about to pass further frames right
+ *  after this one, e.g. the segments of a GSO frame.
+ * ************************************************************************ */
+static inline bool rtnetproxy_xmit_more(struct sk_buff *skb)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,2,0)
+    return netdev_xmit_more();
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3,18,0)
+    return skb->xmit_more;
+#else
+    return false;
+#endif
+}
+
+/* wake up the tx task once per batch */
+static inline void rtnetproxy_kick_tx(void)
+{
+    if (tx_batched > 0) {
+	tx_batched = 0;
+	rtdm_event_signal(&rtnetproxy_tx_event);
+    }
+}
+
+
 /* ************************************************************************
  *  hard_xmit
  *
@@ -125,8 +162,10 @@ static void rtnetproxy_tx_loop(void *arg)
 static int rtnetproxy_xmit(struct sk_buff *skb, struct net_device *dev)
 {
     struct ethhdr *eth = (struct ethhdr *)skb->data;
+    bool more = rtnetproxy_xmit_more(skb);
     struct rtskb *rtskb;
     int len = skb->len;
+    int ret = NETDEV_TX_OK;
 #ifndef CONFIG_XENO_DRIVERS_NET_ADDON_PROXY_ARP
     struct dest_route rt;
     struct iphdr *iph;
@@ -145,12 +184,15 @@ static int rtnetproxy_xmit(struct sk_buff *skb, struct net_device *dev)
 drop1:
 	dev->stats.tx_dropped++;
 	dev_kfree_skb(skb);
-	return NETDEV_TX_OK;
+	goto out;
     }
 
     rtskb = alloc_rtskb(len, &rtskb_pool);
-    if (!rtskb)
-	return NETDEV_TX_BUSY;
+    if (!rtskb) {
+	/* let the tx task release what is pending */
+	ret = NETDEV_TX_BUSY;
+	goto out;
+    }
 
     memcpy(rtskb_put(rtskb, len), skb->data, len);
 
@@ -161,7 +203,8 @@ drop1:
     if (rtdev_reference(rtnetproxy_rtdev) == 0) {
 	dev->stats.tx_dropped++;
 	kfree_rtskb(rtskb);
-	return NETDEV_TX_BUSY;
+	ret = NETDEV_TX_BUSY;
+	goto out;
     }
 
 #else /* !CONFIG_XENO_DRIVERS_NET_ADDON_PROXY_ARP */
@@ -175,7 +218,7 @@ drop1:
 drop2:
 	dev->stats.tx_dropped++;
 	kfree_rtskb(rtskb);
-	return NETDEV_TX_OK;
+	goto out;
     }
     if (rt.rtdev->local_ip != saddr) {
 	rtdev_dereference(rt.rtdev);
@@ -193,9 +236,13 @@ drop2:
     dev->stats.tx_bytes += len;
 
     rtskb_queue_tail(&tx_queue, rtskb);
-    rtdm_event_signal(&rtnetproxy_tx_event);
+    tx_batched++;
 
-    return NETDEV_TX_OK;
+out:
+    if (!more || ret != NETDEV_TX_OK)
+	rtnetproxy_kick_tx();
+
+    return ret;
 }
 
 
@@ -214,6 +261,9 @@ drop2:
  * ************************************************************************ */
 static void rtnetproxy_recv(struct rtskb *rtskb)
 {
+    rtdm_lockctx_t context;
+    int was_empty;
+
     /* Acquire rtskb (JK) */
     if (rtskb_acquire(rtskb, &rtskb_pool) != 0) {
 	dev_rtnetproxy->stats.rx_dropped++;
@@ -222,8 +272,14 @@ static void rtnetproxy_recv(struct rtskb *rtskb)
 	return;
     }
 
-    rtskb_queue_tail(&rx_queue, rtskb);
-    rtdm_nrtsig_pend(&rtnetproxy_rx_signal);
+    rtdm_lock_get_irqsave(&rx_queue.lock, context);
+    was_empty = rtskb_queue_empty(&rx_queue);
+    __rtskb_queue_tail(&rx_queue, rtskb);
+    rtdm_lock_put_irqrestore(&rx_queue.lock, context);
+
+    /* the signal handler drains the whole queue, one signal per batch */
+    if (was_empty)
+	rtdm_nrtsig_pend(&rtnetproxy_rx_signal);
 }
 
 
@@ -242,6 +298,10 @@ static inline void rtnetproxy_kernel_recv(struct rtskb *rtskb)
 
     /* Copy the realtime skb (rtskb) to the standard skb: */
     skb = dev_alloc_skb(len+2);
+    if (!skb) {
+	dev->stats.rx_dropped++;
+	return;
+    }
     skb_reserve(skb, 2);
 
     memcpy(skb_put(skb, len), rtskb->data-header_len, len);
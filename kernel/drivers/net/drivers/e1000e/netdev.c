@@ -3264,25 +3264,38 @@ static int e1000_tx_map(struct e1000_adapter *adapter,
 {
 	struct e1000_ring *tx_ring = adapter->tx_ring;
 	struct e1000_buffer *buffer_info;
-	unsigned int offset = 0, size, i;
+	struct rtskb *seg = skb;
+	unsigned int size, i, count = 0;
 
 	i = tx_ring->next_to_use;
+	size = rtskb_headlen(skb);
 
-	buffer_info = &tx_ring->buffer_info[i];
-	size = skb->len;
+	/* one buffer per segment of multi-segment rtskbs */
+	for (;;) {
+		buffer_info = &tx_ring->buffer_info[i];
+		buffer_info->length = size;
+		buffer_info->time_stamp = jiffies;
+		buffer_info->next_to_watch = i;
+		buffer_info->dma = rtskb_data_dma_addr(seg, 0);
+		buffer_info->mapped_as_page = false;
+		count++;
+
+		seg = seg->sg_next;
+		if (likely(!seg))
+			break;
 
-	buffer_info->length = size;
-	buffer_info->time_stamp = jiffies;
-	buffer_info->next_to_watch = i;
-	buffer_info->dma = rtskb_data_dma_addr(skb, offset);
-	buffer_info->mapped_as_page = false;
+		size = seg->len;
+		i++;
+		if (i == tx_ring->count)
+			i = 0;
+	}
 
 	tx_ring->buffer_info[i].skb = skb;
 	tx_ring->buffer_info[i].segs = 1;
-	tx_ring->buffer_info[i].bytecount = size;
+	tx_ring->buffer_info[i].bytecount = skb->len;
 	tx_ring->buffer_info[first].next_to_watch = i;
 
-	return 1;
+	return count;
 }
 
 static void e1000_tx_queue(struct e1000_adapter *adapter,
@@ -3368,7 +3381,7 @@ static int e1000_transfer_dhcp_info(struct e1000_adapter *adapter,
 			return 0;
 
 		offset = (u8 *)udp + 8 - skb->data;
-		length = skb->len - offset;
+		length = rtskb_headlen(skb) - offset;
 		return e1000e_mng_write_dhcp_info(hw, (u8 *)udp + 8, length);
 	}
 
@@ -3404,6 +3417,21 @@ static int e1000_xmit_frame(struct rtskb *skb, struct rtnet_device *netdev)
 
 	rtdm_lock_get_irqsave(&tx_ring->lock, context);
 
+	if (unlikely(rtskb_is_nonlinear(skb))) {
+		struct rtskb *seg;
+		int descs = 1;
+
+		rtskb_for_each_segment(skb, seg)
+			descs++;
+
+		/* keep a gap between tail and head */
+		if (e1000_desc_unused(tx_ring) < descs + 2) {
+			rtdm_lock_put_irqrestore(&tx_ring->lock, context);
+			kfree_rtskb(skb);
+			return NETDEV_TX_OK;
+		}
+	}
+
 	first = tx_ring->next_to_use;
 
 	if (skb->xmit_stamp)
@@ -4047,6 +4075,9 @@ static int e1000_probe(struct pci_dev *pdev,
 		netdev->features |= NETIF_F_HIGHDMA;
 	}
 
+	/* e1000_tx_map() maps each segment of multi-segment rtskbs */
+	set_bit(PRIV_FLAG_SG_XMIT, &netdev->priv_flags);
+
 	if (e1000e_enable_mng_pass_thru(&adapter->hw))
 		adapter->flags |= FLAG_MNG_PT_ENABLED;
 
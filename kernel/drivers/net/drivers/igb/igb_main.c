@@ -2143,6 +2143,9 @@ static int igb_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 	netdev->priv_flags |= IFF_UNICAST_FLT;
 
+	/* igb_tx_map() maps each segment of multi-segment rtskbs */
+	set_bit(PRIV_FLAG_SG_XMIT, &netdev->priv_flags);
+
 	adapter->en_mng_pt = igb_enable_mng_pass_thru(hw);
 
 	/* before reading the NVM, reset the controller to put the device in a
@@ -4086,20 +4089,42 @@ static void igb_tx_map(struct igb_ring *tx_ring,
 	u32 tx_flags = first->tx_flags;
 	u32 cmd_type = igb_tx_cmd_type(skb, tx_flags);
 	u16 i = tx_ring->next_to_use;
+	struct rtskb *seg = skb;
 
-	/* first descriptor is also last, set RS and EOP bits */
-	cmd_type |= IGB_TXD_DCMD;
 	tx_desc = IGB_TX_DESC(tx_ring, i);
 
 	igb_tx_olinfo_status(tx_ring, tx_desc, tx_flags, skb->len - hdr_len);
 
-	size = skb->len;
+	size = rtskb_headlen(skb);
 
 	dma = rtskb_data_dma_addr(skb, 0);
 
 	tx_buffer = first;
 
-	tx_desc->read.buffer_addr = cpu_to_le64(dma);
+	/* one descriptor per segment of multi-segment rtskbs */
+	for (;;) {
+		tx_desc->read.buffer_addr = cpu_to_le64(dma);
+
+		seg = seg->sg_next;
+		if (likely(!seg))
+			break;
+
+		tx_desc->read.cmd_type_len = cpu_to_le32(cmd_type ^ size);
+
+		i++;
+		tx_desc++;
+		if (i == tx_ring->count) {
+			tx_desc = IGB_TX_DESC(tx_ring, 0);
+			i = 0;
+		}
+		tx_desc->read.olinfo_status = 0;
+
+		size = seg->len;
+		dma = rtskb_data_dma_addr(seg, 0);
+	}
+
+	/* last descriptor, set RS and EOP bits */
+	cmd_type |= IGB_TXD_DCMD;
 	tx_desc->read.cmd_type_len = cpu_to_le32(cmd_type ^ size);
 
 	/* set the timestamp */
@@ -4145,10 +4170,14 @@ netdev_tx_t igb_xmit_frame_ring(struct rtskb *skb,
 				struct igb_ring *tx_ring)
 {
 	struct igb_tx_buffer *first;
+	struct rtskb *seg;
 	u32 tx_flags = 0;
 	u16 count = 2;
 	u8 hdr_len = 0;
 
+	rtskb_for_each_segment(skb, seg)
+		count++;
+
 	/* need: 1 descriptor per page * PAGE_SIZE/IGB_MAX_DATA_PER_TXD,
 	 *       + 1 desc for skb_headlen/IGB_MAX_DATA_PER_TXD,
 	 *       + 2 desc gap to keep tail from touching head,
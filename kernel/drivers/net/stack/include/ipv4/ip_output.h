@@ -35,7 +35,7 @@ extern int rt_ip_build_xmit(struct rtsocket *sk,
     int getfrag (const void *, unsigned char *, unsigned int, unsigned int),
     const void *frag, unsigned length, struct dest_route *rt, int flags);
 
-extern void __init rt_ip_init(void);
+extern int __init rt_ip_init(void);
 extern void rt_ip_release(void);
 
 
@@ -0,0 +1,81 @@
+/***
+ *
+ *  include/rtcap_chrdev.h
+ *
+ *  Real-Time Capturing Interface - capture ring
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef __RTCAP_CHRDEV_H_
+#define __RTCAP_CHRDEV_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+
+/*
+ * Layout of the capture ring as mapped from /dev/rtcap:
+ *
+ *   offset 0:           struct rtcap_ring
+ *   offset data_offset: nr_slots slots of slot_size bytes each
+ *
+ * Each slot starts with a struct rtcap_slot, followed by hdr.caplen bytes
+ * of frame data. The kernel fills slot (head % nr_slots) and increments
+ * head afterwards, the reader consumes slot (tail % nr_slots) and increments
+ * tail when done with it. Frames arriving while the ring is full are
+ * dropped and accounted for in dropped.
+ */
+struct rtcap_ring {
+    __u32 head;         /* written by the kernel */
+    __u32 tail;         /* written by the reader */
+    __u32 dropped;
+    __u32 __padding;
+};
+
+/* pcap record header, nanosecond resolution */
+struct rtcap_pkthdr {
+    __u32 ts_sec;
+    __u32 ts_nsec;
+    __u32 caplen;
+    __u32 len;
+};
+
+#define RTCAP_DIR_RX        0
+#define RTCAP_DIR_TX        1
+
+struct rtcap_slot {
+    __u16 ifindex;
+    __u16 dir;
+    __u32 __padding;
+    struct rtcap_pkthdr hdr;
+};
+
+struct rtcap_ring_info {
+    __u32 map_len;
+    __u32 data_offset;
+    __u32 nr_slots;     /* power of two */
+    __u32 slot_size;
+    __u32 snaplen;
+    __u32 __padding;
+};
+
+
+#define RTCAP_IOC_TYPE      'c'
+
+#define RTCAP_IOC_INFO      _IOR(RTCAP_IOC_TYPE, 0, struct rtcap_ring_info)
+
+#endif  /* __RTCAP_CHRDEV_H_ */
@@ -41,6 +41,7 @@
 
 #define PRIV_FLAG_UP                    0
 #define PRIV_FLAG_ADDING_ROUTE          1
+#define PRIV_FLAG_SG_XMIT               2   /* multi-segment rtskbs accepted */
 
 #ifndef NETIF_F_LLTX
 #define NETIF_F_LLTX                    4096
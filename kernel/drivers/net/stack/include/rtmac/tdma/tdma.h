@@ -78,6 +78,13 @@ struct tdma_slot {
 };
 
 
+/* transmission instant of a slot, as compiled for the current cycle */
+struct tdma_slot_instant {
+    u64                         xmit_time;
+    struct tdma_slot            *slot;
+};
+
+
 #define REQUEST_CAL_JOB(job)    ((struct tdma_request_cal *)(job))
 
 struct tdma_request_cal {
@@ -137,6 +144,8 @@ struct tdma_priv {
 
     unsigned int                max_slot_id;
     struct tdma_slot            **slot_table;
+    struct tdma_slot_instant    *cycle_table;   /* shares slot_table memory */
+    unsigned int                cycle_table_size;
 
     struct rt_proc_call         *calibration_call;
     unsigned char               master_hw_addr[MAX_ADDR_LEN];
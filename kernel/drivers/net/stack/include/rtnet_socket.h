@@ -57,6 +57,8 @@ struct rtsocket {
 
     unsigned long           flags;
 
+    unsigned int            frag_collectors; /* IP messages in reassembly */
+
     union {
 	/* IP specific */
 	struct {
@@ -89,6 +89,13 @@ rtskbs can be exchanged between pools (rtskb_acquire()). In this case, the
 passed rtskb switches over to from its owning pool to a given pool, but only if
 this pool can pass an empty rtskb from its own queue back.
 
+Pools shared by several CPUs (e.g. the global and device pools) may front their
+queue with small per-CPU caches (rtskb_pool_enable_cache()). rtskbs are then
+allocated from and freed to the cache of the current CPU, which is refilled
+from or flushed to the pool's queue in batches. When both the local cache and
+the queue run empty, rtskbs are taken from the caches of other CPUs. The
+per-owner accounting (lock_ops) still applies to each rtskb.
+
 
 5. rtskb Chains
 
@@ -103,7 +110,24 @@ newly allocated rtskb is always reset to a "single rtskb chain". Furthermore,
 the acquisition of complete chains is NOT supported (rtskb_acquire()).
 
 
-6. Capturing Support (Optional)
+6. Multi-segment rtskbs
+
+Outgoing packets larger than a single rtskb buffer (e.g. jumbo frames) can be
+described by a head rtskb carrying the protocol headers and the first part of
+the payload, followed by a list of data segments linked via sg_next. Each
+segment is a plain rtskb with its own data and len. The len field of the head
+covers the whole packet, data_len the part stored in the segments, so that
+rtskb_headlen() returns the length of the head buffer only. Segments are
+appended using rtskb_add_segment() and released together with their head
+(kfree_rtskb()).
+
+The stack only passes multi-segment rtskbs to devices setting
+PRIV_FLAG_SG_XMIT, whose drivers have to map each segment into a separate
+transmit descriptor. Such rtskbs can neither be cloned (rtskb_clone()) nor
+form a chain.
+
+
+7. Capturing Support (Optional)
 
 When incoming or outgoing packets are captured, the assigned rtskb needs to be
 shared between the stack, the driver, and the capturing service. In contrast to
@@ -157,6 +181,8 @@ struct rtskb {
     struct rtskb        *next;      /* used for queuing rtskbs */
     struct rtskb        *chain_end; /* marks the end of a rtskb chain starting
 				       with this very rtskb */
+    struct rtskb        *sg_next;   /* next data segment (multi-segment
+				       rtskbs only) */
 
     struct rtskb_pool   *pool;      /* owning pool */
 
@@ -207,6 +233,7 @@ struct rtskb {
     unsigned char       *tail;
     unsigned char       *end;
     unsigned int        len;
+    unsigned int        data_len;   /* part of len held by segments */
 
     dma_addr_t          buf_dma_addr;
 
@@ -239,10 +266,17 @@ struct rtskb_pool_lock_ops {
     void (*unlock)(void *cookie);
 };
 
+struct rtskb_pool_cache {
+    rtdm_lock_t         lock;
+    struct rtskb        *first;
+    unsigned int        len;
+};
+
 struct rtskb_pool {
     struct rtskb_queue queue;
     const struct rtskb_pool_lock_ops *lock_ops;
     void *lock_cookie;
+    struct rtskb_pool_cache __percpu *cache; /* NULL if disabled */
 };
 
 #define QUEUE_MAX_PRIO          0
@@ -624,9 +658,17 @@ static inline void rtskb_queue_purge(struct rtskb_queue *queue)
 
 static inline int rtskb_headlen(const struct rtskb *skb)
 {
-    return skb->len;
+    return skb->len - skb->data_len;
 }
 
+static inline int rtskb_is_nonlinear(const struct rtskb *skb)
+{
+    return skb->data_len != 0;
+}
+
+#define rtskb_for_each_segment(skb, seg) \
+    for ((seg) = (skb)->sg_next; (seg) != NULL; (seg) = (seg)->sg_next)
+
 static inline void rtskb_reserve(struct rtskb *skb, unsigned int len)
 {
     skb->data+=len;
@@ -737,11 +779,14 @@ extern unsigned int __rtskb_module_pool_init(struct rtskb_pool *pool,
 
 extern void rtskb_pool_release(struct rtskb_pool *pool);
 
+extern int rtskb_pool_enable_cache(struct rtskb_pool *pool);
+
 extern unsigned int rtskb_pool_extend(struct rtskb_pool *pool,
 				      unsigned int add_rtskbs);
 extern unsigned int rtskb_pool_shrink(struct rtskb_pool *pool,
 				      unsigned int rem_rtskbs);
 extern int rtskb_acquire(struct rtskb *rtskb, struct rtskb_pool *comp_pool);
+extern void rtskb_add_segment(struct rtskb *skb, struct rtskb *seg);
 extern struct rtskb* rtskb_clone(struct rtskb *rtskb,
 				 struct rtskb_pool *pool);
 
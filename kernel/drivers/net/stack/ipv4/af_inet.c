@@ -299,7 +299,9 @@ static int __init rt_ipv4_proto_init(void)
 
 
     /* Network-Layer */
-    rt_ip_init();
+    result = rt_ip_init();
+    if (result < 0)
+	return result;
     rt_arp_init();
 
     /* Transport-Layer */
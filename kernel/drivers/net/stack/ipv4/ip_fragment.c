@@ -21,6 +21,7 @@
 
 
 #include <linux/module.h>
+#include <linux/jhash.h>
 #include <net/checksum.h>
 #include <net/ip.h>
 
@@ -41,67 +42,115 @@
  * This defined sets the number of incoming fragmented IP messages that
  * can be handled in parallel.
  */
-#define COLLECTOR_COUNT 10
+#define COLLECTOR_COUNT     32
+
+/* Size of the collector hash table, must be a power of 2. */
+#define COLLECTOR_HASH_SIZE 64
+#define COLLECTOR_HASH_MASK (COLLECTOR_HASH_SIZE - 1)
+
+static unsigned int frag_timeout = 1000;
+module_param(frag_timeout, uint, 0444);
+MODULE_PARM_DESC(frag_timeout, "timeout of incomplete IP messages in ms "
+                 "(default: 1000)");
+
+static unsigned int frag_sock_quota = 8;
+module_param(frag_sock_quota, uint, 0444);
+MODULE_PARM_DESC(frag_sock_quota, "max. number of IP messages reassembled "
+                 "in parallel per socket (default: 8, 0: unlimited)");
 
 struct ip_collector
 {
-    int   in_use;
+    struct hlist_node hash;     /* collector_hash[] chain */
+    struct list_head  list;     /* free or busy list */
+
     __u32 saddr;
     __u32 daddr;
     __u16 id;
     __u8  protocol;
 
+    nanosecs_abs_t expires;
+
     struct rtskb_queue frags;
     struct rtsocket *sock;
     unsigned int buf_size;
 };
 
 static struct ip_collector collector[COLLECTOR_COUNT];
+static struct hlist_head   collector_hash[COLLECTOR_HASH_SIZE];
+static LIST_HEAD(free_collectors);
+static LIST_HEAD(busy_collectors);  /* by increasing expiry date */
+static DEFINE_RTDM_LOCK(collector_lock);
+static rtdm_timer_t        collector_timer;
+
+
+static inline unsigned int collector_key(__u32 saddr, __u16 id, __u8 protocol)
+{
+    return jhash_3words(saddr, id, protocol, 0) & COLLECTOR_HASH_MASK;
+}
+
+
+
+/* collector_lock held */
+static void release_collector(struct ip_collector *p_coll)
+{
+    hlist_del(&p_coll->hash);
+    list_move(&p_coll->list, &free_collectors);
+    p_coll->sock->frag_collectors--;
+}
+
 
 
 static void alloc_collector(struct rtskb *skb, struct rtsocket *sock)
 {
-    int                 i;
     rtdm_lockctx_t      context;
     struct ip_collector *p_coll;
     struct iphdr        *iph = skb->nh.iph;
 
 
     /*
-     * Find a free collector
-     *
-     * Note: We once used to clean up probably outdated chains, but the
-     * algorithm was not stable enough and could cause incorrect drops even
-     * under medium load. If we run in overload, we will loose data anyhow.
-     * What we should do in the future is to account collectors per socket or
-     * socket owner and set quotations.
-     * Garbage collection is now performed only on socket close.
+     * Grab a free collector, unless the socket already reached its
+     * quota, so that a single socket cannot starve the others.
+     * Incomplete messages are dropped by collector_timeout() when
+     * they expire.
      */
-    for (i = 0; i < COLLECTOR_COUNT; i++) {
-        p_coll = &collector[i];
-        rtdm_lock_get_irqsave(&p_coll->frags.lock, context);
-
-        if (!p_coll->in_use) {
-            p_coll->in_use        = 1;
-            p_coll->buf_size      = skb->len;
-            p_coll->frags.first   = skb;
-            p_coll->frags.last    = skb;
-            p_coll->saddr         = iph->saddr;
-            p_coll->daddr         = iph->daddr;
-            p_coll->id            = iph->id;
-            p_coll->protocol      = iph->protocol;
-            p_coll->sock          = sock;
-
-            rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
-
-            return;
-        }
+    rtdm_lock_get_irqsave(&collector_lock, context);
 
-        rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
+    if (frag_sock_quota > 0 && sock->frag_collectors >= frag_sock_quota) {
+        rtdm_lock_put_irqrestore(&collector_lock, context);
+#ifdef FRAG_DBG
+        rtdm_printk("RTnet: IP fragmentation - socket quota exceeded\n");
+#endif
+        kfree_rtskb(skb);
+        return;
     }
 
-    rtdm_printk("RTnet: IP fragmentation - no collector available\n");
-    kfree_rtskb(skb);
+    if (list_empty(&free_collectors)) {
+        rtdm_lock_put_irqrestore(&collector_lock, context);
+        rtdm_printk("RTnet: IP fragmentation - no collector available\n");
+        kfree_rtskb(skb);
+        return;
+    }
+
+    p_coll = list_first_entry(&free_collectors, struct ip_collector, list);
+    list_move_tail(&p_coll->list, &busy_collectors);
+
+    p_coll->buf_size      = skb->len;
+    p_coll->frags.first   = skb;
+    p_coll->frags.last    = skb;
+    p_coll->saddr         = iph->saddr;
+    p_coll->daddr         = iph->daddr;
+    p_coll->id            = iph->id;
+    p_coll->protocol      = iph->protocol;
+    p_coll->sock          = sock;
+    p_coll->expires       = rtdm_clock_read_monotonic() +
+        (nanosecs_abs_t)frag_timeout * 1000000;
+
+    hlist_add_head(&p_coll->hash,
+                   &collector_hash[collector_key(iph->saddr, iph->id,
+                                                 iph->protocol)]);
+    sock->frag_collectors++;
+
+    rtdm_lock_put_irqrestore(&collector_lock, context);
 }
 
 
@@ -112,21 +161,22 @@ static void alloc_collector(struct rtskb *skb, struct rtsocket *sock)
  * */
 static struct rtskb *add_to_collector(struct rtskb *skb, unsigned int offset, int more_frags)
 {
-	int                 i, err;
+    int                 err;
     rtdm_lockctx_t      context;
     struct ip_collector *p_coll;
     struct iphdr        *iph = skb->nh.iph;
     struct rtskb        *first_skb;
 
 
+    rtdm_lock_get_irqsave(&collector_lock, context);
+
     /* Search in existing collectors */
-    for (i = 0; i < COLLECTOR_COUNT; i++)
+    hlist_for_each_entry(p_coll,
+                         &collector_hash[collector_key(iph->saddr, iph->id,
+                                                       iph->protocol)],
+                         hash)
     {
-        p_coll = &collector[i];
-        rtdm_lock_get_irqsave(&p_coll->frags.lock, context);
-
-        if (p_coll->in_use  &&
-            (iph->saddr    == p_coll->saddr) &&
+        if ((iph->saddr    == p_coll->saddr) &&
             (iph->daddr    == p_coll->daddr) &&
             (iph->id       == p_coll->id) &&
             (iph->protocol == p_coll->protocol))
@@ -136,9 +186,9 @@ static struct rtskb *add_to_collector(struct rtskb *skb, unsigned int offset, in
             /* Acquire the rtskb at the expense of the protocol pool */
             if (rtskb_acquire(skb, &p_coll->sock->skb_pool) != 0) {
                 /* We have to drop this fragment => clean up the whole chain */
-                p_coll->in_use = 0;
+                release_collector(p_coll);
 
-                rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
+                rtdm_lock_put_irqrestore(&collector_lock, context);
 
 #ifdef FRAG_DBG
                 rtdm_printk("RTnet: Compensation pool empty - IP fragments "
@@ -162,37 +212,38 @@ static struct rtskb *add_to_collector(struct rtskb *skb, unsigned int offset, in
             /* Sanity check: unordered fragments are not allowed! */
             if (offset != p_coll->buf_size) {
                 /* We have to drop this fragment => clean up the whole chain */
-                p_coll->in_use = 0;
-                skb = first_skb;
+                release_collector(p_coll);
 
-                rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
-                break; /* leave the for loop */
+                rtdm_lock_put_irqrestore(&collector_lock, context);
+
+                kfree_rtskb(first_skb);
+                return NULL;
             }
 
             p_coll->buf_size += skb->len;
 
             if (!more_frags) {
-                p_coll->in_use = 0;
+                release_collector(p_coll);
 
-		err = rt_socket_reference(p_coll->sock);
+                err = rt_socket_reference(p_coll->sock);
 
-                rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
+                rtdm_lock_put_irqrestore(&collector_lock, context);
 
-		if (err < 0) {
-			kfree_rtskb(first_skb);
-			return NULL;
-		}
+                if (err < 0) {
+                    kfree_rtskb(first_skb);
+                    return NULL;
+                }
 
                 return first_skb;
             } else {
-                rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
+                rtdm_lock_put_irqrestore(&collector_lock, context);
                 return NULL;
             }
         }
-
-        rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
     }
 
+    rtdm_lock_put_irqrestore(&collector_lock, context);
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_PROXY)
     if (rt_ip_fallback_handler) {
             __rtskb_push(skb, iph->ihl*4);
@@ -212,30 +263,75 @@ static struct rtskb *add_to_collector(struct rtskb *skb, unsigned int offset, in
 
 
 
+/*
+ * Drops the incomplete messages which expired. Since all collectors
+ * share the same timeout, the busy list is ordered by expiry date.
+ */
+static void collector_timeout(rtdm_timer_t *timer)
+{
+    nanosecs_abs_t      now = rtdm_clock_read_monotonic();
+    rtdm_lockctx_t      context;
+    struct ip_collector *p_coll;
+    struct rtskb        *first_skb;
+#ifdef FRAG_DBG
+    __u32               saddr, daddr;
+#endif
+
+
+    for (;;) {
+        rtdm_lock_get_irqsave(&collector_lock, context);
+
+        if (list_empty(&busy_collectors))
+            break;
+
+        p_coll = list_first_entry(&busy_collectors, struct ip_collector, list);
+        if ((nanosecs_rel_t)(p_coll->expires - now) > 0)
+            break;
+
+        first_skb = p_coll->frags.first;
+#ifdef FRAG_DBG
+        /* the collector may be reused as soon as it is released */
+        saddr = p_coll->saddr;
+        daddr = p_coll->daddr;
+#endif
+        release_collector(p_coll);
+
+        rtdm_lock_put_irqrestore(&collector_lock, context);
+
+#ifdef FRAG_DBG
+        rtdm_printk("RTnet: IP fragments timed out (saddr:%x, daddr:%x)\n",
+                    saddr, daddr);
+#endif
+
+        kfree_rtskb(first_skb);
+    }
+
+    rtdm_lock_put_irqrestore(&collector_lock, context);
+}
+
+
+
 /*
  * Cleans up all collectors referring to the specified socket.
- * This is now the only kind of garbage collection we do.
  */
 void rt_ip_frag_invalidate_socket(struct rtsocket *sock)
 {
-    int                 i;
     rtdm_lockctx_t      context;
-    struct ip_collector *p_coll;
+    struct ip_collector *p_coll, *tmp;
 
 
-    for (i = 0; i < COLLECTOR_COUNT; i++)
-    {
-        p_coll = &collector[i];
-        rtdm_lock_get_irqsave(&p_coll->frags.lock, context);
+    rtdm_lock_get_irqsave(&collector_lock, context);
 
-        if ((p_coll->in_use) && (p_coll->sock == sock))
+    list_for_each_entry_safe(p_coll, tmp, &busy_collectors, list)
+    {
+        if (p_coll->sock == sock)
         {
-            p_coll->in_use = 0;
+            release_collector(p_coll);
             kfree_rtskb(p_coll->frags.first);
         }
-
-        rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
     }
+
+    rtdm_lock_put_irqrestore(&collector_lock, context);
 }
 EXPORT_SYMBOL_GPL(rt_ip_frag_invalidate_socket);
 
@@ -246,24 +342,19 @@ EXPORT_SYMBOL_GPL(rt_ip_frag_invalidate_socket);
  */
 static void cleanup_all_collectors(void)
 {
-    int                 i;
     rtdm_lockctx_t      context;
-    struct ip_collector *p_coll;
+    struct ip_collector *p_coll, *tmp;
 
 
-    for (i = 0; i < COLLECTOR_COUNT; i++)
-    {
-        p_coll = &collector[i];
-        rtdm_lock_get_irqsave(&p_coll->frags.lock, context);
+    rtdm_lock_get_irqsave(&collector_lock, context);
 
-        if (p_coll->in_use)
-        {
-            p_coll->in_use = 0;
-            kfree_rtskb(p_coll->frags.first);
-        }
-
-        rtdm_lock_put_irqrestore(&p_coll->frags.lock, context);
+    list_for_each_entry_safe(p_coll, tmp, &busy_collectors, list)
+    {
+        release_collector(p_coll);
+        kfree_rtskb(p_coll->frags.first);
     }
+
+    rtdm_lock_put_irqrestore(&collector_lock, context);
 }
 
 
@@ -332,14 +423,32 @@ struct rtskb *rt_ip_defrag(struct rtskb *skb, struct rtinet_protocol *ipprot)
 
 int __init rt_ip_fragment_init(void)
 {
-    int i;
+    nanosecs_rel_t period;
+    int i, ret;
 
 
-    /* Probably not needed (static variable...) */
-    memset(collector, 0, sizeof(collector));
+    for (i = 0; i < COLLECTOR_HASH_SIZE; i++)
+        INIT_HLIST_HEAD(&collector_hash[i]);
 
     for (i = 0; i < COLLECTOR_COUNT; i++)
-        rtdm_lock_init(&collector[i].frags.lock);
+        list_add_tail(&collector[i].list, &free_collectors);
+
+    if (frag_timeout == 0)
+        frag_timeout = 1000;
+
+    ret = rtdm_timer_init(&collector_timer, collector_timeout,
+                          "rtnet-ipfrag");
+    if (ret < 0)
+        return ret;
+
+    /* Check for expired messages twice per timeout period. */
+    period = (nanosecs_rel_t)frag_timeout * 1000000 / 2;
+    ret = rtdm_timer_start(&collector_timer, period, period,
+                           RTDM_TIMERMODE_RELATIVE);
+    if (ret < 0) {
+        rtdm_timer_destroy(&collector_timer);
+        return ret;
+    }
 
     return 0;
 }
@@ -348,5 +457,6 @@ int __init rt_ip_fragment_init(void)
 
 void rt_ip_fragment_cleanup(void)
 {
+    rtdm_timer_destroy(&collector_timer);
     cleanup_all_collectors();
 }
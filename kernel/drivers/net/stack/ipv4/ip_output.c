@@ -157,6 +157,98 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 
 
 
+/***
+ *  Path for unfragmented packets exceeding a single rtskb, requires a device
+ *  accepting multi-segment rtskbs
+ */
+static int rt_ip_build_xmit_sg(struct rtsocket *sk,
+	int getfrag(const void *, char *, unsigned int, unsigned int),
+	const void *frag, unsigned length, struct dest_route *rt,
+	unsigned int prio, int hh_len)
+{
+    int                     err;
+    struct rtskb            *skb;
+    struct rtskb            *seg;
+    struct iphdr            *iph;
+    struct  rtnet_device    *rtdev = rt->rtdev;
+    unsigned int            headlen = RTSKB_SIZE - hh_len - 15;
+    unsigned int            datalen = length - sizeof(struct iphdr);
+    unsigned int            offset;
+    unsigned int            seglen;
+    u16                     msg_rt_ip_id;
+    rtdm_lockctx_t          context;
+
+
+    /* Store id in local variable */
+    rtdm_lock_get_irqsave(&rt_ip_id_lock, context);
+    msg_rt_ip_id = rt_ip_id_count++;
+    rtdm_lock_put_irqrestore(&rt_ip_id_lock, context);
+
+    skb = alloc_rtskb(RTSKB_SIZE, &sk->skb_pool);
+    if (skb == NULL)
+	return -ENOBUFS;
+
+    rtskb_reserve(skb, hh_len);
+
+    skb->rtdev    = rtdev;
+    skb->nh.iph   = iph = (struct iphdr *)rtskb_put(skb, headlen);
+    skb->priority = prio;
+
+    iph->version  = 4;
+    iph->ihl      = 5;
+    iph->tos      = sk->prot.inet.tos;
+    iph->tot_len  = htons(length);
+    iph->id       = htons(msg_rt_ip_id);
+    iph->frag_off = htons(IP_DF);
+    iph->ttl      = 255;
+    iph->protocol = sk->protocol;
+    iph->saddr    = rtdev->local_ip;
+    iph->daddr    = rt->ip;
+    iph->check    = 0; /* required! */
+    iph->check    = ip_fast_csum((unsigned char *)iph, 5 /*iph->ihl*/);
+
+    /* The head carries the transport header, the payload is copied once
+       into the data segments, in order. */
+    offset = headlen - sizeof(struct iphdr);
+    if ( (err=getfrag(frag, ((char *)iph) + 5 /*iph->ihl*/ * 4, 0, offset)) )
+	goto error;
+
+    for (; offset < datalen; offset += seglen) {
+	seglen = min_t(unsigned int, datalen - offset, RTSKB_SIZE);
+
+	seg = alloc_rtskb(seglen, &sk->skb_pool);
+	if (seg == NULL) {
+	    err = -ENOBUFS;
+	    goto error;
+	}
+
+	err = getfrag(frag, rtskb_put(seg, seglen), offset, seglen);
+	rtskb_add_segment(skb, seg);
+	if (err)
+	    goto error;
+    }
+
+    if (rtdev->hard_header) {
+	err = rtdev->hard_header(skb, rtdev, ETH_P_IP, rt->dev_addr,
+				 rtdev->dev_addr, skb->len);
+	if (err < 0)
+	    goto error;
+    }
+
+    err = rtdev_xmit(skb);
+
+    if (err)
+	return -EAGAIN;
+    else
+	return 0;
+
+  error:
+    kfree_rtskb(skb);
+    return err;
+}
+
+
+
 /***
  *  Fast path for unfragmented packets.
  */
@@ -174,6 +266,8 @@ int rt_ip_build_xmit(struct rtsocket *sk,
     struct  rtnet_device    *rtdev = rt->rtdev;
     unsigned int            prio;
     unsigned int            mtu;
+    unsigned int            max_linear;
+    int                     sg;
 
 
     /* sk->priority may encode both priority and output channel. Make sure
@@ -188,18 +282,27 @@ int rt_ip_build_xmit(struct rtsocket *sk,
      */
     length += sizeof(struct iphdr);
 
-    if (length > mtu)
+    hh_len = (rtdev->hard_header_len+15)&~15;
+
+    /* Packets not fitting into a single rtskb (jumbo frames) are either
+       sent as multi-segment rtskbs or fragmented to the rtskb size. */
+    max_linear = RTSKB_SIZE - hh_len - 15;
+    sg = test_bit(PRIV_FLAG_SG_XMIT, &rtdev->priv_flags);
+
+    if ((length > mtu) || ((length > max_linear) && !sg))
 	return rt_ip_build_xmit_slow(sk, getfrag, frag,
 				     length - sizeof(struct iphdr),
-				     rt, msg_flags, mtu, prio);
+				     rt, msg_flags, min(mtu, max_linear), prio);
+
+    if (length > max_linear)
+	return rt_ip_build_xmit_sg(sk, getfrag, frag, length, rt, prio,
+				   hh_len);
 
     /* Store id in local variable */
     rtdm_lock_get_irqsave(&rt_ip_id_lock, context);
     msg_rt_ip_id = rt_ip_id_count++;
     rtdm_lock_put_irqrestore(&rt_ip_id_lock, context);
 
-    hh_len = (rtdev->hard_header_len+15)&~15;
-
     skb = alloc_rtskb(length+hh_len+15, &sk->skb_pool);
     if (skb==NULL)
 	return -ENOBUFS;
@@ -262,10 +365,18 @@ static struct rtpacket_type ip_packet_type = {
 /***
  *  ip_init
  */
-void __init rt_ip_init(void)
+int __init rt_ip_init(void)
 {
+    int ret;
+
+
+    ret = rt_ip_fragment_init();
+    if (ret < 0)
+        return ret;
+
     rtdev_add_pack(&ip_packet_type);
-    rt_ip_fragment_init();
+
+    return 0;
 }
 
 
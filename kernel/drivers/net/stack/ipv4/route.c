@@ -23,6 +23,8 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/bitops.h>
+#include <linux/seqlock.h>
 #include <net/ip.h>
 
 #include <rtnet_internal.h>
@@ -47,6 +49,7 @@ struct host_route {
 /* Second-level routing: routes to other networks */
 struct net_route {
     struct net_route        *next;
+    struct net_trie_node    *node;
     u32                     dest_net_ip;
     u32                     dest_net_mask;
     u32                     gw_ip;
@@ -72,24 +75,43 @@ static DEFINE_RTDM_LOCK(host_table_lock);
 #if (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES & (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES - 1))
 # error CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES must be power of 2
 #endif
-#if CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES < 256
-# define NET_HASH_TBL_SIZE  64
-#else
-# define NET_HASH_TBL_SIZE  ((CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES / 256) * 64)
-#endif
-#define NET_HASH_KEY_MASK   (NET_HASH_TBL_SIZE-1)
-#define NET_HASH_KEY_SHIFT  8
+
+/*
+ * Network routes are kept in a multibit trie consuming NET_TRIE_STRIDE
+ * bits of the destination address per level. A route of prefix length
+ * L is owned by the node at level (L-1) / NET_TRIE_STRIDE, and expanded
+ * over all slots of that node it covers (controlled prefix expansion),
+ * each slot pointing at the longest prefix owned by the node matching
+ * it. A lookup thus walks at most NET_TRIE_LEVELS nodes, whatever the
+ * number of routes. The default route (prefix length 0) is kept apart.
+ *
+ * Lookups run locklessly: nodes are drawn from a static pool so that
+ * any pointer a reader may follow remains valid, and updates are
+ * bracketed by net_trie_seq, readers retrying when they raced with a
+ * writer. Writers serialize on net_table_lock.
+ */
+#define NET_TRIE_STRIDE     4
+#define NET_TRIE_FANOUT     (1 << NET_TRIE_STRIDE)
+#define NET_TRIE_LEVELS     (32 / NET_TRIE_STRIDE)
+#define NET_TRIE_NODES      (CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES * 4)
+
+struct net_trie_node {
+    struct net_trie_node    *child[NET_TRIE_FANOUT];
+    struct net_route        *route[NET_TRIE_FANOUT];
+    struct net_route        *routes;    /* routes owned by this node */
+    unsigned int            refs;       /* routes owned at or below */
+};
 
 static struct net_route     net_routes[CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES];
 static struct net_route     *free_net_route;
 static int                  allocated_net_routes;
-static struct net_route     *net_hash_tbl[NET_HASH_TBL_SIZE + 1];
-static unsigned int         net_hash_key_shift = NET_HASH_KEY_SHIFT;
+static struct net_trie_node net_trie_nodes[NET_TRIE_NODES];
+static struct net_trie_node *free_net_trie_node;
+static int                  allocated_net_trie_nodes;
+static struct net_trie_node net_trie_root;
+static struct net_route     *net_default_route;
+static seqcount_t           net_trie_seq;
 static DEFINE_RTDM_LOCK(net_table_lock);
-
-module_param(net_hash_key_shift, uint, 0444);
-MODULE_PARM_DESC(net_hash_key_shift, "destination right shift for "
-		 "network hash key (default: 8)");
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 
@@ -100,10 +122,6 @@ MODULE_PARM_DESC(net_hash_key_shift, "destination right shift for "
 #ifdef CONFIG_XENO_OPT_VFILE
 static int rtnet_ipv4_route_show(struct xnvfile_regular_iterator *it, void *d)
 {
-#ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-    u32 mask;
-#endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
-
     xnvfile_printf(it, "Host routes allocated/total:\t%d/%d\n"
 	    "Host hash table size:\t\t%d\n",
 	    allocated_host_routes,
@@ -111,13 +129,13 @@ static int rtnet_ipv4_route_show(struct xnvfile_regular_iterator *it, void *d)
 	    HOST_HASH_TBL_SIZE);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
-    mask = NET_HASH_KEY_MASK << net_hash_key_shift;
     xnvfile_printf(it, "Network routes allocated/total:\t%d/%d\n"
-	    "Network hash table size:\t%d\n"
-	    "Network hash key shift/mask:\t%d/%08X\n",
+	    "Network trie nodes used/total:\t%d/%d\n"
+	    "Network trie stride/depth:\t%d/%d\n",
 	    allocated_net_routes,
-	    CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES, NET_HASH_TBL_SIZE,
-	    net_hash_key_shift, mask);
+	    CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES,
+	    allocated_net_trie_nodes + 1, NET_TRIE_NODES + 1,
+	    NET_TRIE_STRIDE, NET_TRIE_LEVELS);
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_ROUTER
@@ -316,12 +334,14 @@ static struct xnvfile_lock_ops rtnet_ipv4_net_route_lock_ops = {
 };
 
 struct rtnet_ipv4_net_route_priv {
-    unsigned key;
+    int level;
+    struct net_trie_node *path[NET_TRIE_LEVELS];
+    unsigned slot[NET_TRIE_LEVELS];
     struct net_route *entry_ptr;
 };
 
 struct rtnet_ipv4_net_route_data {
-    int key;
+    int prefix_len;
     u32 dest_net_ip;
     u32 dest_net_mask;
     u32 gw_ip;
@@ -350,7 +370,7 @@ static void *rtnet_ipv4_net_route_begin(struct xnvfile_snapshot_iterator *it)
 	return VFILE_SEQ_EMPTY;
     }
 
-    priv->key = -1;
+    priv->level = -1;
     priv->entry_ptr = NULL;
     return data;
 }
@@ -362,29 +382,60 @@ static void rtnet_ipv4_net_route_end(struct xnvfile_snapshot_iterator *it,
     kfree(buf);
 }
 
+static void rtnet_ipv4_net_route_fill(struct rtnet_ipv4_net_route_data *p,
+				      struct net_route *rt)
+{
+    p->prefix_len = hweight32(rt->dest_net_mask);
+    p->dest_net_ip = rt->dest_net_ip;
+    p->dest_net_mask = rt->dest_net_mask;
+    p->gw_ip = rt->gw_ip;
+}
+
+/* depth-first walk of the trie, the default route coming first */
 static int rtnet_ipv4_net_route_next(struct xnvfile_snapshot_iterator *it,
 				    void *data)
 {
     struct rtnet_ipv4_net_route_priv *priv = xnvfile_iterator_priv(it);
     struct rtnet_ipv4_net_route_data *p = data;
+    struct net_trie_node *node;
 
-    if (priv->entry_ptr == NULL) {
-	if (++priv->key >= NET_HASH_TBL_SIZE + 1)
-	    return 0;
+    if (priv->level < 0) {
+	priv->level = 0;
+	priv->path[0] = &net_trie_root;
+	priv->slot[0] = 0;
+	priv->entry_ptr = net_trie_root.routes;
 
-	priv->entry_ptr = net_hash_tbl[priv->key];
-	if (priv->entry_ptr == NULL)
-	    return VFILE_SEQ_SKIP;
+	if (net_default_route != NULL) {
+	    rtnet_ipv4_net_route_fill(p, net_default_route);
+	    return 1;
+	}
     }
 
-    p->key = priv->key;
-    p->dest_net_ip = priv->entry_ptr->dest_net_ip;
-    p->dest_net_mask = priv->entry_ptr->dest_net_mask;
-    p->gw_ip = priv->entry_ptr->gw_ip;
+    for (;;) {
+	if (priv->entry_ptr != NULL) {
+	    rtnet_ipv4_net_route_fill(p, priv->entry_ptr);
+	    priv->entry_ptr = priv->entry_ptr->next;
+	    return 1;
+	}
 
-    priv->entry_ptr = priv->entry_ptr->next;
+	node = priv->path[priv->level];
+	while ((priv->slot[priv->level] < NET_TRIE_FANOUT) &&
+	       (node->child[priv->slot[priv->level]] == NULL))
+	    priv->slot[priv->level]++;
+
+	if (priv->slot[priv->level] < NET_TRIE_FANOUT) {
+	    node = node->child[priv->slot[priv->level]++];
+	    priv->level++;
+	    priv->path[priv->level] = node;
+	    priv->slot[priv->level] = 0;
+	    priv->entry_ptr = node->routes;
+	    continue;
+	}
 
-    return 1;
+	if (priv->level == 0)
+	    return 0;
+	priv->level--;
+    }
 }
 
 static int rtnet_ipv4_net_route_show(struct xnvfile_snapshot_iterator *it,
@@ -393,22 +444,13 @@ static int rtnet_ipv4_net_route_show(struct xnvfile_snapshot_iterator *it,
     struct rtnet_ipv4_net_route_data *p = data;
 
     if (p == NULL) {
-	xnvfile_printf(it, "Hash\tDestination\tMask\t\t\tGateway\n");
+	xnvfile_printf(it, "Prefix\tDestination\tMask\t\t\tGateway\n");
 	return 0;
     }
 
-    if (p->key < NET_HASH_TBL_SIZE)
-	xnvfile_printf(it, "%02X\t%u.%u.%u.%-3u\t%u.%u.%u.%-3u"
-		    "\t\t%u.%u.%u.%-3u\n",
-		    p->key, NIPQUAD(p->dest_net_ip),
-		    NIPQUAD(p->dest_net_mask),
-		    NIPQUAD(p->gw_ip));
-    else
-	xnvfile_printf(it, "*\t%u.%u.%u.%-3u\t%u.%u.%u.%-3u\t\t"
-		    "%u.%u.%u.%-3u\n",
-		    NIPQUAD(p->dest_net_ip),
-		    NIPQUAD(p->dest_net_mask),
-		    NIPQUAD(p->gw_ip));
+    xnvfile_printf(it, "/%d\t%u.%u.%u.%-3u\t%u.%u.%u.%-3u\t\t%u.%u.%u.%-3u\n",
+		   p->prefix_len, NIPQUAD(p->dest_net_ip),
+		   NIPQUAD(p->dest_net_mask), NIPQUAD(p->gw_ip));
 
     return 0;
 }
@@ -754,27 +796,135 @@ static inline struct net_route *rt_alloc_net_route(void)
  */
 static inline void rt_free_net_route(struct net_route *rt)
 {
+    rt->node       = NULL;
     rt->next       = free_net_route;
     free_net_route = rt;
-    allocated_host_routes--;
+    allocated_net_routes--;
 }
 
 
 
 /***
- *  rt_ip_route_add_net: add or update network route
+ *  rt_alloc_net_trie_node - allocates new trie node
+ *
+ *  Note: must be called with net_table_lock held
  */
-int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
+static inline struct net_trie_node *rt_alloc_net_trie_node(void)
 {
-    rtdm_lockctx_t      context;
-    struct net_route    *new_route;
-    struct net_route    *rt;
-    struct net_route    **last_ptr;
-    unsigned int        key;
-    u32                 shifted_mask;
+    struct net_trie_node *node;
+
+
+    if ((node = free_net_trie_node) != NULL) {
+	free_net_trie_node = node->child[0];
+	memset(node, 0, sizeof(*node));
+	allocated_net_trie_nodes++;
+    }
+
+    return node;
+}
 
 
-    addr &= mask;
+
+/***
+ *  rt_free_net_trie_node - releases trie node
+ *
+ *  Note: must be called with net_table_lock held. Readers may still be
+ *  walking the node, which is why it goes back to the static pool only.
+ */
+static inline void rt_free_net_trie_node(struct net_trie_node *node)
+{
+    node->child[0]     = free_net_trie_node;
+    free_net_trie_node = node;
+    allocated_net_trie_nodes--;
+}
+
+
+
+static inline unsigned int net_trie_index(u32 haddr, int level)
+{
+    return (haddr >> (32 - NET_TRIE_STRIDE * (level + 1))) &
+	(NET_TRIE_FANOUT - 1);
+}
+
+
+
+/***
+ *  net_trie_update - recomputes the expanded slots of a trie node
+ *
+ *  Note: must be called with net_table_lock held, within a write
+ *  section of net_trie_seq
+ */
+static void net_trie_update(struct net_trie_node *node, int level)
+{
+    unsigned int        shift = 32 - NET_TRIE_STRIDE * (level + 1);
+    u32                 node_mask = (u32)(NET_TRIE_FANOUT - 1) << shift;
+    struct net_route    *rt, *best;
+    u32                 mask;
+    int                 i;
+
+
+    for (i = 0; i < NET_TRIE_FANOUT; i++) {
+	best = NULL;
+	for (rt = node->routes; rt != NULL; rt = rt->next) {
+	    mask = ntohl(rt->dest_net_mask);
+	    if (((((u32)i << shift) ^ ntohl(rt->dest_net_ip)) &
+		 mask & node_mask) != 0)
+		continue;
+	    if ((best == NULL) || (mask > ntohl(best->dest_net_mask)))
+		best = rt;
+	}
+	node->route[i] = best;
+    }
+}
+
+
+
+/***
+ *  net_trie_prune - releases the unused nodes at the end of a path
+ *
+ *  Note: must be called with net_table_lock held, within a write
+ *  section of net_trie_seq
+ */
+static void net_trie_prune(struct net_trie_node **path, u32 haddr, int depth)
+{
+    int level;
+
+
+    for (level = depth; level > 0; level--) {
+	if (path[level]->refs > 0)
+	    break;
+
+	path[level - 1]->child[net_trie_index(haddr, level - 1)] = NULL;
+	rt_free_net_trie_node(path[level]);
+    }
+}
+
+
+
+/***
+ *  rt_ip_route_add_net: add or update network route
+ */
+int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
+{
+    rtdm_lockctx_t          context;
+    struct net_trie_node    *path[NET_TRIE_LEVELS];
+    struct net_trie_node    *node;
+    struct net_route        *new_route;
+    struct net_route        *rt;
+    int                     depth;
+    int                     level;
+    unsigned int            key;
+    u32                     haddr;
+    u32                     hmask;
+
+
+    /* the trie can only represent contiguous network masks */
+    hmask = ntohl(mask);
+    if ((hmask | (hmask - 1)) != 0xFFFFFFFF)
+	return -EINVAL;
+
+    addr  &= mask;
+    haddr = ntohl(addr);
 
     if ((new_route = rt_alloc_net_route()) != NULL) {
 	new_route->dest_net_ip   = addr;
@@ -782,47 +932,87 @@ int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
 	new_route->gw_ip         = gw_addr;
     }
 
-    shifted_mask = NET_HASH_KEY_MASK << net_hash_key_shift;
-    if ((mask & shifted_mask) == shifted_mask)
-	key = (ntohl(addr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-    else
-	key = NET_HASH_TBL_SIZE;
-    last_ptr = &net_hash_tbl[key];
-
     rtdm_lock_get_irqsave(&net_table_lock, context);
 
     xnvfile_touch_tag(&net_route_tag);
 
-    rt = net_hash_tbl[key];
-    while (rt != NULL) {
-	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
-	    rt->gw_ip = gw_addr;
+    raw_write_seqcount_begin(&net_trie_seq);
 
-	    if (new_route)
-		rt_free_net_route(new_route);
+    if (hmask == 0) {
+	if (net_default_route != NULL) {
+	    net_default_route->gw_ip = gw_addr;
+	    goto update_done;
+	}
+	if (new_route == NULL)
+	    goto no_bufs;
 
-	    rtdm_lock_put_irqrestore(&net_table_lock, context);
+	new_route->node   = &net_trie_root;
+	new_route->next   = NULL;
+	net_default_route = new_route;
+	goto added;
+    }
 
-	    return 0;
+    depth = (hweight32(hmask) - 1) / NET_TRIE_STRIDE;
+
+    node = &net_trie_root;
+    for (level = 0; level < depth; level++) {
+	path[level] = node;
+	key = net_trie_index(haddr, level);
+	if (node->child[key] == NULL) {
+	    node->child[key] = rt_alloc_net_trie_node();
+	    if (node->child[key] == NULL) {
+		net_trie_prune(path, haddr, level);
+		goto no_bufs;
+	    }
 	}
+	node = node->child[key];
+    }
+    path[depth] = node;
 
-	last_ptr = &rt->next;
-	rt = rt->next;
+    for (rt = node->routes; rt != NULL; rt = rt->next)
+	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
+	    rt->gw_ip = gw_addr;
+	    goto update_done;
+	}
+
+    if (new_route == NULL) {
+	net_trie_prune(path, haddr, depth);
+	goto no_bufs;
     }
 
-    if (new_route) {
-	new_route->next = *last_ptr;
-	*last_ptr       = new_route;
+    new_route->node = node;
+    new_route->next = node->routes;
+    node->routes    = new_route;
 
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+    for (level = 0; level <= depth; level++)
+	path[level]->refs++;
 
-	return 0;
-    } else {
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+    net_trie_update(node, depth);
 
-	/*ERRMSG*/rtdm_printk("RTnet: no more network routes available\n");
-	return -ENOBUFS;
-    }
+  added:
+    raw_write_seqcount_end(&net_trie_seq);
+    rtdm_lock_put_irqrestore(&net_table_lock, context);
+
+    return 0;
+
+  update_done:
+    if (new_route)
+	rt_free_net_route(new_route);
+
+    raw_write_seqcount_end(&net_trie_seq);
+    rtdm_lock_put_irqrestore(&net_table_lock, context);
+
+    return 0;
+
+  no_bufs:
+    if (new_route)
+	rt_free_net_route(new_route);
+
+    raw_write_seqcount_end(&net_trie_seq);
+    rtdm_lock_put_irqrestore(&net_table_lock, context);
+
+    /*ERRMSG*/rtdm_printk("RTnet: no more network routes available\n");
+    return -ENOBUFS;
 }
 
 
@@ -832,45 +1022,114 @@ int rt_ip_route_add_net(u32 addr, u32 mask, u32 gw_addr)
  */
 int rt_ip_route_del_net(u32 addr, u32 mask)
 {
-    rtdm_lockctx_t      context;
-    struct net_route    *rt;
-    struct net_route    **last_ptr;
-    unsigned int        key;
-    u32                 shifted_mask;
+    rtdm_lockctx_t          context;
+    struct net_trie_node    *path[NET_TRIE_LEVELS];
+    struct net_trie_node    *node;
+    struct net_route        *rt;
+    struct net_route        **last_ptr;
+    int                     depth;
+    int                     level;
+    u32                     haddr;
+    u32                     hmask;
+    int                     ret = -ENOENT;
 
 
-    addr &= mask;
+    hmask = ntohl(mask);
+    if ((hmask | (hmask - 1)) != 0xFFFFFFFF)
+	return -ENOENT;
 
-    shifted_mask = NET_HASH_KEY_MASK << net_hash_key_shift;
-    if ((mask & shifted_mask) == shifted_mask)
-	key = (ntohl(addr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-    else
-	key = NET_HASH_TBL_SIZE;
-    last_ptr = &net_hash_tbl[key];
+    addr  &= mask;
+    haddr = ntohl(addr);
 
     rtdm_lock_get_irqsave(&net_table_lock, context);
 
-    rt = net_hash_tbl[key];
-    while (rt != NULL) {
-	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
-	    *last_ptr = rt->next;
+    raw_write_seqcount_begin(&net_trie_seq);
 
+    if (hmask == 0) {
+	if ((rt = net_default_route) != NULL) {
+	    net_default_route = NULL;
 	    rt_free_net_route(rt);
+	    ret = 0;
+	}
+	goto out;
+    }
+
+    depth = (hweight32(hmask) - 1) / NET_TRIE_STRIDE;
 
-	    xnvfile_touch_tag(&net_route_tag);
+    node = &net_trie_root;
+    for (level = 0; level < depth; level++) {
+	path[level] = node;
+	node = node->child[net_trie_index(haddr, level)];
+	if (node == NULL)
+	    goto out;
+    }
+    path[depth] = node;
 
-	    rtdm_lock_put_irqrestore(&net_table_lock, context);
+    last_ptr = &node->routes;
+    for (rt = node->routes; rt != NULL; rt = rt->next) {
+	if ((rt->dest_net_ip == addr) && (rt->dest_net_mask == mask)) {
+	    *last_ptr = rt->next;
 
-	    return 0;
-	}
+	    for (level = 0; level <= depth; level++)
+		path[level]->refs--;
 
+	    net_trie_update(node, depth);
+	    net_trie_prune(path, haddr, depth);
+	    rt_free_net_route(rt);
+	    ret = 0;
+	    break;
+	}
 	last_ptr = &rt->next;
-	rt = rt->next;
     }
 
+  out:
+    raw_write_seqcount_end(&net_trie_seq);
+
+    if (ret == 0)
+	xnvfile_touch_tag(&net_route_tag);
+
     rtdm_lock_put_irqrestore(&net_table_lock, context);
 
-    return -ENOENT;
+    return ret;
+}
+
+
+
+/***
+ *  rt_ip_route_lookup_net - looks up the gateway of the longest matching
+ *                           network route
+ *
+ *  Note: runs locklessly, see net_trie_seq
+ */
+static int rt_ip_route_lookup_net(u32 daddr, u32 *gw_ip)
+{
+    struct net_trie_node    *node;
+    struct net_route        *best;
+    struct net_route        *rt;
+    unsigned int            seq;
+    unsigned int            key;
+    int                     level;
+    u32                     haddr = ntohl(daddr);
+
+
+    do {
+	seq  = raw_read_seqcount_begin(&net_trie_seq);
+	best = READ_ONCE(net_default_route);
+	node = &net_trie_root;
+
+	/* deeper nodes always hold longer prefixes */
+	for (level = 0; (node != NULL) && (level < NET_TRIE_LEVELS); level++) {
+	    key = net_trie_index(haddr, level);
+	    if ((rt = READ_ONCE(node->route[key])) != NULL)
+		best = rt;
+	    node = READ_ONCE(node->child[key]);
+	}
+
+	if (best != NULL)
+	    *gw_ip = READ_ONCE(best->gw_ip);
+    } while (read_seqcount_retry(&net_trie_seq, seq));
+
+    return (best != NULL) ? 0 : -ENOENT;
 }
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
@@ -892,7 +1151,6 @@ int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
 #else
     #define DADDR       real_daddr
 
-    struct net_route    *net_rt;
     int                 lookup_gw  = 1;
     u32                 real_daddr = daddr;
 
@@ -940,44 +1198,10 @@ int rt_ip_route_output(struct dest_route *rt_buf, u32 daddr, u32 saddr)
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING
     if (lookup_gw) {
 	lookup_gw = 0;
-	key = (ntohl(daddr) >> net_hash_key_shift) & NET_HASH_KEY_MASK;
-
-	rtdm_lock_get_irqsave(&net_table_lock, context);
-
-	net_rt = net_hash_tbl[key];
-	while (net_rt != NULL) {
-	    if (net_rt->dest_net_ip == (daddr & net_rt->dest_net_mask)) {
-		daddr = net_rt->gw_ip;
-
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-		/* start over, now using the gateway ip as destination */
-		goto restart;
-	    }
-
-	    net_rt = net_rt->next;
-	}
 
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-	/* last try: no hash key */
-	rtdm_lock_get_irqsave(&net_table_lock, context);
-
-	net_rt = net_hash_tbl[NET_HASH_TBL_SIZE];
-	while (net_rt != NULL) {
-	    if (net_rt->dest_net_ip == (daddr & net_rt->dest_net_mask)) {
-		daddr = net_rt->gw_ip;
-
-		rtdm_lock_put_irqrestore(&net_table_lock, context);
-
-		/* start over, now using the gateway ip as destination */
-		goto restart;
-	    }
-
-	    net_rt = net_rt->next;
-	}
-
-	rtdm_lock_put_irqrestore(&net_table_lock, context);
+	/* start over, now using the gateway ip as destination */
+	if (rt_ip_route_lookup_net(daddr, &daddr) == 0)
+	    goto restart;
     }
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
@@ -1045,6 +1269,12 @@ int __init rt_ip_routing_init(void)
     for (i = 0; i < CONFIG_XENO_DRIVERS_NET_RTIPV4_NET_ROUTES-2; i++)
 	net_routes[i].next = &net_routes[i+1];
     free_net_route = &net_routes[0];
+
+    for (i = 0; i < NET_TRIE_NODES-1; i++)
+	net_trie_nodes[i].child[0] = &net_trie_nodes[i+1];
+    free_net_trie_node = &net_trie_nodes[0];
+
+    seqcount_init(&net_trie_seq);
 #endif /* CONFIG_XENO_DRIVERS_NET_RTIPV4_NETROUTING */
 
 #ifdef CONFIG_XENO_OPT_VFILE
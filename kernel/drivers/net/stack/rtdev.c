@@ -276,7 +276,7 @@ struct rtnet_device *rtdev_alloc(unsigned sizeof_priv, unsigned dev_pool_size)
     memset(rtdev, 0, alloc_size);
 
     ret = rtskb_pool_init(&rtdev->dev_pool, dev_pool_size, &rtdev_ops, rtdev);
-    if (ret < dev_pool_size) {
+    if (ret < dev_pool_size || rtskb_pool_enable_cache(&rtdev->dev_pool) < 0) {
 	printk(KERN_ERR "RTnet: cannot allocate rtnet device pool\n");
 	rtskb_pool_release(&rtdev->dev_pool);
 	kfree(rtdev);
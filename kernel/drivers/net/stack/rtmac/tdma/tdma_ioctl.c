@@ -39,6 +39,7 @@ static int tdma_ioctl_master(struct rtnet_device *rtdev,
     struct tdma_priv    *tdma;
     u64                 cycle_ms;
     unsigned int        table_size;
+    unsigned int        entries;
     int                 ret;
 
 
@@ -77,17 +78,23 @@ static int tdma_ioctl_master(struct rtnet_device *rtdev,
         goto err_out;
     }
 
-    table_size = sizeof(struct tdma_slot *) *
-        ((cfg->args.master.max_slot_id >= 1) ?
-            cfg->args.master.max_slot_id + 1 : 2);
+    entries = (cfg->args.master.max_slot_id >= 1) ?
+        cfg->args.master.max_slot_id + 1 : 2;
+    table_size = sizeof(struct tdma_slot *) * entries;
 
-    tdma->slot_table = (struct tdma_slot **)kmalloc(table_size, GFP_KERNEL);
+    /* the worker's cycle table is appended to the slot table */
+    tdma->slot_table = (struct tdma_slot **)
+        kmalloc(ALIGN(table_size, sizeof(u64)) +
+                sizeof(struct tdma_slot_instant) * entries, GFP_KERNEL);
     if (!tdma->slot_table) {
         ret = -ENOMEM;
         goto err_out;
     }
     tdma->max_slot_id = cfg->args.master.max_slot_id;
     memset(tdma->slot_table, 0, table_size);
+    tdma->cycle_table = (struct tdma_slot_instant *)
+        ((char *)tdma->slot_table + ALIGN(table_size, sizeof(u64)));
+    tdma->cycle_table_size = entries;
 
     tdma->cycle_period = cfg->args.master.cycle_period;
     tdma->sync_job.ref_count = 0;
@@ -134,6 +141,7 @@ static int tdma_ioctl_slave(struct rtnet_device *rtdev,
 {
     struct tdma_priv    *tdma;
     unsigned int        table_size;
+    unsigned int        entries;
     int                 ret;
 
 
@@ -158,17 +166,23 @@ static int tdma_ioctl_slave(struct rtnet_device *rtdev,
     if (tdma->cal_rounds == 0)
         set_bit(TDMA_FLAG_CALIBRATED, &tdma->flags);
 
-    table_size = sizeof(struct tdma_slot *) *
-        ((cfg->args.slave.max_slot_id >= 1) ?
-            cfg->args.slave.max_slot_id + 1 : 2);
+    entries = (cfg->args.slave.max_slot_id >= 1) ?
+        cfg->args.slave.max_slot_id + 1 : 2;
+    table_size = sizeof(struct tdma_slot *) * entries;
 
-    tdma->slot_table = (struct tdma_slot **)kmalloc(table_size, GFP_KERNEL);
+    /* the worker's cycle table is appended to the slot table */
+    tdma->slot_table = (struct tdma_slot **)
+        kmalloc(ALIGN(table_size, sizeof(u64)) +
+                sizeof(struct tdma_slot_instant) * entries, GFP_KERNEL);
     if (!tdma->slot_table) {
         ret = -ENOMEM;
         goto err_out;
     }
     tdma->max_slot_id = cfg->args.slave.max_slot_id;
     memset(tdma->slot_table, 0, table_size);
+    tdma->cycle_table = (struct tdma_slot_instant *)
+        ((char *)tdma->slot_table + ALIGN(table_size, sizeof(u64)));
+    tdma->cycle_table_size = entries;
 
     tdma->sync_job.id        = WAIT_ON_SYNC;
     tdma->sync_job.ref_count = 0;
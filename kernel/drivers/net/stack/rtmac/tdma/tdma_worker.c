@@ -26,30 +26,62 @@
 #include <rtmac/tdma/tdma_proto.h>
 
 
-static void do_slot_job(struct tdma_priv *tdma, struct tdma_slot *job,
-                        rtdm_lockctx_t lockctx)
+static struct tdma_job *do_slot_jobs(struct tdma_priv *tdma,
+                                     struct tdma_job *job,
+                                     rtdm_lockctx_t lockctx)
 {
-    struct rtskb *rtskb;
-
-    if ((job->period != 1) &&
-        (tdma->current_cycle % job->period != job->phasing))
-        return;
+    struct tdma_slot_instant    *instant;
+    struct tdma_slot_instant    *end = tdma->cycle_table;
+    struct tdma_job             *first_job = job;
+    struct tdma_job             *last_job;
+    struct tdma_slot            *slot;
+    struct rtskb                *rtskb;
+    u32                         cycle = tdma->current_cycle;
+    u64                         cycle_start = tdma->current_cycle_start;
+
+    /* compile the run of slot jobs starting here into the transmission
+     * instants of the current cycle, keeping each listed slot referenced */
+    do {
+        slot = SLOT_JOB(job);
+        if ((slot->period == 1) || (cycle % slot->period == slot->phasing)) {
+            job->ref_count++;
+            end->xmit_time = cycle_start + slot->offset;
+            end->slot = slot;
+            end++;
+        }
+        last_job = job;
+        job = list_entry(job->entry.next, struct tdma_job, entry);
+    } while ((job->id >= 0) &&
+             (end - tdma->cycle_table < tdma->cycle_table_size));
+
+    /* resume the job list walk after the run */
+    tdma->current_job = last_job;
+    last_job->ref_count++;
+
+    for (instant = tdma->cycle_table; instant < end; instant++) {
+        /* dequeue ahead, only the transmission is left after wakeup */
+        rtskb = __rtskb_prio_dequeue(instant->slot->queue);
+        rtdm_lock_put_irqrestore(&tdma->lock, lockctx);
 
-    rtdm_lock_put_irqrestore(&tdma->lock, lockctx);
+        /* wait for slot begin, then send one pending packet */
+        rtdm_task_sleep_abs(instant->xmit_time, RTDM_TIMERMODE_REALTIME);
 
-    /* wait for slot begin, then send one pending packet */
-    rtdm_task_sleep_abs(tdma->current_cycle_start + SLOT_JOB(job)->offset,
-                        RTDM_TIMERMODE_REALTIME);
+        if (!rtskb) {
+            rtdm_lock_get_irqsave(&tdma->lock, lockctx);
+            rtskb = __rtskb_prio_dequeue(instant->slot->queue);
+            rtdm_lock_put_irqrestore(&tdma->lock, lockctx);
+        }
+        if (rtskb)
+            rtmac_xmit(rtskb);
 
-    rtdm_lock_get_irqsave(&tdma->lock, lockctx);
-    rtskb = __rtskb_prio_dequeue(SLOT_JOB(job)->queue);
-    if (!rtskb)
-        return;
-    rtdm_lock_put_irqrestore(&tdma->lock, lockctx);
+        rtdm_lock_get_irqsave(&tdma->lock, lockctx);
+    }
 
-    rtmac_xmit(rtskb);
+    for (instant = tdma->cycle_table; instant < end; instant++)
+        instant->slot->head.ref_count--;
+    first_job->ref_count--;
 
-    rtdm_lock_get_irqsave(&tdma->lock, lockctx);
+    return last_job;
 }
 
 static void do_xmit_sync_job(struct tdma_priv *tdma, rtdm_lockctx_t lockctx)
@@ -216,7 +248,7 @@ void tdma_worker(void *arg)
 #endif /* CONFIG_XENO_DRIVERS_NET_TDMA_MASTER */
 
             default:
-                do_slot_job(tdma, SLOT_JOB(job), lockctx);
+                job = do_slot_jobs(tdma, job, lockctx);
                 break;
         }
         job->ref_count--;
@@ -22,6 +22,7 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <net/checksum.h>
 
@@ -34,6 +35,11 @@ static unsigned int global_rtskbs    = DEFAULT_GLOBAL_RTSKBS;
 module_param(global_rtskbs, uint, 0444);
 MODULE_PARM_DESC(global_rtskbs, "Number of realtime socket buffers in global pool");
 
+static unsigned int rtskb_cache_size = 16;
+module_param(rtskb_cache_size, uint, 0444);
+MODULE_PARM_DESC(rtskb_cache_size, "Size of per-CPU rtskb caches in front of "
+		 "shared pools (default: 16, 0: disabled)");
+
 
 /* Linux slab pool for rtskbs */
 static struct kmem_cache *rtskb_slab_pool;
@@ -64,10 +70,12 @@ EXPORT_SYMBOL_GPL(rtcap_handler);
 unsigned int rtskb_copy_and_csum_bits(const struct rtskb *skb, int offset,
 				      u8 *to, int len, unsigned int csum)
 {
-    int copy;
+    const struct rtskb *seg;
+    int start = rtskb_headlen(skb);
+    int copy, end;
 
     /* Copy header. */
-    if ((copy = skb->len-offset) > 0) {
+    if ((copy = start-offset) > 0) {
 	if (copy > len)
 	    copy = len;
 	csum = csum_partial_copy_nocheck(skb->data+offset, to, copy, csum);
@@ -77,6 +85,22 @@ unsigned int rtskb_copy_and_csum_bits(const struct rtskb *skb, int offset,
 	to += copy;
     }
 
+    /* Copy data segments. */
+    rtskb_for_each_segment(skb, seg) {
+	end = start + seg->len;
+	if ((copy = end-offset) > 0) {
+	    if (copy > len)
+		copy = len;
+	    csum = csum_partial_copy_nocheck(seg->data+offset-start, to, copy,
+					     csum);
+	    if ((len -= copy) == 0)
+		return csum;
+	    offset += copy;
+	    to += copy;
+	}
+	start = end;
+    }
+
     RTNET_ASSERT(len == 0, );
     return csum;
 }
@@ -95,10 +119,10 @@ void rtskb_copy_and_csum_dev(const struct rtskb *skb, u8 *to)
     if (skb->ip_summed == CHECKSUM_PARTIAL) {
 	csstart = skb->h.raw - skb->data;
 
-	if (csstart > skb->len)
+	if (csstart > rtskb_headlen(skb))
 	    BUG();
     } else
-	csstart = skb->len;
+	csstart = rtskb_headlen(skb);
 
     memcpy(to, skb->data, csstart);
 
@@ -151,6 +175,151 @@ void rtskb_under_panic(struct rtskb *skb, int sz, void *here)
 EXPORT_SYMBOL_GPL(rtskb_under_panic);
 #endif /* CONFIG_XENO_DRIVERS_NET_CHECKED */
 
+/* Move up to half a cache worth of rtskbs from the pool's queue. */
+static void rtskb_cache_refill(struct rtskb_pool *pool,
+			       struct rtskb_pool_cache *cache)
+{
+    struct rtskb_queue *queue = &pool->queue;
+    struct rtskb *skb;
+
+    rtdm_lock_get(&queue->lock);
+
+    while (cache->len < rtskb_cache_size / 2) {
+	skb = __rtskb_dequeue(queue);
+	if (skb == NULL)
+	    break;
+	skb->next = cache->first;
+	cache->first = skb;
+	cache->len++;
+    }
+
+    rtdm_lock_put(&queue->lock);
+}
+
+/* Move all but @keep rtskbs of the cache back to the pool's queue. */
+static void rtskb_cache_flush(struct rtskb_pool *pool,
+			      struct rtskb_pool_cache *cache,
+			      unsigned int keep)
+{
+    struct rtskb_queue *queue = &pool->queue;
+    struct rtskb *skb;
+
+    rtdm_lock_get(&queue->lock);
+
+    while (cache->len > keep) {
+	skb = cache->first;
+	cache->first = skb->next;
+	cache->len--;
+	skb->chain_end = skb;
+	__rtskb_queue_tail(queue, skb);
+    }
+
+    rtdm_lock_put(&queue->lock);
+}
+
+static struct rtskb *rtskb_cache_steal(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+    struct rtskb *skb = NULL;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+	cache = per_cpu_ptr(pool->cache, cpu);
+	rtdm_lock_get_irqsave(&cache->lock, context);
+	skb = cache->first;
+	if (skb) {
+	    cache->first = skb->next;
+	    cache->len--;
+	}
+	rtdm_lock_put_irqrestore(&cache->lock, context);
+	if (skb)
+	    break;
+    }
+
+    return skb;
+}
+
+static struct rtskb *rtskb_cache_dequeue(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+    struct rtskb *skb;
+
+    if (!pool->lock_ops->trylock(pool->lock_cookie))
+	return NULL;
+
+    cache = raw_cpu_ptr(pool->cache);
+    rtdm_lock_get_irqsave(&cache->lock, context);
+
+    if (cache->first == NULL)
+	rtskb_cache_refill(pool, cache);
+
+    skb = cache->first;
+    if (skb) {
+	cache->first = skb->next;
+	cache->len--;
+    }
+
+    rtdm_lock_put_irqrestore(&cache->lock, context);
+
+    /* The remaining rtskbs may sit in the caches of other CPUs. */
+    if (skb == NULL) {
+	skb = rtskb_cache_steal(pool);
+	if (skb == NULL) {
+	    pool->lock_ops->unlock(pool->lock_cookie);
+	    return NULL;
+	}
+    }
+
+    skb->next = NULL;
+
+    return skb;
+}
+
+static void rtskb_cache_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+{
+    struct rtskb *chain_end = skb->chain_end, *next;
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+
+    cache = raw_cpu_ptr(pool->cache);
+    rtdm_lock_get_irqsave(&cache->lock, context);
+
+    /* Chains are freed en bloc, like with __rtskb_queue_tail(). */
+    for (;;) {
+	next = skb->next;
+	skb->next = cache->first;
+	cache->first = skb;
+	cache->len++;
+	if (skb == chain_end)
+	    break;
+	skb = next;
+    }
+
+    if (cache->len > rtskb_cache_size)
+	rtskb_cache_flush(pool, cache, rtskb_cache_size / 2);
+
+    rtdm_lock_put_irqrestore(&cache->lock, context);
+
+    pool->lock_ops->unlock(pool->lock_cookie);
+}
+
+/* Return all cached rtskbs to the pool's queue. */
+static void rtskb_cache_drain(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+	cache = per_cpu_ptr(pool->cache, cpu);
+	rtdm_lock_get_irqsave(&cache->lock, context);
+	rtskb_cache_flush(pool, cache, 0);
+	rtdm_lock_put_irqrestore(&cache->lock, context);
+    }
+}
+
 static struct rtskb *__rtskb_pool_dequeue(struct rtskb_pool *pool)
 {
     struct rtskb_queue *queue = &pool->queue;
@@ -171,6 +340,9 @@ struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool)
     rtdm_lockctx_t context;
     struct rtskb *skb;
 
+    if (pool->cache)
+	return rtskb_cache_dequeue(pool);
+
     rtdm_lock_get_irqsave(&queue->lock, context);
     skb = __rtskb_pool_dequeue(pool);
     rtdm_lock_put_irqrestore(&queue->lock, context);
@@ -192,6 +364,11 @@ void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
     struct rtskb_queue *queue = &pool->queue;
     rtdm_lockctx_t context;
 
+    if (pool->cache) {
+	rtskb_cache_queue_tail(pool, skb);
+	return;
+    }
+
     rtdm_lock_get_irqsave(&queue->lock, context);
     __rtskb_pool_queue_tail(pool, skb);
     rtdm_lock_put_irqrestore(&queue->lock, context);
@@ -220,7 +397,9 @@ struct rtskb *alloc_rtskb(unsigned int size, struct rtskb_pool *pool)
 
     /* Set up other states */
     skb->chain_end = skb;
+    skb->sg_next = NULL;
     skb->len = 0;
+    skb->data_len = 0;
     skb->pkt_type = PACKET_HOST;
     skb->xmit_stamp = NULL;
 
@@ -234,6 +413,43 @@ struct rtskb *alloc_rtskb(unsigned int size, struct rtskb_pool *pool)
 EXPORT_SYMBOL_GPL(alloc_rtskb);
 
 
+/***
+ *  rtskb_add_segment - append a data segment to a multi-segment rtskb
+ *  @skb: head rtskb
+ *  @seg: single rtskb holding the next seg->len bytes of the packet
+ */
+void rtskb_add_segment(struct rtskb *skb, struct rtskb *seg)
+{
+    struct rtskb **last = &skb->sg_next;
+
+    while (*last != NULL)
+	last = &(*last)->sg_next;
+
+    seg->sg_next   = NULL;
+    *last          = seg;
+    skb->len      += seg->len;
+    skb->data_len += seg->len;
+}
+
+EXPORT_SYMBOL_GPL(rtskb_add_segment);
+
+
+static void rtskb_free_segments(struct rtskb *skb)
+{
+    struct rtskb *seg, *next;
+
+    for (seg = skb->sg_next; seg != NULL; seg = next) {
+	next = seg->sg_next;
+	seg->sg_next = NULL;
+	kfree_rtskb(seg);
+    }
+
+    skb->sg_next   = NULL;
+    skb->len      -= skb->data_len;
+    skb->data_len  = 0;
+}
+
+
 /***
  *  kfree_rtskb
  *  @skb    rtskb
@@ -251,6 +467,9 @@ void kfree_rtskb(struct rtskb *skb)
     RTNET_ASSERT(skb != NULL, return;);
     RTNET_ASSERT(skb->pool != NULL, return;);
 
+    if (unlikely(skb->sg_next != NULL))
+	rtskb_free_segments(skb);
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
     next_skb  = skb;
     chain_end = skb->chain_end;
@@ -320,6 +539,7 @@ unsigned int rtskb_pool_init(struct rtskb_pool *pool,
     unsigned int i;
 
     rtskb_queue_init(&pool->queue);
+    pool->cache = NULL;
 
     i = rtskb_pool_extend(pool, initial_size);
 
@@ -371,6 +591,12 @@ void rtskb_pool_release(struct rtskb_pool *pool)
 {
     struct rtskb *skb;
 
+    if (pool->cache) {
+	rtskb_cache_drain(pool);
+	free_percpu(pool->cache);
+	pool->cache = NULL;
+    }
+
     while ((skb = rtskb_dequeue(&pool->queue)) != NULL) {
 	rtdev_unmap_rtskb(skb);
 	kmem_cache_free(rtskb_slab_pool, skb);
@@ -383,6 +609,40 @@ void rtskb_pool_release(struct rtskb_pool *pool)
 EXPORT_SYMBOL_GPL(rtskb_pool_release);
 
 
+/***
+ *  rtskb_pool_enable_cache
+ *  @pool: pool to front with per-CPU caches
+ *
+ *  Worth it for pools which rtskbs are allocated and released from
+ *  several CPUs. Caching is not enabled on UP, or if disabled via the
+ *  rtskb_cache_size module parameter.
+ */
+int rtskb_pool_enable_cache(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    int cpu;
+
+    if (rtskb_cache_size < 2 || num_possible_cpus() < 2)
+	return 0;
+
+    cache = alloc_percpu(struct rtskb_pool_cache);
+    if (cache == NULL)
+	return -ENOMEM;
+
+    for_each_possible_cpu(cpu) {
+	rtdm_lock_init(&per_cpu_ptr(cache, cpu)->lock);
+	per_cpu_ptr(cache, cpu)->first = NULL;
+	per_cpu_ptr(cache, cpu)->len = 0;
+    }
+
+    pool->cache = cache;
+
+    return 0;
+}
+
+EXPORT_SYMBOL_GPL(rtskb_pool_enable_cache);
+
+
 unsigned int rtskb_pool_extend(struct rtskb_pool *pool,
 			       unsigned int add_rtskbs)
 {
@@ -430,6 +690,9 @@ unsigned int rtskb_pool_shrink(struct rtskb_pool *pool,
     struct rtskb    *skb;
 
 
+    if (pool->cache)
+	rtskb_cache_drain(pool);
+
     for (i = 0; i < rem_rtskbs; i++) {
 	if ((skb = rtskb_dequeue(&pool->queue)) == NULL)
 	    break;
@@ -451,6 +714,20 @@ int rtskb_acquire(struct rtskb *rtskb, struct rtskb_pool *comp_pool)
     rtdm_lockctx_t context;
 
 
+    if (comp_pool->cache || rtskb->pool->cache) {
+	comp_rtskb = rtskb_pool_dequeue(comp_pool);
+	if (!comp_rtskb)
+	    return -ENOMEM;
+
+	comp_rtskb->chain_end = comp_rtskb;
+	comp_rtskb->pool = release_pool = rtskb->pool;
+	rtskb_pool_queue_tail(release_pool, comp_rtskb);
+
+	rtskb->pool = comp_pool;
+
+	return 0;
+    }
+
     rtdm_lock_get_irqsave(&comp_pool->queue.lock, context);
 
     comp_rtskb = __rtskb_pool_dequeue(comp_pool);
@@ -484,6 +761,8 @@ struct rtskb* rtskb_clone(struct rtskb *rtskb, struct rtskb_pool *pool)
     struct rtskb    *clone_rtskb;
     unsigned int    total_len;
 
+    RTNET_ASSERT(!rtskb_is_nonlinear(rtskb), return NULL;);
+
     clone_rtskb = alloc_rtskb(rtskb->end - rtskb->buf_start, pool);
     if (clone_rtskb == NULL)
 	return NULL;
@@ -541,6 +820,9 @@ int rtskb_pools_init(void)
     if (rtskb_module_pool_init(&global_pool, global_rtskbs) < global_rtskbs)
 	goto err_out;
 
+    if (rtskb_pool_enable_cache(&global_pool) < 0)
+	goto err_out;
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
     rtdm_lock_init(&rtcap_lock);
 #endif
@@ -86,6 +86,7 @@ int __rt_socket_init(struct rtdm_fd *fd, unsigned short protocol,
 
     sock->flags = 0;
     sock->callback_func = NULL;
+    sock->frag_collectors = 0;
 
     rtskb_queue_init(&sock->incoming);
 
@@ -20,6 +20,7 @@
 #include <linux/module.h>
 #include <linux/ioport.h>
 #include <linux/slab.h>
+#include <linux/math64.h>
 #include <asm/io.h>
 
 #include <rtdm/serial.h>
@@ -27,7 +28,7 @@
 
 MODULE_DESCRIPTION("RTDM-based driver for 16550A UARTs");
 MODULE_AUTHOR("Jan Kiszka <jan.kiszka@web.de>");
-MODULE_VERSION("1.5.2");
+MODULE_VERSION("1.6.0");
 MODULE_LICENSE("GPL");
 
 #define RT_16550_DRIVER_NAME	"xeno_16550A"
@@ -36,6 +37,8 @@ MODULE_LICENSE("GPL");
 
 #define IN_BUFFER_SIZE		4096
 #define OUT_BUFFER_SIZE		4096
+#define FRAME_RING_SIZE		64	/* must be a power of 2 */
+#define MAX_FRAME_LENGTH	(IN_BUFFER_SIZE / 2)
 
 #define DEFAULT_BAUD_BASE	115200
 #define DEFAULT_TX_FIFO		16
@@ -76,6 +79,14 @@ MODULE_LICENSE("GPL");
 #define LSR			5	/* Line Status Register */
 #define MSR			6	/* Modem Status Register */
 
+struct rt_16550_frame {
+	int start;			/* offset in RX ring */
+	int len;			/* frame length */
+	int status;			/* line errors */
+	uint64_t first;			/* timestamp of first char */
+	uint64_t last;			/* timestamp of last char */
+};
+
 struct rt_16550_context {
 	struct rtser_config config;	/* current device configuration */
 
@@ -97,6 +108,14 @@ struct rt_16550_context {
 	volatile unsigned long in_lock;	/* single-reader lock */
 	uint64_t *in_history;		/* RX timestamp buffer */
 
+	struct rtser_framing framing;	/* RX framing settings */
+	nanosecs_rel_t frame_gap;	/* effective idle gap */
+	rtdm_timer_t frame_timer;	/* idle gap detection */
+	struct rt_16550_frame frame;	/* frame being received */
+	struct rt_16550_frame frames[FRAME_RING_SIZE]; /* complete frames */
+	unsigned int fr_head;		/* frame ring, head index */
+	unsigned int fr_tail;		/* frame ring, tail index */
+
 	int out_head;			/* TX ring buffer, head pointer */
 	int out_tail;			/* TX ring buffer, tail pointer */
 	size_t out_npend;		/* pending bytes in TX ring */
@@ -144,6 +163,66 @@ MODULE_PARM_DESC(tx_fifo, "Transmitter FIFO size");
 #include "16550A_pnp.h"
 #include "16550A_pci.h"
 
+static void rt_16550_close_frame(struct rt_16550_context *ctx)
+{
+	struct rt_16550_frame *frame = &ctx->frame;
+
+	if (frame->len == 0)
+		return;
+
+	if (ctx->fr_tail - ctx->fr_head >= FRAME_RING_SIZE) {
+		/* No room for another frame, drop this one. */
+		ctx->in_tail = frame->start;
+		ctx->in_npend -= frame->len;
+		ctx->status |= RTSER_SOFT_OVERRUN_ERR;
+	} else
+		ctx->frames[ctx->fr_tail++ & (FRAME_RING_SIZE - 1)] = *frame;
+
+	frame->len = 0;
+	frame->status = 0;
+}
+
+static inline int rt_16550_frame_wakeup(struct rt_16550_context *ctx)
+{				/* ctx->lock held */
+	if (ctx->in_nwait == 0 ||
+	    (ctx->fr_head == ctx->fr_tail && !ctx->status))
+		return 0;
+
+	ctx->in_nwait = 0;
+
+	return 1;
+}
+
+static inline void rt_16550_frame_char(struct rt_16550_context *ctx,
+				       int c, uint64_t timestamp)
+{
+	struct rt_16550_frame *frame = &ctx->frame;
+
+	if (frame->len > 0 && timestamp - frame->last > ctx->frame_gap)
+		rt_16550_close_frame(ctx);
+
+	/* Unlike in stream mode, never overwrite pending input. */
+	if (ctx->in_npend >= IN_BUFFER_SIZE) {
+		frame->status |= RTSER_SOFT_OVERRUN_ERR;
+		return;
+	}
+
+	if (frame->len == 0) {
+		frame->start = ctx->in_tail;
+		frame->first = timestamp;
+	}
+
+	frame->last = timestamp;
+	ctx->in_buf[ctx->in_tail] = c;
+	if (ctx->in_history)
+		ctx->in_history[ctx->in_tail] = timestamp;
+	ctx->in_tail = (ctx->in_tail + 1) & (IN_BUFFER_SIZE - 1);
+	ctx->in_npend++;
+
+	if (++frame->len >= ctx->framing.max_length)
+		rt_16550_close_frame(ctx);
+}
+
 static inline int rt_16550_rx_interrupt(struct rt_16550_context *ctx,
 					uint64_t * timestamp)
 {
@@ -156,14 +235,19 @@ static inline int rt_16550_rx_interrupt(struct rt_16550_context *ctx,
 	do {
 		c = rt_16550_reg_in(mode, base, RHR);	/* read input char */
 
-		ctx->in_buf[ctx->in_tail] = c;
-		if (ctx->in_history)
-			ctx->in_history[ctx->in_tail] = *timestamp;
-		ctx->in_tail = (ctx->in_tail + 1) & (IN_BUFFER_SIZE - 1);
-
-		if (++ctx->in_npend > IN_BUFFER_SIZE) {
-			lsr |= RTSER_SOFT_OVERRUN_ERR;
-			ctx->in_npend--;
+		if (ctx->framing.mode != RTSER_FRAMING_NONE)
+			rt_16550_frame_char(ctx, c, *timestamp);
+		else {
+			ctx->in_buf[ctx->in_tail] = c;
+			if (ctx->in_history)
+				ctx->in_history[ctx->in_tail] = *timestamp;
+			ctx->in_tail = (ctx->in_tail + 1) &
+				(IN_BUFFER_SIZE - 1);
+
+			if (++ctx->in_npend > IN_BUFFER_SIZE) {
+				lsr |= RTSER_SOFT_OVERRUN_ERR;
+				ctx->in_npend--;
+			}
 		}
 
 		rbytes++;
@@ -174,8 +258,11 @@ static inline int rt_16550_rx_interrupt(struct rt_16550_context *ctx,
 			 RTSER_LSR_BREAK_IND));
 	} while (lsr & RTSER_LSR_DATA);
 
-	/* save new errors */
-	ctx->status |= lsr;
+	/* save new errors, per frame in framing mode */
+	if (ctx->framing.mode != RTSER_FRAMING_NONE)
+		ctx->frame.status |= lsr;
+	else
+		ctx->status |= lsr;
 
 	/* If we are enforcing the RTSCTS control flow and the input
 	   buffer is busy above the specified high watermark, clear
@@ -219,6 +306,44 @@ static inline void rt_16550_stat_interrupt(struct rt_16550_context *ctx)
 			 RTSER_LSR_FRAMING_ERR | RTSER_LSR_BREAK_IND));
 }
 
+static void rt_16550_frame_timeout(rtdm_timer_t *timer)
+{
+	struct rt_16550_context *ctx;
+	uint64_t timestamp = rtdm_clock_read();
+	int mode, wakeup;
+
+	ctx = container_of(timer, struct rt_16550_context, frame_timer);
+	mode = rt_16550_io_mode_from_ctx(ctx);
+
+	rtdm_lock_get(&ctx->lock);
+
+	/*
+	 * The IRQ handler may have received more input since the
+	 * timer was armed, in which case it re-armed it. Characters
+	 * waiting in the FIFO below the interrupt threshold will be
+	 * delivered by the next RX interrupt, which decides about the
+	 * frame boundary.
+	 */
+	if (ctx->frame.len > 0 &&
+	    timestamp - ctx->frame.last >= ctx->frame_gap) {
+		if (rt_16550_reg_in(mode, ctx->base_addr, LSR) &
+		    RTSER_LSR_DATA)
+			rtdm_timer_start_in_handler(timer,
+					    timestamp + ctx->frame_gap, 0,
+					    RTDM_TIMERMODE_ABSOLUTE);
+		else
+			rt_16550_close_frame(ctx);
+	}
+
+	wakeup = rt_16550_frame_wakeup(ctx);
+
+	rtdm_lock_put(&ctx->lock);
+
+	/* Signal outside of the context lock, see rt_16550_interrupt(). */
+	if (wakeup)
+		rtdm_event_signal(&ctx->in_event);
+}
+
 static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 {
 	struct rt_16550_context *ctx;
@@ -229,6 +354,8 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 	int rbytes = 0;
 	int events = 0;
 	int modem;
+	nanosecs_rel_t gap = 0;
+	int wake_in = 0, wake_out = 0, wake_ioc = 0;
 	int ret = RTDM_IRQ_NONE;
 
 	ctx = rtdm_irq_get_arg(irq_context, struct rt_16550_context);
@@ -260,10 +387,15 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 		ret = RTDM_IRQ_HANDLED;
 	}
 
-	if (ctx->in_nwait > 0) {
+	/* In framing mode, readers are woken up on complete frames. */
+	if (ctx->framing.mode != RTSER_FRAMING_NONE) {
+		if (rbytes > 0)
+			gap = ctx->frame_gap;
+		wake_in = rt_16550_frame_wakeup(ctx);
+	} else if (ctx->in_nwait > 0) {
 		if ((ctx->in_nwait <= rbytes) || ctx->status) {
 			ctx->in_nwait = 0;
-			rtdm_event_signal(&ctx->in_event);
+			wake_in = 1;
 		} else
 			ctx->in_nwait -= rbytes;
 	}
@@ -279,15 +411,14 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 		ctx->last_timestamp = timestamp;
 		ctx->ioc_events = events;
 
-		if (!old_events)
-			rtdm_event_signal(&ctx->ioc_event);
+		wake_ioc = !old_events;
 	}
 
 	if ((ctx->ier_status & IER_TX) && (ctx->out_npend == 0)) {
 		/* mask transmitter empty interrupt */
 		ctx->ier_status &= ~IER_TX;
 
-		rtdm_event_signal(&ctx->out_event);
+		wake_out = 1;
 	}
 
 	/* update interrupt mask */
@@ -295,9 +426,54 @@ static int rt_16550_interrupt(rtdm_irq_t * irq_context)
 
 	rtdm_lock_put(&ctx->lock);
 
+	/*
+	 * Waking up waiters and (re)arming idle gap detection both
+	 * grab the core lock, under which the timer handler takes the
+	 * context lock: do this only after dropping the latter.
+	 */
+	if (wake_in)
+		rtdm_event_signal(&ctx->in_event);
+	if (wake_ioc)
+		rtdm_event_signal(&ctx->ioc_event);
+	if (wake_out)
+		rtdm_event_signal(&ctx->out_event);
+
+	if (gap)
+		rtdm_timer_start(&ctx->frame_timer, timestamp + gap, 0,
+				 RTDM_TIMERMODE_ABSOLUTE);
+
 	return ret;
 }
 
+static void rt_16550_update_frame_gap(struct rt_16550_context *ctx)
+{
+	int bits;
+
+	if (ctx->framing.idle_gap > 0) {
+		ctx->frame_gap = ctx->framing.idle_gap;
+		return;
+	}
+
+	/* 3.5 character times, counting start, parity and stop bits. */
+	bits = 1 + 5 + ctx->config.data_bits + 1 + ctx->config.stop_bits;
+	if (ctx->config.parity != RTSER_NO_PARITY)
+		bits++;
+
+	ctx->frame_gap = div_u64(35ULL * bits * 1000000000ULL,
+				 ctx->config.baud_rate * 10);
+}
+
+static void rt_16550_reset_rx(struct rt_16550_context *ctx)
+{				/* ctx->lock held */
+	ctx->in_head = 0;
+	ctx->in_tail = 0;
+	ctx->in_npend = 0;
+	ctx->frame.len = 0;
+	ctx->frame.status = 0;
+	ctx->fr_head = 0;
+	ctx->fr_tail = 0;
+}
+
 static int rt_16550_set_config(struct rt_16550_context *ctx,
 			       const struct rtser_config *config,
 			       uint64_t **in_history_ptr)
@@ -339,6 +515,7 @@ static int rt_16550_set_config(struct rt_16550_context *ctx,
 				 ctx->config.data_bits);
 		ctx->status = 0;
 		ctx->ioc_events &= ~RTSER_EVENT_ERRPEND;
+		rt_16550_update_frame_gap(ctx);
 	}
 
 	if (config->config_mask & RTSER_SET_FIFO_DEPTH) {
@@ -434,6 +611,7 @@ void rt_16550_cleanup_ctx(struct rt_16550_context *ctx)
 	rtdm_event_destroy(&ctx->out_event);
 	rtdm_event_destroy(&ctx->ioc_event);
 	rtdm_mutex_destroy(&ctx->out_lock);
+	rtdm_timer_destroy(&ctx->frame_timer);
 }
 
 int rt_16550_open(struct rtdm_fd *fd, int oflags)
@@ -452,6 +630,8 @@ int rt_16550_open(struct rtdm_fd *fd, int oflags)
 	rtdm_event_init(&ctx->out_event, 0);
 	rtdm_event_init(&ctx->ioc_event, 0);
 	rtdm_mutex_init(&ctx->out_lock);
+	rtdm_timer_init(&ctx->frame_timer, rt_16550_frame_timeout,
+			rtdm_fd_device(fd)->name);
 
 	rt_16550_init_io_ctx(dev_id, ctx);
 
@@ -464,6 +644,14 @@ int rt_16550_open(struct rtdm_fd *fd, int oflags)
 	ctx->in_lock = 0;
 	ctx->in_history = NULL;
 
+	ctx->framing.mode = RTSER_FRAMING_NONE;
+	ctx->framing.max_length = MAX_FRAME_LENGTH;
+	ctx->framing.idle_gap = 0;
+	ctx->frame.len = 0;
+	ctx->frame.status = 0;
+	ctx->fr_head = 0;
+	ctx->fr_tail = 0;
+
 	ctx->out_head = 0;
 	ctx->out_tail = 0;
 	ctx->out_npend = 0;
@@ -750,9 +938,7 @@ int rt_16550_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 
 		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
 		if ((long)arg & RTDM_PURGE_RX_BUFFER) {
-			ctx->in_head = 0;
-			ctx->in_tail = 0;
-			ctx->in_npend = 0;
+			rt_16550_reset_rx(ctx);
 			ctx->status = 0;
 			fcr |= FCR_FIFO | FCR_RESET_RX;
 			rt_16550_reg_in(mode, base, RHR);
@@ -772,6 +958,45 @@ int rt_16550_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 		break;
 	}
 
+	case RTSER_RTIOC_SET_FRAMING: {
+		struct rtser_framing framing;
+
+		if (rtdm_fd_is_user(fd)) {
+			err =
+			    rtdm_safe_copy_from_user(fd, &framing, arg,
+						     sizeof(framing));
+			if (err)
+				return err;
+		} else
+			framing = *(struct rtser_framing *)arg;
+
+		if ((framing.mode != RTSER_FRAMING_NONE &&
+		     framing.mode != RTSER_FRAMING_IDLE_GAP) ||
+		    framing.max_length < 0 ||
+		    framing.max_length > MAX_FRAME_LENGTH ||
+		    framing.idle_gap < 0)
+			return -EINVAL;
+
+		if (framing.max_length == 0)
+			framing.max_length = MAX_FRAME_LENGTH;
+
+		/* Pending input is dropped, keep readers out meanwhile. */
+		if (test_and_set_bit(0, &ctx->in_lock))
+			return -EBUSY;
+
+		rtdm_timer_stop(&ctx->frame_timer);
+
+		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+		ctx->framing = framing;
+		rt_16550_update_frame_gap(ctx);
+		rt_16550_reset_rx(ctx);
+		ctx->ioc_events &= ~RTSER_EVENT_RXPEND;
+		rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+		clear_bit(0, &ctx->in_lock);
+		break;
+	}
+
 	default:
 		err = -ENOTTY;
 	}
@@ -779,6 +1004,143 @@ int rt_16550_ioctl(struct rtdm_fd *fd, unsigned int request, void *arg)
 	return err;
 }
 
+static inline int rt_16550_copy_out(struct rtdm_fd *fd, void *dst,
+				    const void *src, size_t len)
+{
+	if (!rtdm_fd_is_user(fd)) {
+		memcpy(dst, src, len);
+		return 0;
+	}
+
+	return rtdm_copy_to_user(fd, dst, src, len) ? -EFAULT : 0;
+}
+
+static ssize_t rt_16550_read_frame(struct rtdm_fd *fd, void *buf,
+				   size_t nbyte)
+{
+	struct rt_16550_context *ctx;
+	struct rt_16550_frame *frame;
+	struct rtser_frame hdr;
+	rtdm_lockctx_t lock_ctx;
+	int block;
+	int subblock;
+	int in_pos;
+	char *out_pos = (char *)buf + sizeof(hdr);
+	rtdm_toseq_t timeout_seq;
+	ssize_t ret;
+
+	if (nbyte < sizeof(hdr))
+		return -EINVAL;
+
+	ctx = rtdm_fd_to_private(fd);
+
+	rtdm_toseq_init(&timeout_seq, ctx->config.rx_timeout);
+
+	/* only one reader allowed, stop any further attempts here */
+	if (test_and_set_bit(0, &ctx->in_lock))
+		return -EBUSY;
+
+	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+
+	while (ctx->fr_head == ctx->fr_tail) {
+		/* switch on error interrupt - the user is ready to listen */
+		if ((ctx->ier_status & IER_STAT) == 0) {
+			ctx->ier_status |= IER_STAT;
+			rt_16550_reg_out(rt_16550_io_mode_from_ctx(ctx),
+					 ctx->base_addr, IER,
+					 ctx->ier_status);
+		}
+
+		/*
+		 * Errors attached to received frames are reported in
+		 * their headers, only report dropped input here.
+		 */
+		if (ctx->status) {
+			if (ctx->status & RTSER_LSR_BREAK_IND)
+				ret = -EPIPE;
+			else
+				ret = -EIO;
+			ctx->saved_errors = ctx->status &
+			    (RTSER_LSR_OVERRUN_ERR | RTSER_LSR_PARITY_ERR |
+			     RTSER_LSR_FRAMING_ERR | RTSER_SOFT_OVERRUN_ERR);
+			ctx->status = 0;
+			goto out_locked;
+		}
+
+		if (ctx->config.rx_timeout < 0) {
+			ret = -EAGAIN;
+			goto out_locked;
+		}
+
+		ctx->in_nwait = 1;
+
+		rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+		ret = rtdm_event_timedwait(&ctx->in_event,
+					   ctx->config.rx_timeout,
+					   &timeout_seq);
+		if (ret == -EIDRM)
+			/* Device has been closed - return immediately. */
+			return -EBADF;
+
+		rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+
+		if (ret < 0) {
+			ctx->in_nwait = 0;
+			goto out_locked;
+		}
+	}
+
+	frame = &ctx->frames[ctx->fr_head & (FRAME_RING_SIZE - 1)];
+	hdr.first_timestamp = frame->first;
+	hdr.last_timestamp = frame->last;
+	hdr.length = frame->len;
+	hdr.status = frame->status;
+	in_pos = frame->start;
+
+	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+
+	/*
+	 * The frame data cannot be overwritten until we release it,
+	 * copy it out in at most two chunks.
+	 */
+	block = hdr.length;
+	if (block > nbyte - sizeof(hdr)) {
+		block = nbyte - sizeof(hdr);
+		hdr.status |= RTSER_FRAME_TRUNCATED;
+	}
+
+	subblock = block;
+	if (in_pos + subblock > IN_BUFFER_SIZE)
+		subblock = IN_BUFFER_SIZE - in_pos;
+
+	ret = rt_16550_copy_out(fd, out_pos, &ctx->in_buf[in_pos], subblock);
+	if (ret == 0 && block > subblock)
+		ret = rt_16550_copy_out(fd, out_pos + subblock, ctx->in_buf,
+					block - subblock);
+	if (ret == 0)
+		ret = rt_16550_copy_out(fd, buf, &hdr, sizeof(hdr));
+	if (ret)
+		goto out;
+
+	rtdm_lock_get_irqsave(&ctx->lock, lock_ctx);
+
+	ctx->in_head = (in_pos + hdr.length) & (IN_BUFFER_SIZE - 1);
+	ctx->fr_head++;
+	if ((ctx->in_npend -= hdr.length) == 0)
+		ctx->ioc_events &= ~RTSER_EVENT_RXPEND;
+
+	ret = sizeof(hdr) + block;
+
+out_locked:
+	rtdm_lock_put_irqrestore(&ctx->lock, lock_ctx);
+out:
+	/* Release the simple reader lock, */
+	clear_bit(0, &ctx->in_lock);
+
+	return ret;
+}
+
 ssize_t rt_16550_read(struct rtdm_fd *fd, void *buf, size_t nbyte)
 {
 	struct rt_16550_context *ctx;
@@ -801,6 +1163,9 @@ ssize_t rt_16550_read(struct rtdm_fd *fd, void *buf, size_t nbyte)
 
 	ctx = rtdm_fd_to_private(fd);
 
+	if (ctx->framing.mode != RTSER_FRAMING_NONE)
+		return rt_16550_read_frame(fd, buf, nbyte);
+
 	rtdm_toseq_init(&timeout_seq, ctx->config.rx_timeout);
 
 	/* non-blocking is handled separately here */
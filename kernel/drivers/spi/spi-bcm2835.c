@@ -318,6 +318,33 @@ static int bcm2835_transfer_iobufs(struct rtdm_spi_remote_slave *slave)
 	return do_transfer_irq(slave);
 }
 
+/*
+ * Each chunk of a transfer list is run as a separate transfer,
+ * ending with TA being cleared. Only a GPIO chip select, which
+ * find_cs_gpio() sets up whenever possible, remains asserted in
+ * between, the native one is released.
+ */
+static int bcm2835_transfer_iobufs_n(struct rtdm_spi_remote_slave *slave,
+			       size_t offset, size_t len)
+{
+	struct spi_master_bcm2835 *spim = to_master_bcm2835(slave);
+	struct spi_slave_bcm2835 *bcm = to_slave_bcm2835(slave);
+	size_t iolen = bcm->io_len / 2;
+
+	if (bcm->io_len == 0)
+		return -EINVAL;	/* No I/O buffers set. */
+
+	if (len == 0 || offset >= iolen || len > iolen - offset)
+		return -EINVAL;
+
+	spim->tx_len = len;
+	spim->rx_len = len;
+	spim->tx_buf = bcm->io_virt + iolen + offset;
+	spim->rx_buf = bcm->io_virt + offset;
+
+	return do_transfer_irq(slave);
+}
+
 static ssize_t bcm2835_read(struct rtdm_spi_remote_slave *slave,
 			    void *rx, size_t len)
 {
@@ -549,6 +576,7 @@ static struct rtdm_spi_master_ops bcm2835_master_ops = {
 	.mmap_iobufs = bcm2835_mmap_iobufs,
 	.mmap_release = bcm2835_mmap_release,
 	.transfer_iobufs = bcm2835_transfer_iobufs,
+	.transfer_iobufs_n = bcm2835_transfer_iobufs_n,
 	.write = bcm2835_write,
 	.read = bcm2835_read,
 	.attach_slave = bcm2835_attach_slave,
@@ -0,0 +1,355 @@
+/**
+ * Loopback SPI master, echoing the output data back to the input
+ * buffer of every transfer. Useful for exercising the RTDM SPI core
+ * and its user interface without any hardware.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/gfp.h>
+#include <linux/platform_device.h>
+#include <linux/spi/spi.h>
+#include "spi-master.h"
+
+#define RTDM_SUBCLASS_LOOPBACK  3
+
+#define LOOPBACK_MAX_SPEED_HZ	50000000
+
+static unsigned int num_cs = 2;
+module_param(num_cs, uint, 0444);
+MODULE_PARM_DESC(num_cs, "number of slave devices to create");
+
+struct spi_master_loopback {
+	struct rtdm_spi_master master;
+	struct spi_device **slaves;
+	unsigned int nr_slaves;
+};
+
+struct spi_slave_loopback {
+	struct rtdm_spi_remote_slave slave;
+	void *io_virt;
+	size_t io_len;
+};
+
+static struct platform_device *loopback_pdev;
+
+static inline struct spi_slave_loopback *
+to_slave_loopback(struct rtdm_spi_remote_slave *slave)
+{
+	return container_of(slave, struct spi_slave_loopback, slave);
+}
+
+static int loopback_configure(struct rtdm_spi_remote_slave *slave)
+{
+	struct rtdm_spi_config *config = &slave->config;
+
+	if (config->bits_per_word != 8 ||
+	    config->speed_hz > LOOPBACK_MAX_SPEED_HZ)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void loopback_chip_select(struct rtdm_spi_remote_slave *slave,
+				 bool active)
+{
+	/* Nothing to drive. */
+}
+
+static void do_transfer(const void *tx, void *rx, size_t len)
+{
+	if (rx == NULL)
+		return;
+
+	if (tx)
+		memmove(rx, tx, len);
+	else
+		memset(rx, 0, len);
+}
+
+static int loopback_transfer_iobufs(struct rtdm_spi_remote_slave *slave)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+	size_t len = lb->io_len / 2;
+
+	if (lb->io_len == 0)
+		return -EINVAL;	/* No I/O buffers set. */
+
+	do_transfer(lb->io_virt + len, lb->io_virt, len);
+
+	return 0;
+}
+
+static int loopback_transfer_iobufs_n(struct rtdm_spi_remote_slave *slave,
+				      size_t offset, size_t len)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+	size_t iolen = lb->io_len / 2;
+
+	if (lb->io_len == 0)
+		return -EINVAL;	/* No I/O buffers set. */
+
+	if (len == 0 || offset >= iolen || len > iolen - offset)
+		return -EINVAL;
+
+	do_transfer(lb->io_virt + iolen + offset, lb->io_virt + offset, len);
+
+	return 0;
+}
+
+static ssize_t loopback_read(struct rtdm_spi_remote_slave *slave,
+			     void *rx, size_t len)
+{
+	do_transfer(NULL, rx, len);
+
+	return len;
+}
+
+static ssize_t loopback_write(struct rtdm_spi_remote_slave *slave,
+			      const void *tx, size_t len)
+{
+	return len;
+}
+
+static int loopback_set_iobufs(struct rtdm_spi_remote_slave *slave,
+			       struct rtdm_spi_iobufs *p)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+	size_t len;
+	void *virt;
+
+	if (p->io_len == 0)
+		return -EINVAL;
+
+	len = L1_CACHE_ALIGN(p->io_len) * 2;
+	if (len != lb->io_len) {
+		if (lb->io_len)
+			return -EINVAL;	/* I/O buffers may not be resized. */
+
+		virt = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO,
+						get_order(len));
+		if (virt == NULL)
+			return -ENOMEM;
+
+		lb->io_virt = virt;
+		smp_mb();
+		/* io_len is tested locklessly by the transfer handlers. */
+		lb->io_len = len;
+	}
+
+	p->i_offset = 0;
+	p->o_offset = lb->io_len / 2;
+	p->map_len = lb->io_len;
+
+	return 0;
+}
+
+static int loopback_mmap_iobufs(struct rtdm_spi_remote_slave *slave,
+				struct vm_area_struct *vma)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+
+	return rtdm_mmap_kmem(vma, lb->io_virt);
+}
+
+static void loopback_mmap_release(struct rtdm_spi_remote_slave *slave)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+
+	free_pages((unsigned long)lb->io_virt, get_order(lb->io_len));
+	lb->io_len = 0;
+}
+
+static struct rtdm_spi_remote_slave *
+loopback_attach_slave(struct rtdm_spi_master *master, struct spi_device *spi)
+{
+	struct spi_slave_loopback *lb;
+	int ret;
+
+	lb = kzalloc(sizeof(*lb), GFP_KERNEL);
+	if (lb == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	ret = rtdm_spi_add_remote_slave(&lb->slave, master, spi);
+	if (ret) {
+		dev_err(&spi->dev,
+			"%s: failed to attach slave\n", __func__);
+		kfree(lb);
+		return ERR_PTR(ret);
+	}
+
+	return &lb->slave;
+}
+
+static void loopback_detach_slave(struct rtdm_spi_remote_slave *slave)
+{
+	struct spi_slave_loopback *lb = to_slave_loopback(slave);
+
+	rtdm_spi_remove_remote_slave(slave);
+	kfree(lb);
+}
+
+static struct rtdm_spi_master_ops loopback_master_ops = {
+	.configure = loopback_configure,
+	.chip_select = loopback_chip_select,
+	.set_iobufs = loopback_set_iobufs,
+	.mmap_iobufs = loopback_mmap_iobufs,
+	.mmap_release = loopback_mmap_release,
+	.transfer_iobufs = loopback_transfer_iobufs,
+	.transfer_iobufs_n = loopback_transfer_iobufs_n,
+	.write = loopback_write,
+	.read = loopback_read,
+	.attach_slave = loopback_attach_slave,
+	.detach_slave = loopback_detach_slave,
+};
+
+static void remove_slaves(struct spi_master_loopback *spim)
+{
+	while (spim->nr_slaves > 0)
+		spi_unregister_device(spim->slaves[--spim->nr_slaves]);
+}
+
+static int create_slaves(struct spi_master_loopback *spim)
+{
+	struct spi_master *kmaster = spim->master.kmaster;
+	struct spi_board_info info;
+	struct spi_device *spi;
+	unsigned int cs;
+
+	for (cs = 0; cs < num_cs; cs++) {
+		memset(&info, 0, sizeof(info));
+		strlcpy(info.modalias, "rtdm_spi_device",
+			sizeof(info.modalias));
+		info.max_speed_hz = LOOPBACK_MAX_SPEED_HZ;
+		info.chip_select = cs;
+		spi = spi_new_device(kmaster, &info);
+		if (spi == NULL) {
+			remove_slaves(spim);
+			return -ENODEV;
+		}
+		spim->slaves[spim->nr_slaves++] = spi;
+	}
+
+	return 0;
+}
+
+static int loopback_spi_probe(struct platform_device *pdev)
+{
+	struct spi_master_loopback *spim;
+	struct rtdm_spi_master *master;
+	struct spi_master *kmaster;
+	int ret;
+
+	dev_dbg(&pdev->dev, "%s: entered\n", __func__);
+
+	master = rtdm_spi_alloc_master(&pdev->dev,
+		   struct spi_master_loopback, master);
+	if (master == NULL)
+		return -ENOMEM;
+
+	master->subclass = RTDM_SUBCLASS_LOOPBACK;
+	master->ops = &loopback_master_ops;
+	platform_set_drvdata(pdev, master);
+
+	kmaster = master->kmaster;
+	kmaster->mode_bits = SPI_CPOL | SPI_CPHA | SPI_CS_HIGH;
+	kmaster->bits_per_word_mask = SPI_BPW_MASK(8);
+	kmaster->num_chipselect = num_cs;
+	kmaster->bus_num = -1;
+
+	spim = container_of(master, struct spi_master_loopback, master);
+	spim->slaves = devm_kcalloc(&pdev->dev, num_cs,
+				    sizeof(*spim->slaves), GFP_KERNEL);
+	if (spim->slaves == NULL) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+
+	ret = rtdm_spi_add_master(master);
+	if (ret) {
+		dev_err(&pdev->dev, "%s: failed to add master\n",
+			__func__);
+		goto fail;
+	}
+
+	ret = create_slaves(spim);
+	if (ret) {
+		dev_err(&pdev->dev, "%s: failed to create slaves\n",
+			__func__);
+		rtdm_spi_remove_master(master);
+		return ret;
+	}
+
+	return 0;
+fail:
+	spi_master_put(kmaster);
+
+	return ret;
+}
+
+static int loopback_spi_remove(struct platform_device *pdev)
+{
+	struct rtdm_spi_master *master = platform_get_drvdata(pdev);
+	struct spi_master_loopback *spim;
+
+	dev_dbg(&pdev->dev, "%s: entered\n", __func__);
+
+	spim = container_of(master, struct spi_master_loopback, master);
+	remove_slaves(spim);
+	rtdm_spi_remove_master(master);
+
+	return 0;
+}
+
+static struct platform_driver loopback_spi_driver = {
+	.driver		= {
+		.name		= "spi-loopback",
+	},
+	.probe		= loopback_spi_probe,
+	.remove		= loopback_spi_remove,
+};
+
+static int __init loopback_spi_init(void)
+{
+	int ret;
+
+	if (num_cs == 0 || num_cs > 255)
+		return -EINVAL;
+
+	ret = platform_driver_register(&loopback_spi_driver);
+	if (ret)
+		return ret;
+
+	loopback_pdev = platform_device_register_simple("spi-loopback",
+							-1, NULL, 0);
+	if (IS_ERR(loopback_pdev)) {
+		platform_driver_unregister(&loopback_spi_driver);
+		return PTR_ERR(loopback_pdev);
+	}
+
+	return 0;
+}
+module_init(loopback_spi_init);
+
+static void __exit loopback_spi_exit(void)
+{
+	platform_device_unregister(loopback_pdev);
+	platform_driver_unregister(&loopback_spi_driver);
+}
+module_exit(loopback_spi_exit);
+
+MODULE_LICENSE("GPL");
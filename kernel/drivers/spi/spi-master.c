@@ -144,6 +144,102 @@ static void do_chip_deselect(struct rtdm_spi_remote_slave *slave)
 	rtdm_lock_put_irqrestore(&master->lock, c);
 }
 
+static int set_xfer_speed(struct rtdm_spi_remote_slave *slave, u32 speed_hz)
+{				/* master->bus_lock held */
+	u32 old_speed = slave->config.speed_hz;
+	int ret;
+
+	if (speed_hz == old_speed)
+		return 0;
+
+	slave->config.speed_hz = speed_hz;
+	ret = slave->master->ops->configure(slave);
+	if (ret)
+		slave->config.speed_hz = old_speed;
+
+	return ret;
+}
+
+static int do_transfer_list(struct rtdm_fd *fd,
+			    struct rtdm_spi_remote_slave *slave, void *arg)
+{
+	struct rtdm_spi_master *master = slave->master;
+	struct rtdm_spi_xfer_list list;
+	struct rtdm_spi_xfer *xfers, *x;
+	int ret, n, selected = 0;
+	u32 speed_hz;
+	size_t size;
+
+	if (master->ops->transfer_iobufs_n == NULL)
+		return -EINVAL;
+
+	ret = rtdm_safe_copy_from_user(fd, &list, arg, sizeof(list));
+	if (ret)
+		return ret;
+
+	if (list.nr_xfers == 0 || list.nr_xfers > SPI_XFER_LIST_MAX)
+		return -EINVAL;
+
+	size = list.nr_xfers * sizeof(*xfers);
+	xfers = xnmalloc(size);
+	if (xfers == NULL)
+		return -ENOMEM;
+
+	ret = rtdm_safe_copy_from_user(fd, xfers,
+				       (void __user *)(unsigned long)list.xfers,
+				       size);
+	if (ret)
+		goto out;
+
+	/* Delays are busy-waited for with the bus held, keep them short. */
+	for (n = 0, x = xfers; n < list.nr_xfers; n++, x++) {
+		if (x->delay_us > SPI_XFER_DELAY_MAX) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	/*
+	 * Run all transfers back-to-back with the bus held, only
+	 * toggling the chip select where requested.
+	 */
+	rtdm_mutex_lock(&master->bus_lock);
+
+	speed_hz = slave->config.speed_hz;
+
+	for (n = 0, x = xfers; n < list.nr_xfers; n++, x++) {
+		ret = set_xfer_speed(slave, x->speed_hz ?: speed_hz);
+		if (ret)
+			break;
+		if (!selected) {
+			ret = do_chip_select(slave);
+			if (ret)
+				break;
+			selected = 1;
+		}
+		ret = master->ops->transfer_iobufs_n(slave, x->offset, x->len);
+		if (ret)
+			break;
+		if (x->cs_change && n < list.nr_xfers - 1) {
+			do_chip_deselect(slave);
+			selected = 0;
+		}
+		if (x->delay_us)
+			rtdm_task_busy_sleep((nanosecs_rel_t)x->delay_us * 1000);
+	}
+
+	if (selected)
+		do_chip_deselect(slave);
+
+	set_xfer_speed(slave, speed_hz);
+
+	rtdm_mutex_unlock(&master->bus_lock);
+out:
+	xnfree(xfers);
+
+	return ret;
+}
+
 static int spi_master_ioctl_rt(struct rtdm_fd *fd,
 			       unsigned int request, void *arg)
 {
@@ -178,6 +274,9 @@ static int spi_master_ioctl_rt(struct rtdm_fd *fd,
 			rtdm_mutex_unlock(&master->bus_lock);
 		}
 		break;
+	case SPI_RTIOC_TRANSFER_LIST:
+		ret = do_transfer_list(fd, slave, arg);
+		break;
 	default:
 		ret = -ENOSYS;
 	}
@@ -60,6 +60,11 @@ struct rtswitch_context {
 
 	struct rtswitch_task *utask;
 	rtdm_nrtsig_t wake_utask;
+
+	struct rttst_swtest_timing *timings;
+	int timing;
+	struct rtswitch_task *switch_from;
+	xnticks_t switch_date;
 };
 
 static int fp_features;
@@ -76,6 +81,101 @@ static int report(const char *fmt, ...)
 	return ret;
 }
 
+static inline unsigned int task_endpoint(struct rtswitch_task *task)
+{
+	if (task->base.flags & RTSWITCH_KERNEL)
+		return RTTST_SWTEST_KERNEL;
+
+	return (task->base.flags & RTSWITCH_RT) ?
+		RTTST_SWTEST_PRIMARY : RTTST_SWTEST_SECONDARY;
+}
+
+static inline int task_uses_fpu(struct rtswitch_task *task)
+{
+	return task->base.flags & (RTTST_SWTEST_FPU|RTTST_SWTEST_USE_FPU);
+}
+
+static inline void stamp_switch(struct rtswitch_context *ctx,
+				struct rtswitch_task *from)
+{
+	/* Timed wake ups would account for the pause too. */
+	if (!ctx->timing || ctx->pause_us)
+		return;
+
+	ctx->switch_from = from;
+	ctx->switch_date = xnclock_read_raw(&nkclock);
+}
+
+static void account_switch(struct rtswitch_context *ctx,
+			   struct rtswitch_task *to)
+{
+	struct rtswitch_task *from = ctx->switch_from;
+	struct rttst_swtest_timing *t;
+	xnticks_t delta;
+	unsigned int path;
+
+	if (from == NULL)
+		return;
+
+	delta = xnclock_read_raw(&nkclock) - ctx->switch_date;
+	ctx->switch_from = NULL;
+
+	path = RTTST_SWTEST_PATH(task_endpoint(from), task_endpoint(to),
+				 task_uses_fpu(from) || task_uses_fpu(to));
+	t = ctx->timings + path;
+	if (t->count == 0 || delta < t->min)
+		t->min = delta;
+	if (delta > t->max)
+		t->max = delta;
+	t->sum += delta;
+	t->cells[rttst_swtest_timing_cell(delta)]++;
+	t->count++;
+}
+
+static int rtswitch_set_timing(struct rtswitch_context *ctx, int enable)
+{
+	struct rttst_swtest_timing *timings;
+
+	/*
+	 * The counters are kept once allocated, so that they can
+	 * still be retrieved after timing was switched off.
+	 */
+	if (enable && ctx->timings == NULL) {
+		timings = vzalloc(RTTST_SWTEST_NR_PATHS * sizeof(*timings));
+		if (timings == NULL)
+			return -ENOMEM;
+		ctx->timings = timings;
+	}
+
+	ctx->timing = !!enable;
+
+	return 0;
+}
+
+static int rtswitch_get_timings(struct rtdm_fd *fd,
+				struct rtswitch_context *ctx,
+				struct rttst_swtest_timings __user *u_arg)
+{
+	struct rttst_swtest_timings arg;
+	size_t len;
+
+	if (rtdm_safe_copy_from_user(fd, &arg, u_arg, sizeof(arg)))
+		return -EFAULT;
+
+	if (ctx->timings == NULL)
+		return -ENODATA;
+
+	if (arg.nr_paths > RTTST_SWTEST_NR_PATHS)
+		arg.nr_paths = RTTST_SWTEST_NR_PATHS;
+
+	len = arg.nr_paths * sizeof(struct rttst_swtest_timing);
+	if (rtdm_safe_copy_to_user(fd, arg.timings, ctx->timings, len))
+		return -EFAULT;
+
+	return rtdm_safe_copy_to_user(fd, &u_arg->nr_paths,
+				      &arg.nr_paths, sizeof(arg.nr_paths));
+}
+
 static void handle_ktask_error(struct rtswitch_context *ctx, unsigned int fp_val)
 {
 	struct rtswitch_task *cur = &ctx->tasks[ctx->error.last_switch.to];
@@ -125,6 +225,8 @@ static int rtswitch_pend_rt(struct rtswitch_context *ctx,
 	if (rc < 0)
 		return rc;
 
+	account_switch(ctx, task);
+
 	if (ctx->failed)
 		return 1;
 
@@ -186,12 +288,14 @@ static int rtswitch_to_rt(struct rtswitch_context *ctx,
 		case RTSWITCH_NRT:
 			ctx->utask = to;
 			barrier();
+			stamp_switch(ctx, from);
 			rtdm_nrtsig_pend(&ctx->wake_utask);
 			xnsched_lock();
 			break;
 
 		case RTSWITCH_RT:
 			xnsched_lock();
+			stamp_switch(ctx, from);
 			rtdm_event_signal(&to->rt_synch);
 			break;
 
@@ -205,6 +309,8 @@ static int rtswitch_to_rt(struct rtswitch_context *ctx,
 	if (rc < 0)
 		return rc;
 
+	account_switch(ctx, from);
+
 	if (ctx->failed)
 		return 1;
 
@@ -226,6 +332,8 @@ static int rtswitch_pend_nrt(struct rtswitch_context *ctx,
 	if (down_interruptible(&task->nrt_synch))
 		return -EINTR;
 
+	account_switch(ctx, task);
+
 	if (ctx->failed)
 		return 1;
 
@@ -271,6 +379,7 @@ static int rtswitch_to_nrt(struct rtswitch_context *ctx,
 		switch (to->base.flags & RTSWITCH_RT) {
 		case RTSWITCH_NRT:
 		switch_to_nrt:
+			stamp_switch(ctx, from);
 			up(&to->nrt_synch);
 			break;
 
@@ -285,12 +394,14 @@ static int rtswitch_to_nrt(struct rtswitch_context *ctx,
 				(ctx->switches_count % 4000000) * 1000;
 
 			fp_regs_set(fp_features, expected);
+			stamp_switch(ctx, from);
 			rtdm_event_signal(&to->rt_synch);
 			fp_val = fp_regs_check(fp_features, expected, report);
 			fp_linux_end();
 
 			if(down_interruptible(&from->nrt_synch))
 				return -EINTR;
+			account_switch(ctx, from);
 			if (ctx->failed)
 				return 1;
 			if (fp_val != expected) {
@@ -310,12 +421,14 @@ static int rtswitch_to_nrt(struct rtswitch_context *ctx,
 
 			fp_linux_begin();
 			fp_regs_set(fp_features, expected);
+			stamp_switch(ctx, from);
 			rtdm_event_signal(&to->rt_synch);
 			fp_val = fp_regs_check(fp_features, expected, report);
 			fp_linux_end();
 
 			if (down_interruptible(&from->nrt_synch))
 				return -EINTR;
+			account_switch(ctx, from);
 			if (ctx->failed)
 				return 1;
 			if (fp_val != expected) {
@@ -332,6 +445,7 @@ static int rtswitch_to_nrt(struct rtswitch_context *ctx,
 				goto switch_to_nrt;
 
 		signal_nofp:
+			stamp_switch(ctx, from);
 			rtdm_event_signal(&to->rt_synch);
 			break;
 
@@ -342,6 +456,8 @@ static int rtswitch_to_nrt(struct rtswitch_context *ctx,
 	if (down_interruptible(&from->nrt_synch))
 		return -EINTR;
 
+	account_switch(ctx, from);
+
 	if (ctx->failed)
 		return 1;
 
@@ -536,6 +652,9 @@ static int rtswitch_open(struct rtdm_fd *fd, int oflags)
 	ctx->failed = 0;
 	ctx->error.last_switch.from = ctx->error.last_switch.to = -1;
 	ctx->pause_us = 0;
+	ctx->timings = NULL;
+	ctx->timing = 0;
+	ctx->switch_from = NULL;
 
 	rtdm_nrtsig_init(&ctx->wake_utask, rtswitch_utask_waker, ctx);
 
@@ -566,6 +685,9 @@ static void rtswitch_close(struct rtdm_fd *fd)
 		}
 		vfree(ctx->tasks);
 	}
+
+	if (ctx->timings)
+		vfree(ctx->timings);
 }
 
 static int rtswitch_ioctl_nrt(struct rtdm_fd *fd,
@@ -594,6 +716,12 @@ static int rtswitch_ioctl_nrt(struct rtdm_fd *fd,
 		ctx->pause_us = (unsigned long) arg;
 		return 0;
 
+	case RTTST_RTIOC_SWTEST_SET_TIMING:
+		return rtswitch_set_timing(ctx, (unsigned long) arg);
+
+	case RTTST_RTIOC_SWTEST_GET_TIMINGS:
+		return rtswitch_get_timings(fd, ctx, arg);
+
 	case RTTST_RTIOC_SWTEST_REGISTER_UTASK:
 		if (!rtdm_rw_user_ok(fd, arg, sizeof(task)))
 			return -EFAULT;
@@ -61,8 +61,10 @@ static int udd_ioctl_rt(struct rtdm_fd *fd,
 			unsigned int request, void __user *arg)
 {
 	struct udd_signotify signfy;
+	struct udd_coalesce coalesce;
 	struct udd_reserved *ur;
 	struct udd_device *udd;
+	rtdm_lockctx_t ctx;
 	rtdm_event_t done;
 	int ret;
 
@@ -91,6 +93,17 @@ static int udd_ioctl_rt(struct rtdm_fd *fd,
 			ur->signfy = signfy;
 		}
 		break;
+	case UDD_RTIOC_COALESCE:
+		ret = rtdm_safe_copy_from_user(fd, &coalesce, arg, sizeof(coalesce));
+		if (ret)
+			return ret;
+		if (coalesce.delay_us > 1000000)
+			return -EINVAL;
+		rtdm_lock_get_irqsave(&ur->lock, ctx);
+		ur->coalesce_count = coalesce.count ?: 1;
+		ur->coalesce_delay = (nanosecs_rel_t)coalesce.delay_us * 1000;
+		rtdm_lock_put_irqrestore(&ur->lock, ctx);
+		break;
 	case UDD_RTIOC_IRQEN:
 	case UDD_RTIOC_IRQDIS:
 		if (udd->irq == UDD_IRQ_NONE || udd->irq == UDD_IRQ_CUSTOM)
@@ -131,14 +144,14 @@ static ssize_t udd_read_rt(struct rtdm_fd *fd,
 	context = rtdm_fd_to_private(fd);
 
 	for (;;) {
-		if (atomic_read(&ur->event) != context->event_count)
+		if (atomic_read(&ur->notified) != context->event_count)
 			break;
 		ret = rtdm_event_wait(&ur->pulse);
 		if (ret)
 			return ret;
 	}
 
-	count = atomic_read(&ur->event);
+	count = atomic_read(&ur->notified);
 	context->event_count = count;
 	ret = rtdm_copy_to_user(fd, buf, &count, sizeof(count));
 
@@ -176,6 +189,63 @@ static int udd_select(struct rtdm_fd *fd, struct xnselector *selector,
 				 selector, type, index);
 }
 
+static int udd_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	struct udd_device *udd;
+
+	udd = container_of(rtdm_fd_device(fd), struct udd_device, __reserved.device);
+
+	/* The interrupt status page is read-only. */
+	if (vma->vm_end - vma->vm_start > PAGE_SIZE ||
+	    (vma->vm_flags & VM_WRITE))
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	/*
+	 * vm_insert_page() holds a reference on the page, which
+	 * therefore outlives udd_unregister_device() as long as it
+	 * is mapped.
+	 */
+	return vm_insert_page(vma, vma->vm_start,
+			      virt_to_page(udd->__reserved.irqstat));
+}
+
+/*
+ * ur->notified is updated by the caller under ur->lock, so that it
+ * never moves backwards.
+ */
+static void udd_pulse(struct udd_reserved *ur, u32 count)
+{
+	union sigval sival;
+
+	rtdm_event_signal(&ur->pulse);
+
+	if (ur->signfy.pid > 0) {
+		sival.sival_int = count;
+		__cobalt_sigqueue(ur->signfy.pid, ur->signfy.sig, &sival);
+	}
+}
+
+static void udd_coalesce_timeout(rtdm_timer_t *timer)
+{
+	struct udd_reserved *ur;
+	u32 pending, count;
+
+	ur = container_of(timer, struct udd_reserved, coalesce_timer);
+
+	rtdm_lock_get(&ur->lock);
+	pending = ur->pending;
+	ur->pending = 0;
+	count = atomic_read(&ur->event);
+	if (pending)
+		atomic_set(&ur->notified, count);
+	rtdm_lock_put(&ur->lock);
+
+	if (pending)
+		udd_pulse(ur, count);
+}
+
 static int udd_irq_handler(rtdm_irq_t *irqh)
 {
 	struct udd_device *udd;
@@ -341,6 +411,8 @@ undo:
  *
  * - -EINVAL, if udd_device.device_flags contains invalid flags.
  *
+ * - -ENOMEM, if the interrupt status page cannot be allocated.
+ *
  * - -ENXIO can be received if this service is called while the Cobalt
  * kernel is disabled.
  *
@@ -388,14 +460,27 @@ int udd_register_device(struct udd_device *udd)
 		.write_rt = udd_write_rt,
 		.close = udd_close,
 		.select = udd_select,
+		.mmap = udd_mmap,
 	};
 
 	dev->driver = drv;
 	dev->label = udd->device_name;
 
+	ur->irqstat = (struct udd_irqstat *)get_zeroed_page(GFP_KERNEL);
+	if (ur->irqstat == NULL)
+		return -ENOMEM;
+
+	rtdm_lock_init(&ur->lock);
+	atomic_set(&ur->notified, 0);
+	ur->pending = 0;
+	ur->coalesce_count = 1;
+	ur->coalesce_delay = 0;
+	rtdm_timer_init(&ur->coalesce_timer, udd_coalesce_timeout,
+			udd->device_name);
+
 	ret = rtdm_dev_register(dev);
 	if (ret)
-		return ret;
+		goto fail_register;
 
 	if (ur->nr_maps > 0) {
 		ret = register_mapper(udd);
@@ -428,6 +513,9 @@ fail_mapper:
 	rtdm_dev_unregister(dev);
 	if (ur->mapper_name)
 		kfree(ur->mapper_name);
+fail_register:
+	rtdm_timer_destroy(&ur->coalesce_timer);
+	free_page((unsigned long)ur->irqstat);
 
 	return ret;
 }
@@ -461,6 +549,8 @@ int udd_unregister_device(struct udd_device *udd)
 	if (udd->irq != UDD_IRQ_NONE && udd->irq != UDD_IRQ_CUSTOM)
 		rtdm_irq_free(&ur->irqh);
 
+	rtdm_timer_destroy(&ur->coalesce_timer);
+
 	for (n = 0; n < UDD_NR_MAPS; n++) {
 		rn = udd->mem_regions + n;
 		if (rn->type != UDD_MEM_NONE)
@@ -472,6 +562,8 @@ int udd_unregister_device(struct udd_device *udd)
 
 	rtdm_dev_unregister(&ur->device);
 
+	free_page((unsigned long)ur->irqstat);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(udd_unregister_device);
@@ -484,8 +576,11 @@ EXPORT_SYMBOL_GPL(udd_unregister_device);
  * notify the UDD core when IRQ events are received by calling this
  * service.
  *
- * As a result, the UDD core wakes up any Cobalt thread waiting for
- * interrupts on the device via a read(2) or select(2) call.
+ * As a result, the UDD core updates the interrupt status page of the
+ * device, then wakes up any Cobalt thread waiting for interrupts on
+ * the device via a read(2) or select(2) call, unless event
+ * coalescing is enabled (see UDD_RTIOC_COALESCE) and the notification
+ * has to be postponed.
  *
  * @param udd UDD device descriptor receiving the IRQ.
  *
@@ -500,15 +595,38 @@ EXPORT_SYMBOL_GPL(udd_unregister_device);
 void udd_notify_event(struct udd_device *udd)
 {
 	struct udd_reserved *ur = &udd->__reserved;
-	union sigval sival;
-
-	atomic_inc(&ur->event);
-	rtdm_event_signal(&ur->pulse);
+	struct udd_irqstat *stat = ur->irqstat;
+	int pulse, arm = 0, disarm = 0;
+	u32 count;
 
-	if (ur->signfy.pid > 0) {
-		sival.sival_int = atomic_read(&ur->event);
-		__cobalt_sigqueue(ur->signfy.pid, ur->signfy.sig, &sival);
-	}
+	rtdm_lock_get(&ur->lock);
+
+	count = atomic_inc_return(&ur->event);
+	stat->seq++;
+	smp_wmb();
+	stat->count = count;
+	stat->timestamp = rtdm_clock_read_monotonic();
+	smp_wmb();
+	stat->seq++;
+
+	pulse = ++ur->pending >= ur->coalesce_count;
+	if (pulse) {
+		ur->pending = 0;
+		atomic_set(&ur->notified, count);
+		disarm = ur->coalesce_count > 1 && ur->coalesce_delay > 0;
+	} else
+		arm = ur->pending == 1 && ur->coalesce_delay > 0;
+
+	rtdm_lock_put(&ur->lock);
+
+	/* The timer handler takes ur->lock under the core lock. */
+	if (pulse) {
+		if (disarm)
+			rtdm_timer_stop(&ur->coalesce_timer);
+		udd_pulse(ur, count);
+	} else if (arm)
+		rtdm_timer_start(&ur->coalesce_timer, ur->coalesce_delay,
+				 0, RTDM_TIMERMODE_RELATIVE);
 }
 EXPORT_SYMBOL_GPL(udd_notify_event);
 
@@ -21,6 +21,8 @@
  */
 
 #include <errno.h>
+#include <stdint.h>
+#include <string.h>
 #include <rtdm/analogy.h>
 #include "internal.h"
 
@@ -468,4 +470,290 @@ int a4l_async_write(a4l_desc_t * dsc,
 	return a4l_sys_write(dsc->fd, buf, nbyte);
 }
 
+/**
+ * @brief Initialize a scan reader on a mapped input buffer
+ *
+ * A scan reader exposes the asynchronous ring-buffer mapped by
+ * a4l_mmap() as a sequence of complete scans, each scan holding one
+ * sample per channel of the acquisition command, in the command
+ * order. The reader takes care of the buffer wraparound, and keeps
+ * the Analogy layer informed of the consumed data.
+ *
+ * @param[out] rd Scan reader to initialize
+ * @param[in] dsc Device descriptor filled by a4l_open() and
+ * a4l_fill_desc()
+ * @param[in] idx_subd Index of the input subdevice
+ * @param[in] map Buffer address returned by a4l_mmap()
+ * @param[in] buf_size Size of the mapped buffer
+ * @param[in] chans Channel descriptors, in scan order
+ * @param[in] rngs Range descriptors, in scan order; may be NULL if
+ * a4l_scan_readf() is not used
+ * @param[in] nb_chans Count of channels in a scan
+ *
+ * The @a chans and @a rngs arrays are referred to by the reader, so
+ * they must remain valid as long as it is used.
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong; the
+ *    channel count must not exceed A4L_SCAN_MAXCHANS, and the buffer
+ *    must hold at least one scan
+ *
+ */
+int a4l_scan_init(a4l_scanrd_t *rd, a4l_desc_t *dsc,
+		  unsigned int idx_subd, void *map, unsigned long buf_size,
+		  a4l_chinfo_t **chans, a4l_rnginfo_t **rngs, int nb_chans)
+{
+	int n, size;
+
+	/* Basic checkings */
+	if (rd == NULL || dsc == NULL || map == NULL || chans == NULL)
+		return -EINVAL;
+
+	if (nb_chans <= 0 || nb_chans > A4L_SCAN_MAXCHANS)
+		return -EINVAL;
+
+	rd->scan_size = 0;
+	for (n = 0; n < nb_chans; n++) {
+		size = a4l_sizeof_chan(chans[n]);
+		if (size < 0)
+			return size;
+		rd->scan_size += size;
+	}
+
+	if (buf_size < rd->scan_size)
+		return -EINVAL;
+
+	rd->dsc = dsc;
+	rd->idx_subd = idx_subd;
+	rd->map = map;
+	rd->buf_size = buf_size;
+	rd->chans = chans;
+	rd->rngs = rngs;
+	rd->nb_chans = nb_chans;
+	rd->offset = 0;
+	rd->avail = 0;
+	rd->pending = 0;
+
+	return 0;
+}
+
+/**
+ * @brief Get a view on the next complete scans
+ *
+ * This function returns the address of a contiguous run of complete
+ * scans in the mapped buffer, without copying them. Since the run
+ * stops at the end of the ring-buffer, the scans following the
+ * wraparound point are returned by the next call. A scan straddling
+ * the end of the buffer is returned alone, reassembled in the
+ * reader.
+ *
+ * The returned scans remain valid until they are released with
+ * a4l_scan_put(), which must happen before the next call to
+ * a4l_scan_get().
+ *
+ * @param[in] rd Scan reader initialized by a4l_scan_init()
+ * @param[out] ptr Address of the first scan on return
+ * @param[in] ms_timeout The number of miliseconds to wait for a
+ * complete scan to be available. Passing A4L_INFINITE causes the
+ * caller to block indefinitely until some data is available.
+ * Passing A4L_NONBLOCK causes the function to return immediately
+ * without waiting for any available data
+ *
+ * @return the count of scans available at @a ptr, zero if no
+ * complete scan was received in time. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong
+ * - -ENOENT is returned if the acquisition is over and all the
+ *    acquired scans were consumed
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ * - -EINTR is returned if calling task has been unblocked by a signal
+ *
+ */
+int a4l_scan_get(a4l_scanrd_t *rd, void **ptr, unsigned long ms_timeout)
+{
+	unsigned long contig, count;
+	int ret;
+
+	/* Basic checkings */
+	if (rd == NULL || ptr == NULL)
+		return -EINVAL;
+
+	/* Report the consumed scans and refresh the data count */
+	if (rd->pending || rd->avail < rd->scan_size) {
+		ret = a4l_mark_bufrw(rd->dsc, rd->idx_subd,
+				     rd->pending, &count);
+		if (ret < 0)
+			return ret;
+		rd->pending = 0;
+		rd->avail = count;
+	}
+
+	if (rd->avail < rd->scan_size) {
+		if (ms_timeout == A4L_NONBLOCK)
+			return 0;
+		ret = a4l_poll(rd->dsc, rd->idx_subd, ms_timeout);
+		if (ret <= 0)
+			return ret;
+		ret = a4l_mark_bufrw(rd->dsc, rd->idx_subd, 0, &count);
+		if (ret < 0)
+			return ret;
+		rd->avail = count;
+		if (rd->avail < rd->scan_size)
+			return 0;
+	}
+
+	contig = rd->buf_size - rd->offset;
+	if (contig >= rd->scan_size) {
+		*ptr = rd->map + rd->offset;
+		count = rd->avail < contig ? rd->avail : contig;
+		return count / rd->scan_size;
+	}
+
+	/* The next scan wraps around, reassemble it */
+	memcpy(rd->bounce, rd->map + rd->offset, contig);
+	memcpy(rd->bounce + contig, rd->map, rd->scan_size - contig);
+	*ptr = rd->bounce;
+
+	return 1;
+}
+
+/**
+ * @brief Release scans obtained with a4l_scan_get()
+ *
+ * The released area of the ring-buffer is handed back to the
+ * Analogy layer on the next call to a4l_scan_get().
+ *
+ * @param[in] rd Scan reader initialized by a4l_scan_init()
+ * @param[in] nb_scans Count of scans consumed, which must not exceed
+ * the count returned by the last call to a4l_scan_get()
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong
+ *
+ */
+int a4l_scan_put(a4l_scanrd_t *rd, int nb_scans)
+{
+	unsigned long size;
+
+	/* Basic checkings */
+	if (rd == NULL || nb_scans < 0)
+		return -EINVAL;
+
+	size = (unsigned long)nb_scans * rd->scan_size;
+	if (size > rd->avail)
+		return -EINVAL;
+
+	rd->offset = (rd->offset + size) % rd->buf_size;
+	rd->avail -= size;
+	rd->pending += size;
+
+	return 0;
+}
+
+#ifndef DOXYGEN_CPP
+
+/* Convert one channel of nb_scans interleaved scans. */
+#define DEMUX_CHAN(type, p, ofs, stride, dst, nb, a, b)			\
+	do {								\
+		const unsigned char *__p = (p) + (ofs);			\
+		int __s;						\
+		for (__s = 0; __s < (nb); __s++, __p += (stride))	\
+			(dst)[__s] = (a) * *(const type *)__p + (b);	\
+	} while (0)
+
+static void demux_scans(a4l_scanrd_t *rd, float **dst, const void *src,
+			int nb_scans, const float *a, const float *b)
+{
+	int n, size, ofs = 0;
+
+	for (n = 0; n < rd->nb_chans; n++) {
+		size = a4l_sizeof_chan(rd->chans[n]);
+		switch (size) {
+		case 4:
+			DEMUX_CHAN(uint32_t, src, ofs, rd->scan_size,
+				   dst[n], nb_scans, a[n], b[n]);
+			break;
+		case 2:
+			DEMUX_CHAN(uint16_t, src, ofs, rd->scan_size,
+				   dst[n], nb_scans, a[n], b[n]);
+			break;
+		default:
+			DEMUX_CHAN(uint8_t, src, ofs, rd->scan_size,
+				   dst[n], nb_scans, a[n], b[n]);
+		}
+		ofs += size;
+	}
+}
+
+#endif /* !DOXYGEN_CPP */
+
+/**
+ * @brief Demultiplex and convert scans into per-channel arrays
+ *
+ * This function reads complete scans from the mapped buffer, and
+ * converts each sample to a float value according to the range of
+ * its channel, storing it into the array of the channel. The samples
+ * are converted straight from the ring-buffer, with no intermediate
+ * copy.
+ *
+ * The function waits for the first scan according to @a ms_timeout,
+ * then converts as many of the available scans as requested without
+ * waiting any further.
+ *
+ * @param[in] rd Scan reader initialized by a4l_scan_init() with
+ * range descriptors
+ * @param[out] dst Array of nb_chans output arrays, each of them able
+ * to hold @a nb_scans values
+ * @param[in] nb_scans Maximum count of scans to convert
+ * @param[in] ms_timeout The number of miliseconds to wait for a
+ * complete scan to be available, see a4l_scan_get()
+ *
+ * @return the count of scans converted. Otherwise, any error code
+ * returned by a4l_scan_get(), or:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong
+ *
+ */
+int a4l_scan_readf(a4l_scanrd_t *rd, float **dst,
+		   int nb_scans, unsigned long ms_timeout)
+{
+	float a[A4L_SCAN_MAXCHANS], b[A4L_SCAN_MAXCHANS];
+	float *out[A4L_SCAN_MAXCHANS];
+	int n, ret, done = 0;
+	void *ptr;
+
+	/* Basic checkings */
+	if (rd == NULL || rd->rngs == NULL || dst == NULL || nb_scans < 0)
+		return -EINVAL;
+
+	for (n = 0; n < rd->nb_chans; n++) {
+		if (rd->rngs[n] == NULL || dst[n] == NULL)
+			return -EINVAL;
+		a4l_rng_coeffs_f(rd->chans[n], rd->rngs[n], a + n, b + n);
+		out[n] = dst[n];
+	}
+
+	while (done < nb_scans) {
+		ret = a4l_scan_get(rd, &ptr, done ? A4L_NONBLOCK : ms_timeout);
+		if (ret < 0)
+			return done ? done : ret;
+		if (ret == 0)
+			break;
+
+		if (ret > nb_scans - done)
+			ret = nb_scans - done;
+
+		demux_scans(rd, out, ptr, ret, a, b);
+		a4l_scan_put(rd, ret);
+
+		for (n = 0; n < rd->nb_chans; n++)
+			out[n] += ret;
+		done += ret;
+	}
+
+	return done;
+}
+
 /** @} Command syscall API */
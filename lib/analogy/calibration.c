@@ -26,9 +26,12 @@
 #include <rtdm/analogy.h>
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
+#include <string.h>
 #include "iniparser/iniparser.h"
 #include "boilerplate/list.h"
 #include "calibration.h"
+#include "internal.h"
 
 #define CHK(func, ...)								\
 do {										\
@@ -39,34 +42,16 @@ do {										\
 
 #define ARRAY_LEN(a)  (sizeof(a) / sizeof((a)[0]))
 
-static lsampl_t data32_get(void *src)
+/* Horner evaluation of the calibration polynomial at x. */
+static inline double poly_eval(struct a4l_polynomial *p, double x)
 {
-	return (lsampl_t) * ((lsampl_t *) (src));
-}
-
-static lsampl_t data16_get(void *src)
-{
-	return (lsampl_t) * ((sampl_t *) (src));
-}
-
-static lsampl_t data8_get(void *src)
-{
-	return (lsampl_t) * ((unsigned char *)(src));
-}
+	double t = x - p->expansion, v = 0.0;
+	int k;
 
-static void data32_set(void *dst, lsampl_t val)
-{
-	*((lsampl_t *) (dst)) = val;
-}
+	for (k = p->nb_coeff - 1; k >= 0; k--)
+		v = v * t + p->coeff[k];
 
-static void data16_set(void *dst, lsampl_t val)
-{
-	*((sampl_t *) (dst)) = (sampl_t) (0xffff & val);
-}
-
-static void data8_set(void *dst, lsampl_t val)
-{
-	*((unsigned char *)(dst)) = (unsigned char)(0xff & val);
+	return v;
 }
 
 static inline int read_dbl(double *d, struct _dictionary_ *f,const char *subd,
@@ -348,54 +333,30 @@ int a4l_get_softcal_converter(struct a4l_polynomial *converter,
 int a4l_rawtodcal(a4l_chinfo_t *chan, double *dst, void *src,
 		  int cnt, struct a4l_polynomial *converter)
 {
-	int i = 0, j = 0, k = 0;
-	double term = 1.0;
-	lsampl_t tmp;
-	int size;
-
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	int idx;
 
 	/* Basic checking */
-	if (chan == NULL)
+	if (chan == NULL || converter == NULL)
 		return -EINVAL;
 
-	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	/* Get the suitable conversion kernel */
+	idx = a4l_conv_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
-	while (j < cnt) {
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
+	if (cnt <= 0)
+		return 0;
 
-		/* Perform the conversion */
-		dst[j] = 0.0;
-		term = 1.0;
-		for (k = 0; k < converter->nb_coeff; k++) {
-			dst[j] += converter->coeff[k] * term;
-			term *= tmp - converter->expansion;
-		}
-
-		/* Update the counters */
-		i += size;
-		j++;
+	if (converter->nb_coeff <= 0) {
+		memset(dst, 0, cnt * sizeof(double));
+		return cnt;
 	}
 
-	return j;
+	a4l_conv_get_kernels()->rawtod_poly[idx](dst, src, cnt,
+						 converter->expansion,
+						 converter->coeff,
+						 converter->nb_coeff);
+	return cnt;
 }
 
 /**
@@ -420,53 +381,36 @@ int a4l_rawtodcal(a4l_chinfo_t *chan, double *dst, void *src,
 int a4l_dcaltoraw( a4l_chinfo_t * chan, void *dst, double *src, int cnt,
 		   struct a4l_polynomial *converter)
 {
-	int size, i = 0, j = 0, k = 0;
-	double value, term;
-
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
+	uint32_t *d32 = dst;
+	uint16_t *d16 = dst;
+	uint8_t *d8 = dst;
+	int j;
 
 	/* Basic checking */
-	if (chan == NULL)
+	if (chan == NULL || converter == NULL)
 		return -EINVAL;
 
-	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
+	/* One loop per sample width, no per-sample accessor */
+	switch (a4l_sizeof_chan(chan)) {
 	case 4:
-		datax_set = data32_set;
+		for (j = 0; j < cnt; j++)
+			d32[j] = (lsampl_t)nearbyint(poly_eval(converter, src[j]));
 		break;
 	case 2:
-		datax_set = data16_set;
+		for (j = 0; j < cnt; j++)
+			d16[j] = 0xffff &
+				(lsampl_t)nearbyint(poly_eval(converter, src[j]));
 		break;
 	case 1:
-		datax_set = data8_set;
+		for (j = 0; j < cnt; j++)
+			d8[j] = 0xff &
+				(lsampl_t)nearbyint(poly_eval(converter, src[j]));
 		break;
 	default:
 		return -EINVAL;
 	};
 
-	while (j < cnt) {
-
-		/* Performs the conversion */
-		value = 0.0;
-		term = 1.0;
-		for (k = 0; k < converter->nb_coeff; k++) {
-			value += converter->coeff[k] * term;
-			term *= src[j] - converter->expansion;
-		}
-		value = nearbyint(value);
-
-		datax_set(dst + i, (lsampl_t) value);
-
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt < 0 ? 0 : cnt;
 }
 
 /** @} Calibration API */
@@ -0,0 +1,476 @@
+/**
+ * @file
+ * Analogy for Linux, sample conversion kernels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "internal.h"
+#include <rtdm/analogy.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONV_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CONV_NEON
+#include <arm_neon.h>
+#endif
+
+#ifndef DOXYGEN_CPP
+
+/*
+ * Raw samples are converted by width-specialized kernels, in blocks
+ * of as many samples as the vector unit of the CPU can process at
+ * once, the remaining samples being converted by scalar code. The
+ * kernels are selected at runtime, according to the CPU features.
+ *
+ * Affine kernels compute dst[i] = a[k] * src[i] + b[k], k cycling
+ * over the coefficient period, so that interleaved multi-channel
+ * scans can be converted in a single pass; the coefficient arrays
+ * hold period + A4L_CONV_MAXLANES - 1 entries, see
+ * a4l_conv_fill_coeffs(). The multiplication and the addition are
+ * not fused, so that all kernels produce the same results as the
+ * scalar code.
+ *
+ * Polynomial kernels evaluate the calibration polynomial using the
+ * Horner scheme.
+ */
+
+#define DEFINE_SCALAR_KERNELS(w)					\
+static void scalar_rawtof_##w(float *dst, const void *src, int cnt,	\
+			      const float *a, const float *b,		\
+			      int period, int i, int k)			\
+{									\
+	const uint##w##_t *s = src;					\
+									\
+	for (; i < cnt; i++) {						\
+		dst[i] = a[k] * (lsampl_t)s[i] + b[k];			\
+		if (++k == period)					\
+			k = 0;						\
+	}								\
+}									\
+									\
+static void scalar_rawtod_##w(double *dst, const void *src, int cnt,	\
+			      const double *a, const double *b,		\
+			      int period, int i, int k)			\
+{									\
+	const uint##w##_t *s = src;					\
+									\
+	for (; i < cnt; i++) {						\
+		dst[i] = a[k] * (lsampl_t)s[i] + b[k];			\
+		if (++k == period)					\
+			k = 0;						\
+	}								\
+}									\
+									\
+static void scalar_rawtod_poly_##w(double *dst, const void *src,	\
+				   int cnt, double origin,		\
+				   const double *coeff, int nb_coeff,	\
+				   int i)					\
+{									\
+	const uint##w##_t *s = src;					\
+	double t, v;							\
+	int k;								\
+									\
+	for (; i < cnt; i++) {						\
+		t = (lsampl_t)s[i] - origin;				\
+		v = coeff[nb_coeff - 1];				\
+		for (k = nb_coeff - 2; k >= 0; k--)			\
+			v = v * t + coeff[k];				\
+		dst[i] = v;						\
+	}								\
+}									\
+									\
+static void generic_rawtof_##w(float *dst, const void *src, int cnt,	\
+			       const float *a, const float *b,		\
+			       int period)				\
+{									\
+	scalar_rawtof_##w(dst, src, cnt, a, b, period, 0, 0);		\
+}									\
+									\
+static void generic_rawtod_##w(double *dst, const void *src, int cnt,	\
+			       const double *a, const double *b,	\
+			       int period)				\
+{									\
+	scalar_rawtod_##w(dst, src, cnt, a, b, period, 0, 0);		\
+}									\
+									\
+static void generic_rawtod_poly_##w(double *dst, const void *src,	\
+				    int cnt, double origin,		\
+				    const double *coeff, int nb_coeff)	\
+{									\
+	scalar_rawtod_poly_##w(dst, src, cnt, origin,			\
+			       coeff, nb_coeff, 0);			\
+}
+
+DEFINE_SCALAR_KERNELS(8)
+DEFINE_SCALAR_KERNELS(16)
+DEFINE_SCALAR_KERNELS(32)
+
+static const struct a4l_conv_kernels generic_kernels = {
+	.name = "generic",
+	.rawtof = { generic_rawtof_8, generic_rawtof_16, generic_rawtof_32 },
+	.rawtod = { generic_rawtod_8, generic_rawtod_16, generic_rawtod_32 },
+	.rawtod_poly = {
+		generic_rawtod_poly_8,
+		generic_rawtod_poly_16,
+		generic_rawtod_poly_32,
+	},
+};
+
+#define next_period(k, lanes, period)			\
+	do {						\
+		(k) += (lanes);				\
+		if ((k) >= (period))			\
+			(k) %= (period);		\
+	} while (0)
+
+/*
+ * Vector kernels, built on top of per-ISA helpers loading a block of
+ * raw samples of a given width, then converting them to float or
+ * double vectors:
+ *
+ * - LOADx_w(p) loads a block of w-bit samples as 32-bit integers,
+ * - CVTF_w(x) converts the 32-bit integers to a float vector,
+ * - CVTD_w(x, h) converts the lower (h = 0) or upper (h = 1) half of
+ *   the 32-bit integers to a double vector.
+ */
+#define DEFINE_VECTOR_KERNELS(isa, attr, lanes, w, vf, vd, vi,		\
+			      loadf, loadd, storef, stored,		\
+			      dupf, dupd, addf, addd, mulf, muld,	\
+			      subd, LOAD, CVTF, CVTD)			\
+static attr void isa##_rawtof_##w(float *dst, const void *src,		\
+				  int cnt, const float *a,		\
+				  const float *b, int period)		\
+{									\
+	const uint##w##_t *s = src;					\
+	int i, k = 0;							\
+	vi x;								\
+									\
+	for (i = 0; i + lanes <= cnt; i += lanes) {			\
+		x = LOAD(s + i);					\
+		storef(dst + i,						\
+		       addf(mulf(loadf(a + k), CVTF(x)), loadf(b + k)));\
+		next_period(k, lanes, period);				\
+	}								\
+									\
+	scalar_rawtof_##w(dst, src, cnt, a, b, period, i, k);		\
+}									\
+									\
+static attr void isa##_rawtod_##w(double *dst, const void *src,	\
+				  int cnt, const double *a,		\
+				  const double *b, int period)		\
+{									\
+	const int half = lanes / 2;					\
+	const uint##w##_t *s = src;					\
+	int i, k = 0;							\
+	vi x;								\
+									\
+	for (i = 0; i + lanes <= cnt; i += lanes) {			\
+		x = LOAD(s + i);					\
+		stored(dst + i,						\
+		       addd(muld(loadd(a + k), CVTD(x, 0)),		\
+			    loadd(b + k)));				\
+		stored(dst + i + half,					\
+		       addd(muld(loadd(a + k + half), CVTD(x, 1)),	\
+			    loadd(b + k + half)));			\
+		next_period(k, lanes, period);				\
+	}								\
+									\
+	scalar_rawtod_##w(dst, src, cnt, a, b, period, i, k);		\
+}									\
+									\
+static attr void isa##_rawtod_poly_##w(double *dst, const void *src,	\
+				       int cnt, double origin,		\
+				       const double *coeff,		\
+				       int nb_coeff)			\
+{									\
+	const int half = lanes / 2;					\
+	const uint##w##_t *s = src;					\
+	vd t0, t1, v0, v1, c;						\
+	int i, k;							\
+	vi x;								\
+									\
+	for (i = 0; i + lanes <= cnt; i += lanes) {			\
+		x = LOAD(s + i);					\
+		t0 = subd(CVTD(x, 0), dupd(origin));			\
+		t1 = subd(CVTD(x, 1), dupd(origin));			\
+		v0 = v1 = dupd(coeff[nb_coeff - 1]);			\
+		for (k = nb_coeff - 2; k >= 0; k--) {			\
+			c = dupd(coeff[k]);				\
+			v0 = addd(muld(v0, t0), c);			\
+			v1 = addd(muld(v1, t1), c);			\
+		}							\
+		stored(dst + i, v0);					\
+		stored(dst + i + half, v1);				\
+	}								\
+									\
+	scalar_rawtod_poly_##w(dst, src, cnt, origin,			\
+			       coeff, nb_coeff, i);			\
+}
+
+#define DEFINE_VECTOR_KERNEL_SET(isa)					\
+static const struct a4l_conv_kernels isa##_kernels = {			\
+	.name = #isa,							\
+	.rawtof = { isa##_rawtof_8, isa##_rawtof_16, isa##_rawtof_32 },	\
+	.rawtod = { isa##_rawtod_8, isa##_rawtod_16, isa##_rawtod_32 },	\
+	.rawtod_poly = {						\
+		isa##_rawtod_poly_8,					\
+		isa##_rawtod_poly_16,					\
+		isa##_rawtod_poly_32,					\
+	},								\
+}
+
+#ifdef CONV_X86
+
+/* SSE2: 4 samples per block. */
+
+#define __sse2 __attribute__((target("sse2")))
+
+static inline __sse2 __m128i sse2_load_8(const uint8_t *p)
+{
+	__m128i z = _mm_setzero_si128();
+	int32_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), z), z);
+}
+
+static inline __sse2 __m128i sse2_load_16(const uint16_t *p)
+{
+	return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)p),
+				  _mm_setzero_si128());
+}
+
+static inline __sse2 __m128i sse2_load_32(const uint32_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline __sse2 __m128 sse2_cvtf_s(__m128i x)
+{
+	return _mm_cvtepi32_ps(x);
+}
+
+/* Rounds once, like the scalar unsigned to float conversion. */
+static inline __sse2 __m128 sse2_cvtf_u(__m128i x)
+{
+	__m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(x, 16));
+	__m128 lo = _mm_cvtepi32_ps(_mm_and_si128(x, _mm_set1_epi32(0xffff)));
+
+	return _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+}
+
+static inline __sse2 __m128i sse2_half(__m128i x, int h)
+{
+	return h ? _mm_srli_si128(x, 8) : x;
+}
+
+static inline __sse2 __m128d sse2_cvtd_s(__m128i x, int h)
+{
+	return _mm_cvtepi32_pd(sse2_half(x, h));
+}
+
+static inline __sse2 __m128d sse2_cvtd_u(__m128i x, int h)
+{
+	x = _mm_xor_si128(sse2_half(x, h), _mm_set1_epi32(0x80000000));
+
+	return _mm_add_pd(_mm_cvtepi32_pd(x), _mm_set1_pd(2147483648.0));
+}
+
+#define DEFINE_SSE2_KERNELS(w, cvtf, cvtd)				\
+	DEFINE_VECTOR_KERNELS(sse2, __sse2, 4, w,			\
+			      __m128, __m128d, __m128i,			\
+			      _mm_loadu_ps, _mm_loadu_pd,		\
+			      _mm_storeu_ps, _mm_storeu_pd,		\
+			      _mm_set1_ps, _mm_set1_pd,			\
+			      _mm_add_ps, _mm_add_pd,			\
+			      _mm_mul_ps, _mm_mul_pd, _mm_sub_pd,	\
+			      sse2_load_##w, cvtf, cvtd)
+
+DEFINE_SSE2_KERNELS(8, sse2_cvtf_s, sse2_cvtd_s)
+DEFINE_SSE2_KERNELS(16, sse2_cvtf_s, sse2_cvtd_s)
+DEFINE_SSE2_KERNELS(32, sse2_cvtf_u, sse2_cvtd_u)
+DEFINE_VECTOR_KERNEL_SET(sse2);
+
+/* AVX2: 8 samples per block. */
+
+#define __avx2 __attribute__((target("avx2")))
+
+static inline __avx2 __m256i avx2_load_8(const uint8_t *p)
+{
+	return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+static inline __avx2 __m256i avx2_load_16(const uint16_t *p)
+{
+	return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline __avx2 __m256i avx2_load_32(const uint32_t *p)
+{
+	return _mm256_loadu_si256((const __m256i *)p);
+}
+
+static inline __avx2 __m256 avx2_cvtf_s(__m256i x)
+{
+	return _mm256_cvtepi32_ps(x);
+}
+
+static inline __avx2 __m256 avx2_cvtf_u(__m256i x)
+{
+	__m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(x, 16));
+	__m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(x,
+					_mm256_set1_epi32(0xffff)));
+
+	return _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+}
+
+static inline __avx2 __m128i avx2_half(__m256i x, int h)
+{
+	return h ? _mm256_extracti128_si256(x, 1) :
+		_mm256_castsi256_si128(x);
+}
+
+static inline __avx2 __m256d avx2_cvtd_s(__m256i x, int h)
+{
+	return _mm256_cvtepi32_pd(avx2_half(x, h));
+}
+
+static inline __avx2 __m256d avx2_cvtd_u(__m256i x, int h)
+{
+	__m128i v = _mm_xor_si128(avx2_half(x, h), _mm_set1_epi32(0x80000000));
+
+	return _mm256_add_pd(_mm256_cvtepi32_pd(v),
+			     _mm256_set1_pd(2147483648.0));
+}
+
+#define DEFINE_AVX2_KERNELS(w, cvtf, cvtd)				\
+	DEFINE_VECTOR_KERNELS(avx2, __avx2, 8, w,			\
+			      __m256, __m256d, __m256i,			\
+			      _mm256_loadu_ps, _mm256_loadu_pd,		\
+			      _mm256_storeu_ps, _mm256_storeu_pd,	\
+			      _mm256_set1_ps, _mm256_set1_pd,		\
+			      _mm256_add_ps, _mm256_add_pd,		\
+			      _mm256_mul_ps, _mm256_mul_pd,		\
+			      _mm256_sub_pd,				\
+			      avx2_load_##w, cvtf, cvtd)
+
+DEFINE_AVX2_KERNELS(8, avx2_cvtf_s, avx2_cvtd_s)
+DEFINE_AVX2_KERNELS(16, avx2_cvtf_s, avx2_cvtd_s)
+DEFINE_AVX2_KERNELS(32, avx2_cvtf_u, avx2_cvtd_u)
+DEFINE_VECTOR_KERNEL_SET(avx2);
+
+#endif /* CONV_X86 */
+
+#ifdef CONV_NEON
+
+/*
+ * NEON (AArch64): 4 samples per block. Unsigned conversions are
+ * native, and exact for doubles.
+ */
+
+#define __neon
+
+static inline uint32x4_t neon_load_8(const uint8_t *p)
+{
+	uint8x8_t v;
+	uint32_t w;
+
+	memcpy(&w, p, sizeof(w));
+	v = vreinterpret_u8_u32(vdup_n_u32(w));
+
+	return vmovl_u16(vget_low_u16(vmovl_u8(v)));
+}
+
+static inline uint32x4_t neon_load_16(const uint16_t *p)
+{
+	return vmovl_u16(vld1_u16(p));
+}
+
+static inline uint32x4_t neon_load_32(const uint32_t *p)
+{
+	return vld1q_u32(p);
+}
+
+static inline float64x2_t neon_cvtd(uint32x4_t x, int h)
+{
+	uint32x2_t v = h ? vget_high_u32(x) : vget_low_u32(x);
+
+	return vcvtq_f64_u64(vmovl_u32(v));
+}
+
+#define DEFINE_NEON_KERNELS(w)						\
+	DEFINE_VECTOR_KERNELS(neon, __neon, 4, w,			\
+			      float32x4_t, float64x2_t, uint32x4_t,	\
+			      vld1q_f32, vld1q_f64,			\
+			      vst1q_f32, vst1q_f64,			\
+			      vdupq_n_f32, vdupq_n_f64,			\
+			      vaddq_f32, vaddq_f64,			\
+			      vmulq_f32, vmulq_f64, vsubq_f64,		\
+			      neon_load_##w, vcvtq_f32_u32, neon_cvtd)
+
+DEFINE_NEON_KERNELS(8)
+DEFINE_NEON_KERNELS(16)
+DEFINE_NEON_KERNELS(32)
+DEFINE_VECTOR_KERNEL_SET(neon);
+
+#endif /* CONV_NEON */
+
+static const struct a4l_conv_kernels *select_kernels(void)
+{
+#ifdef CONV_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return &avx2_kernels;
+	if (__builtin_cpu_supports("sse2"))
+		return &sse2_kernels;
+#endif
+#ifdef CONV_NEON
+	return &neon_kernels;
+#endif
+	return &generic_kernels;
+}
+
+const struct a4l_conv_kernels *a4l_conv_get_kernels(void)
+{
+	static const struct a4l_conv_kernels *kernels;
+
+	/* Racing here is harmless, all callers pick the same set. */
+	if (kernels == NULL)
+		kernels = select_kernels();
+
+	return kernels;
+}
+
+int a4l_conv_index(int size)
+{
+	switch (size) {
+	case 1:
+		return 0;
+	case 2:
+		return 1;
+	case 4:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+#endif /* !DOXYGEN_CPP */
@@ -25,6 +25,7 @@
 #define MAGIC_CPLX_DESC 0xabcd1234
 
 #include <rtdm/rtdm.h>
+#include <rtdm/analogy.h>
 
 #ifndef DOXYGEN_CPP
 
@@ -53,6 +54,47 @@ static inline ssize_t __sys_write(int fd, const void *buf, size_t nbyte)
 	return __RT(write(fd, buf, nbyte));
 }
 
+/*
+ * Sample conversion kernels (convert.c), indexed by sample width:
+ * 0 for 8-bit, 1 for 16-bit, 2 for 32-bit samples.
+ */
+
+#define A4L_CONV_MAXLANES	8
+#define A4L_CONV_MAXCHANS	A4L_SCAN_MAXCHANS
+
+struct a4l_conv_kernels {
+	const char *name;
+	void (*rawtof[3])(float *dst, const void *src, int cnt,
+			  const float *a, const float *b, int period);
+	void (*rawtod[3])(double *dst, const void *src, int cnt,
+			  const double *a, const double *b, int period);
+	void (*rawtod_poly[3])(double *dst, const void *src, int cnt,
+			       double origin, const double *coeff,
+			       int nb_coeff);
+};
+
+const struct a4l_conv_kernels *a4l_conv_get_kernels(void);
+
+void a4l_rng_coeffs_f(a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+		      float *a, float *b);
+
+void a4l_rng_coeffs_d(a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+		      double *a, double *b);
+
+int a4l_conv_index(int size);
+
+/*
+ * Extend coefficient arrays holding @period values with the
+ * A4L_CONV_MAXLANES - 1 entries vector kernels may read past the
+ * end of the period.
+ */
+#define a4l_conv_fill_coeffs(c, period)					\
+	do {								\
+		int __n;						\
+		for (__n = 0; __n < A4L_CONV_MAXLANES - 1; __n++)	\
+			(c)[(period) + __n] = (c)[__n % (period)];	\
+	} while (0)
+
 #endif /* !DOXYGEN_CPP */
 
 #endif /* __ANALOGY_LIB_INTERNAL__ */
@@ -21,6 +21,7 @@
  */
 
 #include <errno.h>
+#include <stdint.h>
 #include <math.h>
 #include "internal.h"
 #include <rtdm/analogy.h>
@@ -57,6 +58,51 @@ static void data8_set(void *dst, lsampl_t val)
 	*((unsigned char *)(dst)) = (unsigned char)(0xff & val);
 }
 
+/* phys = a * src + b */
+void a4l_rng_coeffs_f(a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+		       float *a, float *b)
+{
+	*a = ((float)(rng->max - rng->min)) /
+		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
+	*b = ((float)rng->min) / A4L_RNG_FACTOR;
+}
+
+void a4l_rng_coeffs_d(a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+		       double *a, double *b)
+{
+	*a = ((double)(rng->max - rng->min)) /
+		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
+	*b = ((double)rng->min) / A4L_RNG_FACTOR;
+}
+
+/* dst = a * phys - b, one loop per sample width. */
+#define DEFINE_TORAW(type, sfx)						\
+static void sfx##toraw(void *dst, const type *src, int cnt,		\
+		       type a, type b, int size)			\
+{									\
+	uint32_t *d32 = dst;						\
+	uint16_t *d16 = dst;						\
+	uint8_t *d8 = dst;						\
+	int j;								\
+									\
+	switch (size) {							\
+	case 4:								\
+		for (j = 0; j < cnt; j++)				\
+			d32[j] = (lsampl_t)(a * src[j] - b);		\
+		break;							\
+	case 2:								\
+		for (j = 0; j < cnt; j++)				\
+			d16[j] = 0xffff & (lsampl_t)(a * src[j] - b);	\
+		break;							\
+	default:							\
+		for (j = 0; j < cnt; j++)				\
+			d8[j] = 0xff & (lsampl_t)(a * src[j] - b);	\
+	}								\
+}
+
+DEFINE_TORAW(float, f)
+DEFINE_TORAW(double, d)
+
 #endif /* !DOXYGEN_CPP */
 
 /*!
@@ -308,56 +354,27 @@ int a4l_rawtoul(a4l_chinfo_t * chan, unsigned long *dst, void *src, int cnt)
 int a4l_rawtof(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, float *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
-
-	/* Temporary values used for conversion
-	   (phys = a * src + b) */
-	float a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	float a[A4L_CONV_MAXLANES], b[A4L_CONV_MAXLANES];
+	int idx;
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
-	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	/* Get the suitable conversion kernel */
+	idx = a4l_conv_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
 	/* Compute the translation factor and the constant only once */
-	a = ((float)(rng->max - rng->min)) /
-		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
-	b = ((float)rng->min) / A4L_RNG_FACTOR;
-
-	while (j < cnt) {
+	a4l_rng_coeffs_f(chan, rng, a, b);
+	a4l_conv_fill_coeffs(a, 1);
+	a4l_conv_fill_coeffs(b, 1);
 
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
-
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
-
-		/* Update the counters */
-		i += size;
-		j++;
-	}
+	if (cnt > 0)
+		a4l_conv_get_kernels()->rawtof[idx](dst, src, cnt, a, b, 1);
 
-	return j;
+	return cnt < 0 ? 0 : cnt;
 }
 
 /**
@@ -381,58 +398,176 @@ int a4l_rawtof(a4l_chinfo_t * chan,
 int a4l_rawtod(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, double *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
-
-	/* Temporary values used for conversion
-	   (phys = a * src + b) */
-	double a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	double a[A4L_CONV_MAXLANES], b[A4L_CONV_MAXLANES];
+	int idx;
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
-	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	/* Get the suitable conversion kernel */
+	idx = a4l_conv_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
-	/* Computes the translation factor and the constant only once */
-	a = ((double)(rng->max - rng->min)) /
-		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
-	b = ((double)rng->min) / A4L_RNG_FACTOR;
+	/* Compute the translation factor and the constant only once */
+	a4l_rng_coeffs_d(chan, rng, a, b);
+	a4l_conv_fill_coeffs(a, 1);
+	a4l_conv_fill_coeffs(b, 1);
 
-	while (j < cnt) {
+	if (cnt > 0)
+		a4l_conv_get_kernels()->rawtod[idx](dst, src, cnt, a, b, 1);
 
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
+	return cnt < 0 ? 0 : cnt;
+}
 
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
+#ifndef DOXYGEN_CPP
 
-		/* Update the counters */
-		i += size;
-		j++;
+/*
+ * Check the scan layout, and return the kernel index of the common
+ * sample width, or A4L_CONV_MIXED if the channels have different
+ * widths.
+ */
+#define A4L_CONV_MIXED 3
+
+static int check_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		      int nb_chans, int *sizes)
+{
+	int n, idx = -1, ret;
+
+	if (chans == NULL || rngs == NULL ||
+	    nb_chans <= 0 || nb_chans > A4L_CONV_MAXCHANS)
+		return -EINVAL;
+
+	for (n = 0; n < nb_chans; n++) {
+		if (chans[n] == NULL || rngs[n] == NULL)
+			return -EINVAL;
+		sizes[n] = a4l_sizeof_chan(chans[n]);
+		ret = a4l_conv_index(sizes[n]);
+		if (ret < 0)
+			return -EINVAL;
+		if (idx < 0)
+			idx = ret;
+		else if (idx != ret)
+			idx = A4L_CONV_MIXED;
 	}
 
-	return j;
+	return idx;
 }
 
+#define DEFINE_SCAN_CONVERTER(type, sfx)				\
+int a4l_rawto##sfx##_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,	\
+			  int nb_chans, type *dst, void *src,		\
+			  int nb_scans)					\
+{									\
+	type a[A4L_CONV_MAXCHANS + A4L_CONV_MAXLANES - 1],		\
+		b[A4L_CONV_MAXCHANS + A4L_CONV_MAXLANES - 1];		\
+	int sizes[A4L_CONV_MAXCHANS], idx, n, s;			\
+	void *p = src;							\
+	lsampl_t tmp;							\
+									\
+	idx = check_scan(chans, rngs, nb_chans, sizes);			\
+	if (idx < 0)							\
+		return idx;						\
+									\
+	if (nb_scans <= 0)						\
+		return 0;						\
+									\
+	for (n = 0; n < nb_chans; n++)					\
+		a4l_rng_coeffs_##sfx(chans[n], rngs[n], a + n, b + n);	\
+									\
+	if (idx != A4L_CONV_MIXED) {					\
+		a4l_conv_fill_coeffs(a, nb_chans);			\
+		a4l_conv_fill_coeffs(b, nb_chans);			\
+		a4l_conv_get_kernels()->rawto##sfx[idx](dst, src,	\
+					nb_chans * nb_scans,		\
+					a, b, nb_chans);		\
+		return nb_chans * nb_scans;				\
+	}								\
+									\
+	/* Mixed sample widths, convert one sample at a time. */	\
+	for (s = 0; s < nb_scans; s++) {				\
+		for (n = 0; n < nb_chans; n++) {			\
+			switch (sizes[n]) {				\
+			case 4:						\
+				tmp = *(uint32_t *)p;			\
+				break;					\
+			case 2:						\
+				tmp = *(uint16_t *)p;			\
+				break;					\
+			default:					\
+				tmp = *(uint8_t *)p;			\
+			}						\
+			*dst++ = a[n] * tmp + b[n];			\
+			p += sizes[n];					\
+		}							\
+	}								\
+									\
+	return nb_chans * nb_scans;					\
+}
+
+#endif /* !DOXYGEN_CPP */
+
+/**
+ * @brief Convert interleaved multi-channel raw data to float-typed
+ * samples
+ *
+ * The input buffer holds @a nb_scans scans, each of them made of one
+ * sample per channel, in the order of the @a chans array, which is
+ * the layout of the data acquired by an asynchronous command. Each
+ * sample is converted according to the range of its channel. Scans
+ * of channels sharing the same sample width are converted in a
+ * single vectorized pass.
+ *
+ * @param[in] chans Array of channel descriptors, one per scan entry
+ * @param[in] rngs Array of range descriptors, one per scan entry
+ * @param[in] nb_chans Count of channels in a scan
+ * @param[out] dst Ouput buffer
+ * @param[in] src Input buffer
+ * @param[in] nb_scans Count of scans to convert
+ *
+ * @return the count of samples converted, otherwise a negative
+ * error code:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong;
+ *    chans, rngs and the pointers should be checked, nb_chans should
+ *    not exceed 256; WARNING: a4l_fill_desc() should be called before
+ *    using a4l_rawtof_scan()
+ *
+ */
+int a4l_rawtof_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nb_chans, float *dst, void *src, int nb_scans);
+
+/**
+ * @brief Convert interleaved multi-channel raw data to double-typed
+ * samples
+ *
+ * This is the double-typed variant of a4l_rawtof_scan().
+ *
+ * @param[in] chans Array of channel descriptors, one per scan entry
+ * @param[in] rngs Array of range descriptors, one per scan entry
+ * @param[in] nb_chans Count of channels in a scan
+ * @param[out] dst Ouput buffer
+ * @param[in] src Input buffer
+ * @param[in] nb_scans Count of scans to convert
+ *
+ * @return the count of samples converted, otherwise a negative
+ * error code:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong;
+ *    chans, rngs and the pointers should be checked, nb_chans should
+ *    not exceed 256; WARNING: a4l_fill_desc() should be called before
+ *    using a4l_rawtod_scan()
+ *
+ */
+int a4l_rawtod_scan(a4l_chinfo_t **chans, a4l_rnginfo_t **rngs,
+		    int nb_chans, double *dst, void *src, int nb_scans);
+
+#ifndef DOXYGEN_CPP
+DEFINE_SCAN_CONVERTER(float, f)
+DEFINE_SCAN_CONVERTER(double, d)
+#endif /* !DOXYGEN_CPP */
+
 /**
  * @brief Pack unsigned long values into raw data (for the driver)
  *
@@ -517,13 +652,11 @@ int a4l_ultoraw(a4l_chinfo_t * chan, void *dst, unsigned long *src, int cnt)
 int a4l_ftoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, float *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	float a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -531,21 +664,8 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (a4l_conv_index(size) < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((float)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -553,17 +673,12 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 	b = ((float)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
+	if (cnt <= 0)
+		return 0;
 
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
+	ftoraw(dst, src, cnt, a, b, size);
 
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt;
 }
 
 /**
@@ -587,13 +702,11 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 int a4l_dtoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, double *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	double a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -601,21 +714,8 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (a4l_conv_index(size) < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((double)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -623,16 +723,11 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 	b = ((double)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
+	if (cnt <= 0)
+		return 0;
 
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
+	dtoraw(dst, src, cnt, a, b, size);
 
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt;
 }
 /** @} Range / conversion  API */
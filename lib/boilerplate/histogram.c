@@ -0,0 +1,162 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "boilerplate/histogram.h"
+
+int histogram_init(struct histogram *h,
+		   uint64_t max_value, unsigned int precision)
+{
+	if (precision < 2 || precision > 16)
+		return -EINVAL;
+
+	memset(h, 0, sizeof(*h));
+	h->sub_bits = precision;
+	h->nr_cells = __histogram_index(h, max_value) + 1;
+	h->pos_cells = calloc(h->nr_cells * 2, sizeof(uint64_t));
+	if (h->pos_cells == NULL) {
+		h->nr_cells = 0;
+		return -ENOMEM;
+	}
+
+	h->neg_cells = h->pos_cells + h->nr_cells;
+
+	return 0;
+}
+
+void histogram_destroy(struct histogram *h)
+{
+	free(h->pos_cells);
+	h->pos_cells = h->neg_cells = NULL;
+}
+
+void histogram_reset(struct histogram *h)
+{
+	memset(h->pos_cells, 0, h->nr_cells * 2 * sizeof(uint64_t));
+	h->count = h->overflows = 0;
+	h->min = h->max = 0;
+	h->sum = h->sumsq = 0.0;
+}
+
+int histogram_merge(struct histogram *dst,
+		    const struct histogram *src)
+{
+	unsigned int n;
+
+	if (dst->sub_bits != src->sub_bits ||
+	    dst->nr_cells != src->nr_cells)
+		return -EINVAL;
+
+	if (src->count == 0)
+		return 0;
+
+	for (n = 0; n < src->nr_cells * 2; n++)
+		dst->pos_cells[n] += src->pos_cells[n];
+
+	if (dst->count == 0 || src->min < dst->min)
+		dst->min = src->min;
+	if (dst->count == 0 || src->max > dst->max)
+		dst->max = src->max;
+
+	dst->count += src->count;
+	dst->overflows += src->overflows;
+	dst->sum += src->sum;
+	dst->sumsq += src->sumsq;
+
+	return 0;
+}
+
+/* Lowest magnitude which maps to cell @idx. */
+static uint64_t cell_base(const struct histogram *h, unsigned int idx)
+{
+	unsigned int half = 1U << (h->sub_bits - 1), e;
+
+	if (idx < (1U << h->sub_bits))
+		return idx;
+
+	e = idx / half - 1;
+
+	return (uint64_t)(idx - e * half) << e;
+}
+
+/*
+ * Return the highest value equivalent to the sample of rank
+ * ceil(pct% * count), i.e. the upper bound of the cell it was
+ * recorded into, clamped to the actual min/max values observed.
+ */
+int64_t histogram_percentile(const struct histogram *h, double pct)
+{
+	uint64_t rank, seen = 0;
+	double r;
+	int64_t v;
+	int n;
+
+	if (h->count == 0)
+		return 0;
+
+	if (pct >= 100.0)
+		return h->max;
+
+	r = pct / 100.0 * h->count;
+	rank = (uint64_t)r;
+	if (rank < r || rank == 0)
+		rank++;
+
+	for (n = h->nr_cells - 1; n >= 0; n--) {
+		seen += h->neg_cells[n];
+		if (seen >= rank) {
+			v = -(int64_t)cell_base(h, n);
+			goto done;
+		}
+	}
+
+	for (n = 0; n < h->nr_cells; n++) {
+		seen += h->pos_cells[n];
+		if (seen >= rank) {
+			v = (int64_t)cell_base(h, n + 1) - 1;
+			goto done;
+		}
+	}
+
+	return h->max;
+done:
+	if (v < h->min)
+		return h->min;
+	if (v > h->max)
+		return h->max;
+
+	return v;
+}
+
+double histogram_mean(const struct histogram *h)
+{
+	return h->count ? h->sum / h->count : 0.0;
+}
+
+double histogram_stddev(const struct histogram *h)
+{
+	double mean, var;
+
+	if (h->count < 2)
+		return 0.0;
+
+	mean = h->sum / h->count;
+	var = (h->sumsq - mean * h->sum) / (h->count - 1);
+
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
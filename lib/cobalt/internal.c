@@ -534,6 +534,13 @@ int cobalt_xlate_schedparam(int policy,
 	case SCHED_WEAK:
 		std_policy = priority ? SCHED_FIFO : SCHED_OTHER;
 		break;
+#ifdef SCHED_EDF
+	case SCHED_EDF:
+		/* Deadline-driven: run right above the regular tasks. */
+		std_policy = SCHED_FIFO;
+		priority = 1;
+		break;
+#endif
 	default:
 		std_policy = SCHED_FIFO;
 		/* falldown wanted. */
@@ -0,0 +1,110 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <rtdm/ipc.h>
+#include "internal.h"
+
+struct bufp_ring *bufp_ring_map(int s)
+{
+	long pagesz = sysconf(_SC_PAGESIZE);
+	struct bufp_ring *ring;
+	size_t len;
+
+	/* Map the header first to learn the size of the data area. */
+	ring = __RT(mmap(NULL, pagesz, PROT_READ, MAP_SHARED, s, 0));
+	if (ring == MAP_FAILED)
+		return NULL;
+
+	len = ring->data_offset + ring->size;
+	munmap(ring, pagesz);
+
+	ring = __RT(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, s, 0));
+
+	return ring == MAP_FAILED ? NULL : ring;
+}
+
+void bufp_ring_unmap(struct bufp_ring *ring)
+{
+	munmap(ring, ring->data_offset + ring->size);
+}
+
+ssize_t bufp_ring_write(struct bufp_ring *ring, int s,
+			const void *buf, size_t len, int flags)
+{
+	volatile struct bufp_ring *r = ring;
+	char *data = (char *)ring + ring->data_offset;
+	__u32 head, off, n, wlen = len;
+
+	if (len > ring->size)
+		return -EINVAL;
+
+	head = r->head;
+	while (ring->size - (head - r->tail) < wlen) {
+		if (flags & MSG_DONTWAIT)
+			return -EWOULDBLOCK;
+		if (__RT(ioctl(s, BUFP_RTIOC_WAITSPACE, &wlen)))
+			return -errno;
+	}
+
+	off = head & (ring->size - 1);
+	n = ring->size - off < wlen ? ring->size - off : wlen;
+	memcpy(data + off, buf, n);
+	memcpy(data, (const char *)buf + n, wlen - n);
+	__sync_synchronize();
+	r->head = head + wlen;
+	__sync_synchronize();
+	if (r->rd_waiting && __RT(ioctl(s, BUFP_RTIOC_KICK)))
+		return -errno;
+
+	return len;
+}
+
+ssize_t bufp_ring_read(struct bufp_ring *ring, int s,
+		       void *buf, size_t len, int flags)
+{
+	volatile struct bufp_ring *r = ring;
+	char *data = (char *)ring + ring->data_offset;
+	__u32 tail, off, n, rlen = len;
+
+	if (len > ring->size)
+		return -EINVAL;
+
+	tail = r->tail;
+	while (r->head - tail < rlen) {
+		if (flags & MSG_DONTWAIT)
+			return -EWOULDBLOCK;
+		if (__RT(ioctl(s, BUFP_RTIOC_WAITDATA, &rlen)))
+			return -errno;
+	}
+
+	__sync_synchronize();
+	off = tail & (ring->size - 1);
+	n = ring->size - off < rlen ? ring->size - off : rlen;
+	memcpy(buf, data + off, n);
+	memcpy((char *)buf + n, data, rlen - n);
+	__sync_synchronize();
+	r->tail = tail + rlen;
+	__sync_synchronize();
+	if (r->wr_waiting && __RT(ioctl(s, BUFP_RTIOC_KICK)))
+		return -errno;
+
+	return len;
+}
@@ -258,8 +258,8 @@ COBALT_IMPL(int, sched_setscheduler, (pid_t pid, int policy,
  * assumed.
  *
  * @param policy scheduling policy, one of SCHED_WEAK, SCHED_FIFO,
- * SCHED_COBALT, SCHED_RR, SCHED_SPORADIC, SCHED_TP, SCHED_QUOTA or
- * SCHED_NORMAL;
+ * SCHED_COBALT, SCHED_RR, SCHED_SPORADIC, SCHED_TP, SCHED_QUOTA,
+ * SCHED_EDF or SCHED_NORMAL;
  *
  * @param param_ex address of scheduling parameters. As a special
  * exception, a negative sched_priority value is interpreted as if
@@ -270,6 +270,13 @@ COBALT_IMPL(int, sched_setscheduler, (pid_t pid, int policy,
  * priority levels in the [0..99] range (inclusive). Otherwise,
  * sched_priority must be zero for the SCHED_WEAK policy.
  *
+ * SCHED_EDF threads are scheduled by earliest absolute deadline,
+ * with CPU bandwidth reserved from param_ex->sched_edf_runtime,
+ * param_ex->sched_edf_deadline (relative, defaults to the period
+ * if zero) and param_ex->sched_edf_period; sched_priority must be
+ * zero. The thread is throttled until its next period once it has
+ * consumed its runtime.
+ *
  * @return 0 on success;
  * @return an error number if:
  * - ESRCH, @a pid is not found;
@@ -278,6 +285,8 @@ COBALT_IMPL(int, sched_setscheduler, (pid_t pid, int policy,
  * - EAGAIN, insufficient memory available from the system heap,
  *   increase CONFIG_XENO_OPT_SYS_HEAPSZ;
  * - EFAULT, @a param_ex is an invalid address;
+ * - EBUSY, with @a policy equal to SCHED_EDF, if admitting the
+ *   thread would exceed the bandwidth available on its CPU;
  *
  * @note
  *
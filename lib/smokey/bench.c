@@ -0,0 +1,503 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <boilerplate/ancillaries.h>
+#include <boilerplate/time.h>
+#include <xenomai/init.h>
+#include <smokey/smokey.h>
+
+/**
+ * @ingroup smokey
+ *
+ * @par Benchmarking with Smokey
+ *
+ * When --bench is passed on the command line, @a smokey_bench_mode
+ * is set, which tells the test plugins supporting it to time some
+ * of their critical operations in addition to running the
+ * functional checks. The simplest form is:
+ *
+ * @code
+ * static int do_lock_unlock(void *arg)
+ * {
+ *	pthread_mutex_t *mutex = arg;
+ *	int ret;
+ *
+ *	ret = pthread_mutex_lock(mutex);
+ *	if (ret)
+ *		return -ret;
+ *
+ *	return -pthread_mutex_unlock(mutex);
+ * }
+ *
+ *	if (smokey_bench_mode) {
+ *		ret = smokey_bench_run(t, "lock_unlock",
+ *				       do_lock_unlock, &mutex);
+ *		...
+ *	}
+ * @endcode
+ *
+ * smokey_bench_run() calls the operation @a smokey_bench_warmup
+ * times untimed, then @a smokey_bench_iterations times, measuring
+ * each call individually. Operations which cannot be expressed as a
+ * single call (e.g. a round-trip between two threads) may be timed
+ * manually by bracketing each sample with smokey_bench_start() and
+ * smokey_bench_stop(), between smokey_bench_init() and
+ * smokey_bench_report().
+ *
+ * smokey_bench_send_recv() is a ready-made operation for the socket
+ * protocols, which sends then receives a short message through a
+ * datagram socket connected to itself.
+ *
+ * The report is printed to stdout regardless of the verbosity
+ * level. It gives the throughput figure (ops/s), the mean, standard
+ * deviation and a few percentiles of the sample distribution. The
+ * cost of reading the clock is measured once, then deducted from
+ * every sample.
+ *
+ * Figures which are not timings, such as the memory footprint of a
+ * workload, may be reported with smokey_bench_metric(). They are
+ * saved to and compared with the baseline the same way, assuming
+ * that lower is better.
+ *
+ * The posix_mutex, posix_cond, bufp and iddp tests support this
+ * mode. xddp does not, since every transfer involves a regular Linux
+ * endpoint, so that timing it would mostly measure the mode switches
+ * of the calling thread.
+ *
+ * The following options are recognized:
+ *
+ * - --bench[=<iterations>] enables the benchmark mode, optionally
+ *   setting the number of timed iterations (defaults to 10000).
+ *
+ * - --warmup=<iterations> sets the number of untimed iterations run
+ *   before sampling (defaults to 10% of the timed iterations).
+ *
+ * - --save-baseline=<file> writes the results to @a file, one line
+ *   per benchmark, which may be passed later to --baseline.
+ *
+ * - --baseline=<file> compares the results with the figures read
+ *   from @a file. A benchmark which mean time, or metric value,
+ *   exceeds its baseline by more than the tolerance threshold fails
+ *   with -ERANGE.
+ *
+ * - --tolerance=<percent> sets the regression threshold (defaults to
+ *   10%).
+ */
+
+int smokey_bench_mode;
+
+int smokey_bench_iterations = 10000;
+
+int smokey_bench_warmup = -1;
+
+#define BENCH_MAX_NS  ONE_BILLION
+
+#define BENCH_PRECISION  8
+
+struct baseline_entry {
+	char *name;
+	double mean_ns;		/* or metric value */
+	long long p99_ns;	/* -1 for metrics */
+};
+
+static struct baseline_entry *baseline;
+
+static int baseline_count;
+
+static char *baseline_path;
+
+static char *save_path;
+
+static FILE *save_fp;
+
+static int tolerance = 10;
+
+static long clock_overhead;
+
+static const struct option bench_options[] = {
+	{
+#define bench_opt		0
+		.name = "bench",
+		.has_arg = optional_argument,
+		.flag = &smokey_bench_mode,
+		.val = 1,
+	},
+	{
+#define warmup_opt		1
+		.name = "warmup",
+		.has_arg = required_argument,
+	},
+	{
+#define baseline_opt		2
+		.name = "baseline",
+		.has_arg = required_argument,
+	},
+	{
+#define save_baseline_opt	3
+		.name = "save-baseline",
+		.has_arg = required_argument,
+	},
+	{
+#define tolerance_opt		4
+		.name = "tolerance",
+		.has_arg = required_argument,
+	},
+	{ /* Sentinel */ }
+};
+
+static inline long long diff_ts(const struct timespec *left,
+				const struct timespec *right)
+{
+	return (long long)(left->tv_sec - right->tv_sec) * ONE_BILLION
+		+ left->tv_nsec - right->tv_nsec;
+}
+
+static void calibrate_clock(void)
+{
+	struct timespec t0, t1;
+	long long delta, min = -1;
+	int n;
+
+	for (n = 0; n < 1000; n++) {
+		__RT(clock_gettime(CLOCK_MONOTONIC, &t0));
+		__RT(clock_gettime(CLOCK_MONOTONIC, &t1));
+		delta = diff_ts(&t1, &t0);
+		if (min < 0 || delta < min)
+			min = delta;
+	}
+
+	clock_overhead = (long)min;
+}
+
+static struct baseline_entry *lookup_baseline(const char *name)
+{
+	int n;
+
+	for (n = 0; n < baseline_count; n++)
+		if (strcmp(baseline[n].name, name) == 0)
+			return baseline + n;
+
+	return NULL;
+}
+
+static int load_baseline(const char *path)
+{
+	struct baseline_entry *e;
+	char *line = NULL, *name;
+	long long p99_ns;
+	size_t len = 0;
+	double mean_ns;
+	int lineno = 0, n;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		warning("cannot open baseline file %s: %s",
+			path, strerror(errno));
+		return -errno;
+	}
+
+	while (getline(&line, &len, fp) != -1) {
+		lineno++;
+		if (*line == '#' || *line == '\n')
+			continue;
+		p99_ns = -1;
+		n = sscanf(line, "%ms %lf %lld", &name, &mean_ns, &p99_ns);
+		if (n < 2) {
+			if (n == 1)
+				free(name);
+			warning("%s:%d: malformed baseline entry",
+				path, lineno);
+			continue;
+		}
+		e = realloc(baseline, sizeof(*e) * (baseline_count + 1));
+		if (e == NULL) {
+			free(name);
+			break;
+		}
+		baseline = e;
+		e += baseline_count++;
+		e->name = name;
+		e->mean_ns = mean_ns;
+		e->p99_ns = p99_ns;
+	}
+
+	free(line);
+	fclose(fp);
+
+	return 0;
+}
+
+int smokey_bench_init(struct smokey_bench *b,
+		      struct smokey_test *t, const char *name)
+{
+	int ret;
+
+	ret = histogram_init(&b->hist, BENCH_MAX_NS, BENCH_PRECISION);
+	if (ret)
+		return ret;
+
+	b->test = t;
+	b->name = name;
+
+	return 0;
+}
+
+void smokey_bench_start(struct smokey_bench *b)
+{
+	__RT(clock_gettime(CLOCK_MONOTONIC, &b->start));
+}
+
+void smokey_bench_stop(struct smokey_bench *b)
+{
+	struct timespec now;
+	long long delta;
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &now));
+	delta = diff_ts(&now, &b->start) - clock_overhead;
+	histogram_add(&b->hist, delta < 0 ? 0 : delta);
+}
+
+int smokey_bench_report(struct smokey_bench *b)
+{
+	struct histogram *h = &b->hist;
+	struct baseline_entry *e;
+	double mean, drift;
+	long long p99;
+	char key[128];
+	int ret = 0;
+
+	snprintf(key, sizeof(key), "%s.%s", b->test->name, b->name);
+
+	if (h->count == 0) {
+		smokey_warning("%s: no sample collected", key);
+		ret = -ENODATA;
+		goto out;
+	}
+
+	mean = histogram_mean(h);
+	p99 = histogram_percentile(h, 99.0);
+
+	/* Results are what --bench was asked for, not verbose output. */
+	__RT(fprintf(stdout, "%s: %llu iterations, %.0f ops/s, mean %.1f ns, "
+		     "stddev %.1f ns\n", key, (unsigned long long)h->count,
+		     mean > 0 ? 1e9 / mean : 0.0, mean,
+		     histogram_stddev(h)));
+	__RT(fprintf(stdout, "%s: min %lld, p50 %lld, p90 %lld, p99 %lld, "
+		     "p99.9 %lld, max %lld (ns)\n", key,
+		     (long long)h->min,
+		     (long long)histogram_percentile(h, 50.0),
+		     (long long)histogram_percentile(h, 90.0),
+		     p99,
+		     (long long)histogram_percentile(h, 99.9),
+		     (long long)h->max));
+
+	if (save_fp) {
+		fprintf(save_fp, "%s %.1f %lld\n", key, mean, p99);
+		fflush(save_fp);
+	}
+
+	e = lookup_baseline(key);
+	if (e == NULL || e->p99_ns < 0 || e->mean_ns <= 0)
+		goto out;
+
+	drift = (mean - e->mean_ns) * 100.0 / e->mean_ns;
+	__RT(fprintf(stdout, "%s: baseline mean %.1f ns, p99 %lld ns, "
+		     "drift %+.1f%%\n", key, e->mean_ns, e->p99_ns, drift));
+	if (drift > tolerance) {
+		smokey_warning("%s: performance regression (%+.1f%% > %d%%)",
+			       key, drift, tolerance);
+		ret = -ERANGE;
+	}
+out:
+	histogram_destroy(h);
+
+	return ret;
+}
+
+int smokey_bench_metric(struct smokey_test *t, const char *name,
+			double value, const char *unit)
+{
+	struct baseline_entry *e;
+	char key[128];
+	double limit;
+
+	snprintf(key, sizeof(key), "%s.%s", t->name, name);
+
+	__RT(fprintf(stdout, "%s: %.1f %s\n", key, value, unit));
+
+	if (save_fp) {
+		fprintf(save_fp, "%s %.1f\n", key, value);
+		fflush(save_fp);
+	}
+
+	e = lookup_baseline(key);
+	if (e == NULL || e->p99_ns >= 0)
+		return 0;
+
+	__RT(fprintf(stdout, "%s: baseline %.1f %s\n", key, e->mean_ns, unit));
+
+	/* Allow for the rounding of the saved value. */
+	limit = e->mean_ns + e->mean_ns * tolerance / 100.0 + 0.05;
+	if (value > limit) {
+		smokey_warning("%s: regression (%.1f > %.1f %s)",
+			       key, value, limit, unit);
+		return -ERANGE;
+	}
+
+	return 0;
+}
+
+int smokey_bench_run(struct smokey_test *t, const char *name,
+		     int (*op)(void *arg), void *arg)
+{
+	struct smokey_bench b;
+	int ret, n;
+
+	for (n = 0; n < smokey_bench_warmup; n++) {
+		ret = op(arg);
+		if (ret)
+			return ret;
+	}
+
+	ret = smokey_bench_init(&b, t, name);
+	if (ret)
+		return ret;
+
+	for (n = 0; n < smokey_bench_iterations; n++) {
+		smokey_bench_start(&b);
+		ret = op(arg);
+		smokey_bench_stop(&b);
+		if (ret) {
+			histogram_destroy(&b.hist);
+			return ret;
+		}
+	}
+
+	return smokey_bench_report(&b);
+}
+
+#define BENCH_MSGSZ  64
+
+int smokey_bench_send_recv(void *arg)
+{
+	char buf[BENCH_MSGSZ];
+	int s = *(int *)arg, ret;
+
+	memset(buf, 0xa5, sizeof(buf));
+	ret = __RT(send(s, buf, sizeof(buf), MSG_DONTWAIT));
+	if (ret != sizeof(buf))
+		return ret < 0 ? -errno : -EIO;
+
+	ret = __RT(recv(s, buf, sizeof(buf), MSG_DONTWAIT));
+	if (ret != sizeof(buf))
+		return ret < 0 ? -errno : -EIO;
+
+	return 0;
+}
+
+static int bench_parse_option(int optnum, const char *optarg)
+{
+	switch (optnum) {
+	case bench_opt:
+		if (optarg)
+			smokey_bench_iterations = atoi(optarg);
+		break;
+	case warmup_opt:
+		smokey_bench_warmup = atoi(optarg);
+		break;
+	case baseline_opt:
+		baseline_path = strdup(optarg);
+		break;
+	case save_baseline_opt:
+		save_path = strdup(optarg);
+		break;
+	case tolerance_opt:
+		tolerance = atoi(optarg);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void bench_help(void)
+{
+	fprintf(stderr, "--bench[=<iterations>]		run benchmarks [# of timed iterations]\n");
+	fprintf(stderr, "--warmup=<iterations>		# of untimed iterations before sampling\n");
+	fprintf(stderr, "--baseline=<file>		compare benchmark results with baseline\n");
+	fprintf(stderr, "--save-baseline=<file>		save benchmark results to file\n");
+	fprintf(stderr, "--tolerance=<percent>		max. drift from baseline (default 10%%)\n");
+	fprintf(stderr, "	(benchmarks: posix_mutex, posix_cond, bufp, iddp; not xddp)\n");
+}
+
+static int bench_init(void)
+{
+	int ret;
+
+	if (!smokey_bench_mode)
+		return 0;
+
+	if (smokey_bench_iterations <= 0) {
+		warning("invalid iteration count");
+		return -EINVAL;
+	}
+
+	if (smokey_bench_warmup < 0)
+		smokey_bench_warmup = smokey_bench_iterations / 10;
+
+	if (baseline_path) {
+		ret = load_baseline(baseline_path);
+		free(baseline_path);
+		if (ret)
+			return ret;
+	}
+
+	if (save_path) {
+		save_fp = fopen(save_path, "w");
+		if (save_fp == NULL) {
+			ret = -errno;
+			warning("cannot create baseline file %s: %s",
+				save_path, strerror(errno));
+			free(save_path);
+			return ret;
+		}
+		fprintf(save_fp, "# <test.bench> <mean_ns> <p99_ns>\n"
+			"# <test.metric> <value>\n");
+		free(save_path);
+	}
+
+	calibrate_clock();
+
+	return 0;
+}
+
+static struct setup_descriptor bench_interface = {
+	.name = "smokey-bench",
+	.init = bench_init,
+	.options = bench_options,
+	.parse_option = bench_parse_option,
+	.help = bench_help,
+};
+
+post_setup_call(bench_interface);
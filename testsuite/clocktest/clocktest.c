@@ -29,6 +29,7 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
+#include <sys/utsname.h>
 #include <boilerplate/atomic.h>
 #include <cobalt/uapi/kernel/vdso.h>
 #include <xeno_config.h>
@@ -54,6 +55,7 @@ pthread_mutex_t lock;
 
 uint64_t last_common = 0;
 clockid_t clock_id = CLOCK_REALTIME;
+volatile sig_atomic_t done = 0;
 
 struct per_cpu_data {
 	uint64_t first_tod, first_clock;
@@ -221,7 +223,56 @@ static void *cpu_thread(void *arg)
 
 static void sighand(int signal)
 {
-	exit(0);
+	done = 1;
+}
+
+static void dump_json(const char *path, const char *clock_name,
+		      int cpus, time_t duration)
+{
+	struct utsname un;
+	FILE *fp;
+	int i;
+
+	if (strcmp(path, "-") == 0)
+		fp = stdout;
+	else {
+		fp = fopen(path, "w");
+		if (fp == NULL) {
+			fprintf(stderr, "clocktest: cannot open %s: %m\n", path);
+			return;
+		}
+	}
+
+	if (uname(&un))
+		memset(&un, 0, sizeof(un));
+
+	fprintf(fp, "{\n"
+		"  \"test\": \"clocktest\",\n"
+		"  \"version\": \"%s\",\n"
+		"  \"kernel\": \"%s\",\n"
+		"  \"machine\": \"%s\",\n"
+		"  \"clock\": \"%s\",\n"
+		"  \"clock_id\": %d,\n"
+		"  \"duration_s\": %ld,\n"
+		"  \"cpus\": [\n",
+		CONFIG_XENO_VERSION_STRING, un.release, un.machine,
+		clock_name, clock_id, (long)duration);
+
+	for (i = 0; i < cpus; i++)
+		fprintf(fp, "    { \"cpu\": %d, \"tod_offset_ns\": %lld, "
+			"\"tod_drift_ppm\": %.3f, \"warps\": %lu, "
+			"\"max_warp_ns\": %llu }%s\n",
+			i,
+			(long long)per_cpu_data[i].offset,
+			per_cpu_data[i].drift * 1000000.0,
+			per_cpu_data[i].warps,
+			(unsigned long long)per_cpu_data[i].max_warp,
+			i < cpus - 1 ? "," : "");
+
+	fprintf(fp, "  ]\n}\n");
+
+	if (fp != stdout)
+		fclose(fp);
 }
 
 static clockid_t resolve_clock_name(const char *name,
@@ -299,12 +350,14 @@ int main(int argc, char *argv[])
 {
 	const char *clock_name = NULL, *real_clock_name = "CLOCK_REALTIME";
 	int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *json = NULL;
+	time_t start;
 	int i;
 	int c;
 	int d = 0;
 	int ext = 0;
 
-	while ((c = getopt(argc, argv, "C:ET:D")) != EOF)
+	while ((c = getopt(argc, argv, "C:ET:DJ:")) != EOF)
 		switch (c) {
 		case 'C':
 			clock_name = optarg;
@@ -322,12 +375,17 @@ int main(int argc, char *argv[])
 			d = 1;
 			break;
 
+		case 'J':
+			json = optarg;
+			break;
+
 		default:
 			fprintf(stderr, "usage: clocktest [options]\n"
 				"  [-C <clock_id|clock_name>]   # tested clock, defaults to CLOCK_REALTIME\n"
 				"  [-E]                         # -C specifies extension clock\n"
 				"  [-T <test_duration_seconds>] # default=0, so ^C to end\n"
-				"  [-D]                         # print extra diagnostics for CLOCK_HOST_REALTIME\n");
+				"  [-D]                         # print extra diagnostics for CLOCK_HOST_REALTIME\n"
+				"  [-J <file>]                  # dump final results to <file> in JSON format\n");
 			exit(2);
 		}
 
@@ -335,6 +393,8 @@ int main(int argc, char *argv[])
 		clock_id = resolve_clock_name(clock_name, &real_clock_name, ext);
 
 	signal(SIGALRM, sighand);
+	signal(SIGINT, sighand);
+	signal(SIGTERM, sighand);
 
 	init_lock(&lock);
 
@@ -358,7 +418,9 @@ int main(int argc, char *argv[])
 	printf("CPU      ToD offset [us] ToD drift [us/s]      warps max delta [us]\n"
 	       "--- -------------------- ---------------- ---------- --------------\n");
 
-	while (1) {
+	time(&start);
+
+	while (!done) {
 		for (i = 0; i < cpus; i++)
 			printf("%3d %20.1f %16.3f %10lu %14.1f\n",
 			       i,
@@ -367,6 +429,12 @@ int main(int argc, char *argv[])
 			       per_cpu_data[i].warps,
 			       per_cpu_data[i].max_warp/1000.0);
 		usleep(250000);
-		printf("\033[%dA", cpus);
+		if (!done)
+			printf("\033[%dA", cpus);
 	}
+
+	if (json)
+		dump_json(json, real_clock_name, cpus, time(NULL) - start);
+
+	exit(0);
 }
@@ -24,6 +24,7 @@
 #include <error.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <smokey/smokey.h>
@@ -34,11 +35,13 @@ smokey_test_plugin(interrupt,
 			   SMOKEY_STRING(device),
 			   SMOKEY_STRING(trigger),
 			   SMOKEY_BOOL(select),
+			   SMOKEY_INT(events),
 		   ),
    "Wait for interrupts from a GPIO pin.\n"
    "\tdevice=<device-path>\n"
    "\trigger={edge[-rising/falling/both], level[-low/high]}\n"
-   "\tselect, wait on select(2)."
+   "\tselect, wait on select(2).\n"
+   "\tevents=<depth>, read timestamped events from a ring."
 );
 
 smokey_test_plugin(read_value,
@@ -57,6 +60,16 @@ smokey_test_plugin(write_value,
    "\tdevice=<device-path>."
 );
 
+smokey_test_plugin(read_bank,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_STRING(device),
+			   SMOKEY_INT(offset),
+		   ),
+   "Read the values of 32 consecutive GPIO pins at once.\n"
+   "\tdevice=<bank-device-path>\n"
+   "\toffset=<first-pin>."
+);
+
 static int run_interrupt(struct smokey_test *t, int argc, char *const argv[])
 {
 	static struct {
@@ -72,8 +85,10 @@ static int run_interrupt(struct smokey_test *t, int argc, char *const argv[])
 		{ .name = "level-high", .flag = GPIO_TRIGGER_LEVEL_HIGH },
 		{ NULL, 0 },
 	};
-	int do_select = 0, fd, ret, trigger, n, value;
+	int do_select = 0, fd, ret, trigger, n, value, depth = 0;
+	struct rtdm_gpio_event events[16];
 	const char *device = NULL, *trigname;
+	struct rtdm_gpio_evstat stat;
 	fd_set set;
 	
 	smokey_parse_args(t, argc, argv);
@@ -110,6 +125,17 @@ static int run_interrupt(struct smokey_test *t, int argc, char *const argv[])
 		}
 	}
 
+	if (SMOKEY_ARG_ISSET(interrupt, events)) {
+		depth = SMOKEY_ARG_INT(interrupt, events);
+		ret = ioctl(fd, GPIO_RTIOC_EVENTS, &depth);
+		if (ret) {
+			ret = -errno;
+			warning("GPIO_RTIOC_EVENTS failed on %s [%s]",
+				device, symerror(ret));
+			return ret;
+		}
+	}
+
 	ret = ioctl(fd, GPIO_RTIOC_IRQEN, &trigger);
 	if (ret) {
 		ret = -errno;
@@ -131,6 +157,24 @@ static int run_interrupt(struct smokey_test *t, int argc, char *const argv[])
 				return ret;
 			}
 		}
+		if (depth > 0) {
+			ret = read(fd, events, sizeof(events));
+			if (ret < 0) {
+				ret = -errno;
+				warning("failed reading from %s [%s]",
+					device, symerror(ret));
+				return ret;
+			}
+			for (n = 0; n < ret / (int)sizeof(events[0]); n++)
+				printf("irq #%u at %llu ns, GPIO state=%d\n",
+				       events[n].seq,
+				       (unsigned long long)events[n].timestamp,
+				       events[n].value);
+			if (ioctl(fd, GPIO_RTIOC_EVSTAT, &stat) == 0 &&
+			    stat.overruns)
+				printf("%u events lost\n", stat.overruns);
+			continue;
+		}
 		ret = read(fd, &value, sizeof(value));
 		if (ret < 0) {
 			ret = -errno;
@@ -215,6 +259,50 @@ static int run_write_value(struct smokey_test *t, int argc, char *const argv[])
 	return 0;
 }
 
+static int run_read_bank(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct rtdm_gpio_bank bank;
+	const char *device = NULL;
+	int fd, ret;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (!SMOKEY_ARG_ISSET(read_bank, device)) {
+		warning("missing device= specification");
+		return -EINVAL;
+	}
+
+	device = SMOKEY_ARG_STRING(read_bank, device);
+	fd = open(device, O_RDONLY);
+	if (fd < 0) {
+		ret = -errno;
+		warning("cannot open device %s [%s]",
+			device, symerror(ret));
+		return ret;
+	}
+
+	memset(&bank, 0, sizeof(bank));
+	if (SMOKEY_ARG_ISSET(read_bank, offset))
+		bank.offset = SMOKEY_ARG_INT(read_bank, offset);
+	bank.mask = 0xffffffffULL;
+
+	ret = ioctl(fd, GPIO_RTIOC_BANK_GET, &bank);
+	if (ret)
+		ret = -errno;
+	close(fd);
+
+	if (ret) {
+		warning("GPIO_RTIOC_BANK_GET failed on %s [%s]",
+			device, symerror(ret));
+		return ret;
+	}
+
+	smokey_trace("pins %u-%u: 0x%08llx", bank.offset, bank.offset + 31,
+		     (unsigned long long)bank.bits);
+
+	return 0;
+}
+
 int main(int argc, char *const argv[])
 {
 	struct smokey_test *t;
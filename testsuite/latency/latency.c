@@ -35,9 +35,11 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <sys/timerfd.h>
+#include <sys/utsname.h>
 #include <xeno_config.h>
 #include <rtdm/testing.h>
 #include <boilerplate/trace.h>
+#include <boilerplate/histogram.h>
 #include <xenomai/init.h>
 
 pthread_t latency_task, display_task;
@@ -62,6 +64,7 @@ int quiet = 0;			/* suppress printing of RTH, RTD lines when -T given */
 int benchdev = -1;
 int freeze_max = 0;
 int priority = HIPRIO;
+int cpu = 0;
 int stop_upon_switch = 0;
 sig_atomic_t sampling_relaxed = 0;
 char sem_name[16];
@@ -86,11 +89,21 @@ int test_loops = 0;		/* outer loop count */
 int histogram_size = HISTOGRAM_CELLS;
 int32_t *histogram_avg = NULL, *histogram_max = NULL, *histogram_min = NULL;
 
-char *do_gnuplot = NULL;
+char *do_gnuplot = NULL, *do_json = NULL;
 int do_histogram = 0, do_stats = 0, finished = 0;
 int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
+/*
+ * Log-linear histogram of individual samples, from which latency
+ * percentiles are computed for the JSON report. 1s max, with a
+ * relative precision better than 1%.
+ */
+#define PERCENTILE_MAX		ONE_BILLION
+#define PERCENTILE_PRECISION	8
+struct histogram sample_histogram;
+
 #define need_histo() (do_histogram || do_stats || do_gnuplot)
+#define need_samples() (need_histo() || do_json)
 
 static inline void add_histogram(int32_t *histogram, int32_t addval)
 {
@@ -198,6 +211,9 @@ static void *latency(void *cookie)
 
 			if (!(finished || warmup) && need_histo())
 				add_histogram(histogram_avg, dt);
+
+			if (!(finished || warmup) && do_json)
+				histogram_add(&sample_histogram, dt);
 		}
 
 		if (!warmup) {
@@ -257,7 +273,7 @@ static void *display(void *cookie)
 		config.period = period_ns;
 		config.priority = priority;
 		config.warmup_loops = WARMUP_TIME;
-		config.histogram_size = need_histo() ? histogram_size : 0;
+		config.histogram_size = need_samples() ? histogram_size : 0;
 		config.histogram_bucketsize = bucketsize;
 		config.freeze_max = freeze_max;
 
@@ -477,6 +493,90 @@ static void dump_hist_stats(time_t duration)
 		dump_histo_gnuplot(histogram_avg, duration);
 }
 
+static void dump_json(time_t duration)
+{
+	struct histogram *h = &sample_histogram;
+	struct utsname un;
+	FILE *fp;
+	int n;
+
+	/*
+	 * In kernel-based modes, we only get the bucketized
+	 * histogram of absolute latencies from the timer benchmark
+	 * driver: feed the upper bound of each bucket as samples,
+	 * which gives percentiles with -B resolution.
+	 */
+	if (test_mode != USER_TASK) {
+		for (n = 0; n < histogram_size; n++)
+			histogram_add_n(h, (int64_t)(n + 1) * bucketsize - 1,
+					histogram_avg[n]);
+	}
+
+	if (strcmp(do_json, "-") == 0)
+		fp = stdout;
+	else {
+		fp = fopen(do_json, "w");
+		if (fp == NULL) {
+			warning("cannot open %s: %s", do_json, strerror(errno));
+			return;
+		}
+	}
+
+	if (uname(&un))
+		memset(&un, 0, sizeof(un));
+
+	fprintf(fp, "{\n"
+		"  \"test\": \"latency\",\n"
+		"  \"version\": \"%s\",\n"
+		"  \"core\": \"%s\",\n"
+		"  \"kernel\": \"%s\",\n"
+		"  \"machine\": \"%s\",\n"
+		"  \"mode\": \"%s\",\n"
+		"  \"period_ns\": %Ld,\n"
+		"  \"priority\": %d,\n"
+		"  \"cpu\": %d,\n"
+		"  \"duration_s\": %ld,\n"
+		"  \"samples\": %llu,\n"
+		"  \"resolution_ns\": %d,\n"
+		"  \"overruns\": %d,\n"
+		"  \"mode_switches\": %u,\n",
+		CONFIG_XENO_VERSION_STRING,
+#ifdef CONFIG_XENO_COBALT
+		"cobalt",
+#else
+		"mercury",
+#endif
+		un.release, un.machine,
+		test_mode_names[test_mode],
+		period_ns, priority, cpu, (long)duration,
+		(unsigned long long)h->count,
+		test_mode == USER_TASK ? 0 : bucketsize,
+		goverrun, max_relaxed);
+
+	fprintf(fp, "  \"latency_ns\": {\n"
+		"    \"min\": %d,\n"
+		"    \"avg\": %Ld,\n"
+		"    \"max\": %d,\n"
+		"    \"stddev\": %.1f,\n"
+		"    \"p50\": %Ld,\n"
+		"    \"p90\": %Ld,\n"
+		"    \"p99\": %Ld,\n"
+		"    \"p99.9\": %Ld,\n"
+		"    \"p99.99\": %Ld\n"
+		"  }\n"
+		"}\n",
+		gminjitter, (long long)gavgjitter, gmaxjitter,
+		histogram_stddev(h),
+		(long long)histogram_percentile(h, 50.0),
+		(long long)histogram_percentile(h, 90.0),
+		(long long)histogram_percentile(h, 99.0),
+		(long long)histogram_percentile(h, 99.9),
+		(long long)histogram_percentile(h, 99.99));
+
+	if (fp != stdout)
+		fclose(fp);
+}
+
 static void cleanup(void)
 {
 	struct rttst_overall_bench_res overall;
@@ -515,6 +615,10 @@ static void cleanup(void)
 	if (need_histo())
 		dump_hist_stats(actual_duration);
 
+	/* sample_histogram is not set up if we bailed out early. */
+	if (do_json && sample_histogram.nr_cells)
+		dump_json(actual_duration);
+
 	printf
 	    ("---|-----------|-----------|-----------|--------|------|-------------------------\n"
 	     "RTS|%11.3f|%11.3f|%11.3f|%8d|%6u|    %.2ld:%.2ld:%.2ld/%.2d:%.2d:%.2d\n",
@@ -534,6 +638,8 @@ static void cleanup(void)
 	if (histogram_min)
 		free(histogram_min);
 
+	histogram_destroy(&sample_histogram);
+
 	exit(0);
 }
 
@@ -599,6 +705,7 @@ void application_usage(void)
 	fprintf(stderr,
 		"-h                              print histograms of min, avg, max latencies\n"
 		"-g <file>                       dump histogram to <file> in gnuplot format\n"
+		"-J <file>                       dump results and latency percentiles to <file> in JSON format\n"
 		"-s                              print statistics of min, avg, max latencies\n"
 		"-H <histogram-size>             default = 200, increase if your last bucket is full\n"
 		"-B <bucket-size>                default = 1000ns, decrease for more resolution\n"
@@ -641,17 +748,21 @@ static void setup_sched_parameters(pthread_attr_t *attr, int prio)
 int main(int argc, char *const *argv)
 {
 	struct sigaction sa __attribute__((unused));
-	int c, ret, sig, cpu = 0;
+	int c, ret, sig;
 	pthread_attr_t tattr;
 	cpu_set_t cpus;
 	sigset_t mask;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	while ((c = getopt(argc, argv, "g:J:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
 			break;
 
+		case 'J':
+			do_json = strdup(optarg);
+			break;
+
 		case 'h':
 
 			do_histogram = 1;
@@ -747,6 +858,11 @@ int main(int argc, char *const *argv)
 	if (!(histogram_avg && histogram_max && histogram_min))
 		cleanup();
 
+	if (do_json &&
+	    histogram_init(&sample_histogram,
+			   PERCENTILE_MAX, PERCENTILE_PRECISION))
+		error(1, ENOMEM, "histogram_init()");
+
 	if (period_ns == 0)
 		period_ns = CONFIG_XENO_DEFAULT_PERIOD;	/* ns */
 
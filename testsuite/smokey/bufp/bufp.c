@@ -23,6 +23,17 @@ smokey_test_plugin(bufp,
 
 #define BUFP_SVPORT 12
 
+#define BUFP_BENCH_PORT 13
+
+#define BUFP_BENCH_MSGSZ 64
+
+#define BUFP_RING_PORT 14
+
+struct ring_pair {
+	int rds, wrs;
+	struct bufp_ring *rdring, *wrring;
+};
+
 static pthread_t svtid, cltid;
 
 static void fail(const char *reason)
@@ -132,12 +143,164 @@ static void *client(void *arg)
 	return NULL;
 }
 
+/*
+ * Time a send/receive cycle through the ring of a socket connected
+ * to itself, which measures the protocol overhead without any
+ * context switch.
+ */
+static int run_benchmark(struct smokey_test *t)
+{
+	struct sockaddr_ipc saddr;
+	size_t bufsz = 32768;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (s < 0)
+		return -errno;
+
+	ret = setsockopt(s, SOL_BUFP, BUFP_BUFSZ, &bufsz, sizeof(bufsz));
+	if (ret)
+		goto fail;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_BENCH_PORT;
+	ret = bind(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail;
+
+	ret = connect(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail;
+
+	ret = smokey_bench_run(t, "send_recv", smokey_bench_send_recv, &s);
+	close(s);
+
+	return ret;
+fail:
+	ret = -errno;
+	close(s);
+
+	return ret;
+}
+
+static int ring_write_read(void *arg)
+{
+	struct ring_pair *p = arg;
+	char buf[BUFP_BENCH_MSGSZ];
+	ssize_t ret;
+
+	memset(buf, 0xa5, sizeof(buf));
+	ret = bufp_ring_write(p->wrring, p->wrs, buf, sizeof(buf),
+			      MSG_DONTWAIT);
+	if (ret != sizeof(buf))
+		return ret < 0 ? ret : -EIO;
+
+	ret = bufp_ring_read(p->rdring, p->rds, buf, sizeof(buf),
+			     MSG_DONTWAIT);
+	if (ret != sizeof(buf))
+		return ret < 0 ? ret : -EIO;
+
+	return 0;
+}
+
+/*
+ * Exchange data through a mapped ring, from a writer socket
+ * connected to the reader port.
+ */
+static int run_ring(struct smokey_test *t)
+{
+	struct ring_pair p = { .rds = -1, .wrs = -1 };
+	struct sockaddr_ipc saddr;
+	size_t bufsz = 1000;
+	int ret, on = 1;
+	long data, n;
+
+	p.rds = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (p.rds < 0)
+		return -errno;
+
+	if (!__Terrno(ret, setsockopt(p.rds, SOL_BUFP, BUFP_BUFSZ,
+				      &bufsz, sizeof(bufsz))))
+		goto out;
+
+	if (!__Terrno(ret, setsockopt(p.rds, SOL_BUFP, BUFP_RING,
+				      &on, sizeof(on))))
+		goto out;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_RING_PORT;
+	if (!__Terrno(ret, bind(p.rds, (struct sockaddr *)&saddr,
+				sizeof(saddr))))
+		goto out;
+
+	p.wrs = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (p.wrs < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (!__Terrno(ret, connect(p.wrs, (struct sockaddr *)&saddr,
+				   sizeof(saddr))))
+		goto out;
+
+	p.rdring = bufp_ring_map(p.rds);
+	p.wrring = bufp_ring_map(p.wrs);
+	if (p.rdring == NULL || p.wrring == NULL) {
+		ret = -errno;
+		smokey_warning("cannot map ring: %s", symerror(ret));
+		goto out;
+	}
+
+	ret = -EINVAL;
+	/* The buffer size is rounded up to a power of two. */
+	if (!__Tassert(p.rdring->size == 1024))
+		goto out;
+
+	/* Data goes through the mapping only. */
+	if (!__Tassert(send(p.wrs, &data, sizeof(data), 0) < 0 &&
+		       errno == EOPNOTSUPP))
+		goto out;
+
+	/* Make the indices wrap around the data area a few times. */
+	for (n = 0; n < 1000; n++) {
+		if (!__Tassert(bufp_ring_write(p.wrring, p.wrs, &n, sizeof(n),
+					       MSG_DONTWAIT) == sizeof(n)))
+			goto out;
+		if (!__Tassert(bufp_ring_read(p.rdring, p.rds, &data,
+					      sizeof(data), 0) == sizeof(data)))
+			goto out;
+		if (!__Tassert(data == n))
+			goto out;
+	}
+
+	if (!__Tassert(bufp_ring_read(p.rdring, p.rds, &data, sizeof(data),
+				      MSG_DONTWAIT) == -EWOULDBLOCK))
+		goto out;
+
+	ret = 0;
+	if (smokey_bench_mode)
+		ret = smokey_bench_run(t, "ring_write_read",
+				       ring_write_read, &p);
+out:
+	if (p.wrring)
+		bufp_ring_unmap(p.wrring);
+	if (p.rdring)
+		bufp_ring_unmap(p.rdring);
+	if (p.wrs >= 0)
+		close(p.wrs);
+	close(p.rds);
+
+	return ret;
+}
+
 static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param svparam = {.sched_priority = 71 };
 	struct sched_param clparam = {.sched_priority = 70 };
 	pthread_attr_t svattr, clattr;
-	int s;
+	int ret, s;
 
 	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
 	if (s < 0) {
@@ -170,5 +333,12 @@ static int run_bufp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
+	ret = run_ring(t);
+	if (ret)
+		return ret;
+
+	if (smokey_bench_mode)
+		return run_benchmark(t);
+
 	return 0;
 }
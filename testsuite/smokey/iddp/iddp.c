@@ -23,6 +23,11 @@ smokey_test_plugin(iddp,
 
 #define IDDP_SVPORT 12
 #define IDDP_CLPORT 13
+#define IDDP_SLABPORT 14
+#define IDDP_SLABCLPORT 15
+#define IDDP_BENCH_PORT 16
+#define IDDP_BENCH_MSGSZ 64
+#define IDDP_SLABSZ 64
 
 static pthread_t svtid, cltid;
 
@@ -136,12 +141,184 @@ static void *client(void *arg)
 	return NULL;
 }
 
+/*
+ * Fill up then drain a local pool in slab mode (IDDP_MSGSZ), from a
+ * single thread with non-blocking I/O.
+ */
+static int run_slab(void)
+{
+	struct sockaddr_ipc saddr, claddr;
+	char buf[IDDP_SLABSZ + 1];
+	int ret, rds, wrs = -1, n, count;
+	size_t poolsz, msgsz;
+
+	rds = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (rds < 0)
+		return -errno;
+
+	/* The pool must hold at least one slot. */
+	poolsz = 4096;
+	msgsz = poolsz;
+	if (!__Terrno(ret, setsockopt(rds, SOL_IDDP, IDDP_POOLSZ,
+				      &poolsz, sizeof(poolsz))))
+		goto out;
+	if (!__Terrno(ret, setsockopt(rds, SOL_IDDP, IDDP_MSGSZ,
+				      &msgsz, sizeof(msgsz))))
+		goto out;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = IDDP_SLABPORT;
+	ret = -EINVAL;
+	if (!__Tassert(bind(rds, (struct sockaddr *)&saddr,
+			    sizeof(saddr)) < 0 && errno == EINVAL))
+		goto out;
+
+	close(rds);
+	rds = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (rds < 0)
+		return -errno;
+
+	msgsz = IDDP_SLABSZ;
+	if (!__Terrno(ret, setsockopt(rds, SOL_IDDP, IDDP_POOLSZ,
+				      &poolsz, sizeof(poolsz))))
+		goto out;
+	if (!__Terrno(ret, setsockopt(rds, SOL_IDDP, IDDP_MSGSZ,
+				      &msgsz, sizeof(msgsz))))
+		goto out;
+	if (!__Terrno(ret, bind(rds, (struct sockaddr *)&saddr,
+				sizeof(saddr))))
+		goto out;
+
+	wrs = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (wrs < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	memset(&claddr, 0, sizeof(claddr));
+	claddr.sipc_family = AF_RTIPC;
+	claddr.sipc_port = IDDP_SLABCLPORT;
+	if (!__Terrno(ret, bind(wrs, (struct sockaddr *)&claddr,
+				sizeof(claddr))))
+		goto out;
+	if (!__Terrno(ret, connect(wrs, (struct sockaddr *)&saddr,
+				   sizeof(saddr))))
+		goto out;
+
+	ret = -EINVAL;
+	memset(buf, 0, sizeof(buf));
+	/* Datagrams larger than a slot are rejected. */
+	if (!__Tassert(send(wrs, buf, IDDP_SLABSZ + 1, MSG_DONTWAIT) < 0 &&
+		       errno == EMSGSIZE))
+		goto out;
+
+	/* Exhaust the slots, the pool cannot hold more than this. */
+	for (count = 0; count < 4096 / IDDP_SLABSZ; count++) {
+		memset(buf, count, IDDP_SLABSZ);
+		if (send(wrs, buf, IDDP_SLABSZ, MSG_DONTWAIT) < 0)
+			break;
+	}
+	if (!__Tassert(count > 0 && count < 4096 / IDDP_SLABSZ &&
+		       errno == EAGAIN))
+		goto out;
+
+	for (n = 0; n < count; n++) {
+		if (!__Tassert(recv(rds, buf, sizeof(buf), MSG_DONTWAIT) ==
+			       IDDP_SLABSZ))
+			goto out;
+		if (!__Tassert(buf[0] == (char)n &&
+			       buf[IDDP_SLABSZ - 1] == (char)n))
+			goto out;
+	}
+
+	if (!__Tassert(recv(rds, buf, sizeof(buf), MSG_DONTWAIT) < 0 &&
+		       errno == EAGAIN))
+		goto out;
+
+	/* Released slots are available again. */
+	if (!__Tassert(send(wrs, buf, IDDP_SLABSZ, MSG_DONTWAIT) ==
+		       IDDP_SLABSZ))
+		goto out;
+
+	smokey_trace("%s: %d slots of %d bytes", __func__,
+		     count, IDDP_SLABSZ);
+	ret = 0;
+out:
+	/* Leave a datagram pending in the pool on close. */
+	if (wrs >= 0)
+		close(wrs);
+	close(rds);
+
+	return ret;
+}
+
+/*
+ * Time a send/receive cycle on a socket connected to itself, drawing
+ * the buffers from the system heap or from a local pool in slab
+ * mode (@msgsz non-zero).
+ */
+static int bench_send_recv(struct smokey_test *t, const char *name,
+			   size_t msgsz)
+{
+	struct sockaddr_ipc saddr;
+	size_t poolsz = 32768;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0)
+		return -errno;
+
+	if (msgsz > 0) {
+		ret = setsockopt(s, SOL_IDDP, IDDP_POOLSZ,
+				 &poolsz, sizeof(poolsz));
+		if (ret)
+			goto fail;
+		ret = setsockopt(s, SOL_IDDP, IDDP_MSGSZ,
+				 &msgsz, sizeof(msgsz));
+		if (ret)
+			goto fail;
+	}
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = IDDP_BENCH_PORT;
+	ret = bind(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail;
+
+	ret = connect(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail;
+
+	ret = smokey_bench_run(t, name, smokey_bench_send_recv, &s);
+	close(s);
+
+	return ret;
+fail:
+	ret = -errno;
+	close(s);
+
+	return ret;
+}
+
+static int run_benchmarks(struct smokey_test *t)
+{
+	int ret;
+
+	ret = bench_send_recv(t, "send_recv", 0);
+	if (ret)
+		return ret;
+
+	return bench_send_recv(t, "send_recv_slab", IDDP_BENCH_MSGSZ);
+}
+
 static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param svparam = {.sched_priority = 71 };
 	struct sched_param clparam = {.sched_priority = 70 };
 	pthread_attr_t svattr, clattr;
-	int s;
+	int ret, s;
 
 	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
 	if (s < 0) {
@@ -174,5 +351,9 @@ static int run_iddp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_cancel(svtid);
 	pthread_join(svtid, NULL);
 
-	return 0;
+	ret = run_slab();
+	if (ret || !smokey_bench_mode)
+		return ret;
+
+	return run_benchmarks(t);
 }
@@ -0,0 +1,490 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include "memcheck.h"
+
+/*
+ * Allocation workloads replayed against a memcheck descriptor when
+ * --bench is given. Each workload times every alloc/free call
+ * individually, and tracks how well the allocator packs the live
+ * blocks into the heap.
+ */
+
+#define BENCH_HEAP_SIZE    (1024 * 1024)
+#define BENCH_HEAP_MIN     (32 * LOGNORMAL_MEDIAN)
+#define FIXED_BLOCK_SIZE   64
+#define LOGNORMAL_MEDIAN   128
+#define LOGNORMAL_SIGMA    1.0
+#define LONGLIVED_RATIO    10	/* % of long-lived allocations */
+#define LONGLIVED_MAX      25	/* % of the heap they may pin */
+
+struct slot {
+	void *ptr;
+	size_t size;
+};
+
+struct bench_heap {
+	struct memcheck_descriptor *md;
+	struct smokey_test *t;
+	const char *workload;
+	void *mem;
+	size_t heap_size;
+	size_t live_bytes;
+	size_t peak_used;
+	double peak_overhead;
+	double worst_fill;
+	int failures;
+	int loops;
+	struct smokey_bench alloc_bench;
+	struct smokey_bench free_bench;
+	char alloc_name[32];
+	char free_name[32];
+};
+
+static size_t lognormal_size(size_t max_size)
+{
+	double u1, u2, z, size;
+
+	u1 = (random() + 1.0) / (RAND_MAX + 1.0);
+	u2 = (random() + 1.0) / (RAND_MAX + 1.0);
+	z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+	size = exp(log(LOGNORMAL_MEDIAN) + LOGNORMAL_SIGMA * z);
+	if (size < 1.0)
+		return 1;
+
+	return size > max_size ? max_size : (size_t)size;
+}
+
+static int heap_open(struct bench_heap *bh, struct memcheck_descriptor *md,
+		     struct smokey_test *t, const char *workload,
+		     size_t heap_size)
+{
+	size_t arena_size = heap_size;
+	int ret;
+
+	memset(bh, 0, sizeof(*bh));
+	bh->md = md;
+	bh->t = t;
+	bh->workload = workload;
+	bh->heap_size = heap_size;
+	bh->worst_fill = 1.0;
+
+	if (md->get_arena_size) {
+		arena_size = md->get_arena_size(heap_size);
+		if (arena_size == 0)
+			return -ENOMEM;
+	}
+
+	bh->mem = __STD(malloc(arena_size));
+	if (bh->mem == NULL)
+		return -ENOMEM;
+
+	ret = md->init(md->heap, bh->mem, arena_size);
+	if (ret)
+		goto fail_init;
+
+	snprintf(bh->alloc_name, sizeof(bh->alloc_name), "%s.alloc", workload);
+	snprintf(bh->free_name, sizeof(bh->free_name), "%s.free", workload);
+
+	ret = smokey_bench_init(&bh->alloc_bench, t, bh->alloc_name);
+	if (ret)
+		goto fail_alloc_bench;
+
+	ret = smokey_bench_init(&bh->free_bench, t, bh->free_name);
+	if (ret)
+		goto fail_free_bench;
+
+	harden();
+
+	return 0;
+
+fail_free_bench:
+	histogram_destroy(&bh->alloc_bench.hist);
+fail_alloc_bench:
+	md->destroy(md->heap);
+fail_init:
+	__STD(free(bh->mem));
+
+	return ret;
+}
+
+static void *heap_alloc(struct bench_heap *bh, size_t size)
+{
+	struct memcheck_descriptor *md = bh->md;
+	size_t used, usable;
+	double overhead;
+	void *p;
+
+	breathe(++bh->loops);
+
+	smokey_bench_start(&bh->alloc_bench);
+	p = md->alloc(md->heap, size);
+	smokey_bench_stop(&bh->alloc_bench);
+
+	used = md->get_used_size(md->heap);
+	usable = md->get_usable_size(md->heap);
+
+	if (p == NULL) {
+		/*
+		 * The lower the fill ratio at which an allocation
+		 * fails, the worse the external fragmentation.
+		 */
+		bh->failures++;
+		if (usable && (double)used / usable < bh->worst_fill)
+			bh->worst_fill = (double)used / usable;
+		return NULL;
+	}
+
+	bh->live_bytes += size;
+	if (used > bh->peak_used)
+		bh->peak_used = used;
+
+	if (used > bh->live_bytes) {
+		overhead = (double)(used - bh->live_bytes) / used;
+		if (overhead > bh->peak_overhead)
+			bh->peak_overhead = overhead;
+	}
+
+	return p;
+}
+
+static int heap_free(struct bench_heap *bh, struct slot *s)
+{
+	struct memcheck_descriptor *md = bh->md;
+	int ret;
+
+	breathe(++bh->loops);
+
+	smokey_bench_start(&bh->free_bench);
+	ret = md->free(md->heap, s->ptr);
+	smokey_bench_stop(&bh->free_bench);
+	if (ret)
+		return ret;
+
+	bh->live_bytes -= s->size;
+	s->ptr = NULL;
+
+	return 0;
+}
+
+static int heap_metric(struct bench_heap *bh, const char *metric,
+		       double value, const char *unit)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), "%s.%s", bh->workload, metric);
+
+	return smokey_bench_metric(bh->t, name, value, unit);
+}
+
+static int heap_close(struct bench_heap *bh, struct slot *slots, int nr)
+{
+	struct memcheck_descriptor *md = bh->md;
+	int ret, n;
+
+	for (n = 0; n < nr; n++)
+		if (slots[n].ptr)
+			md->free(md->heap, slots[n].ptr);
+
+	md->destroy(md->heap);
+	__STD(free(bh->mem));
+
+	if (bh->failures)
+		smokey_note("%s.%s: %d failed allocations",
+			    bh->t->name, bh->workload, bh->failures);
+
+	ret = heap_metric(bh, "peak_used", bh->peak_used, "bytes");
+	n = heap_metric(bh, "peak_overhead",
+			bh->peak_overhead * 100.0, "%");
+	ret = ret ?: n;
+	/*
+	 * Fragmentation is measured by the lowest fill ratio at which
+	 * an allocation failed, zero if none did.
+	 */
+	n = heap_metric(bh, "fragmentation",
+			(1.0 - bh->worst_fill) * 100.0, "%");
+	ret = ret ?: n;
+	n = smokey_bench_report(&bh->alloc_bench);
+	ret = ret ?: n;
+	n = smokey_bench_report(&bh->free_bench);
+
+	return ret ?: n;
+}
+
+/*
+ * Toggle random slots between busy and free, which converges to a
+ * steady state where half of the slots are busy. A zero
+ * @fixed_size picks log-normally distributed sizes.
+ */
+static int run_random(struct memcheck_descriptor *md, struct smokey_test *t,
+		      const char *workload, size_t heap_size,
+		      size_t fixed_size)
+{
+	size_t size, avg_size, max_size = heap_size / 32;
+	struct bench_heap bh;
+	struct slot *slots;
+	int ret, n, nr, k;
+
+	avg_size = fixed_size ?: (size_t)(LOGNORMAL_MEDIAN *
+			  exp(LOGNORMAL_SIGMA * LOGNORMAL_SIGMA / 2));
+	nr = heap_size / avg_size;
+	slots = calloc(nr, sizeof(*slots));
+	if (slots == NULL)
+		return -ENOMEM;
+
+	ret = heap_open(&bh, md, t, workload, heap_size);
+	if (ret)
+		goto out;
+
+	for (n = 0; n < smokey_bench_iterations; n++) {
+		k = random() % nr;
+		if (slots[k].ptr) {
+			ret = heap_free(&bh, slots + k);
+			if (ret)
+				break;
+			continue;
+		}
+		size = fixed_size ?: lognormal_size(max_size);
+		slots[k].ptr = heap_alloc(&bh, size);
+		slots[k].size = size;
+	}
+
+	n = heap_close(&bh, slots, nr);
+	ret = ret ?: n;
+out:
+	free(slots);
+
+	return ret;
+}
+
+/*
+ * Producer/consumer pattern: blocks are released in allocation
+ * order, after a fixed delay expressed as a number of subsequent
+ * allocations.
+ */
+static int run_fifo(struct memcheck_descriptor *md, struct smokey_test *t,
+		    size_t heap_size)
+{
+	size_t size, max_size = heap_size / 32;
+	struct bench_heap bh;
+	int ret, n, nr, head;
+	struct slot *slots;
+
+	nr = heap_size / (2 * LOGNORMAL_MEDIAN);
+	slots = calloc(nr, sizeof(*slots));
+	if (slots == NULL)
+		return -ENOMEM;
+
+	ret = heap_open(&bh, md, t, "fifo", heap_size);
+	if (ret)
+		goto out;
+
+	for (n = 0, head = 0; n < smokey_bench_iterations; n++) {
+		if (slots[head].ptr) {
+			ret = heap_free(&bh, slots + head);
+			if (ret)
+				break;
+		}
+		size = lognormal_size(max_size);
+		slots[head].ptr = heap_alloc(&bh, size);
+		slots[head].size = size;
+		head = (head + 1) % nr;
+	}
+
+	n = heap_close(&bh, slots, nr);
+	ret = ret ?: n;
+out:
+	free(slots);
+
+	return ret;
+}
+
+/*
+ * Short-lived random allocations, mixed with long-lived blocks which
+ * stay busy until the end of the run, pinning heap space in the
+ * middle of the free areas.
+ */
+static int run_longlived(struct memcheck_descriptor *md,
+			 struct smokey_test *t, size_t heap_size)
+{
+	size_t size, pinned = 0, max_size = heap_size / 32;
+	int ret, n, nr, nr_short, nr_long = 0, k;
+	struct bench_heap bh;
+	struct slot *slots;
+
+	nr = heap_size / LOGNORMAL_MEDIAN;
+	nr_short = nr / 2;
+	slots = calloc(nr, sizeof(*slots));
+	if (slots == NULL)
+		return -ENOMEM;
+
+	ret = heap_open(&bh, md, t, "longlived", heap_size);
+	if (ret)
+		goto out;
+
+	for (n = 0; n < smokey_bench_iterations; n++) {
+		size = lognormal_size(max_size);
+		if (random() % 100 < LONGLIVED_RATIO &&
+		    nr_short + nr_long < nr &&
+		    (pinned + size) * 100 / heap_size < LONGLIVED_MAX) {
+			k = nr_short + nr_long;
+			slots[k].ptr = heap_alloc(&bh, size);
+			slots[k].size = size;
+			if (slots[k].ptr) {
+				pinned += size;
+				nr_long++;
+			}
+			continue;
+		}
+		k = random() % nr_short;
+		if (slots[k].ptr) {
+			ret = heap_free(&bh, slots + k);
+			if (ret)
+				break;
+			continue;
+		}
+		slots[k].ptr = heap_alloc(&bh, size);
+		slots[k].size = size;
+	}
+
+	n = heap_close(&bh, slots, nr);
+	ret = ret ?: n;
+out:
+	free(slots);
+
+	return ret;
+}
+
+/*
+ * Replay a recorded allocation trace. Each line either reads
+ * "a <id> <size>" for allocating a block, or "f <id>" for releasing
+ * it, blank lines and lines starting with '#' are ignored.
+ */
+static int run_trace(struct memcheck_descriptor *md, struct smokey_test *t,
+		     size_t heap_size, const char *path)
+{
+	struct slot *slots = NULL, *tmp;
+	int ret, n, lineno = 0, nr = 0;
+	char *line = NULL, op;
+	struct bench_heap bh;
+	size_t len = 0, size;
+	unsigned int id;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		ret = -errno;
+		smokey_warning("cannot open trace file %s: %s",
+			       path, strerror(-ret));
+		return ret;
+	}
+
+	ret = heap_open(&bh, md, t, "trace", heap_size);
+	if (ret)
+		goto out;
+
+	while (getline(&line, &len, fp) != -1) {
+		lineno++;
+		if (*line == '#' || *line == '\n')
+			continue;
+		size = 0;
+		if (sscanf(line, "%c %u %zu", &op, &id, &size) < 2 ||
+		    (op != 'a' && op != 'f') || (op == 'a' && size == 0)) {
+			smokey_warning("%s:%d: malformed trace entry",
+				       path, lineno);
+			ret = -EINVAL;
+			break;
+		}
+		if (id >= nr) {
+			n = id < 2 * nr ? 2 * nr : id + 1;
+			tmp = realloc(slots, n * sizeof(*slots));
+			if (tmp == NULL) {
+				ret = -ENOMEM;
+				break;
+			}
+			memset(tmp + nr, 0, (n - nr) * sizeof(*slots));
+			slots = tmp;
+			nr = n;
+		}
+		if (op == 'f') {
+			if (slots[id].ptr) {
+				ret = heap_free(&bh, slots + id);
+				if (ret)
+					break;
+			}
+			continue;
+		}
+		if (slots[id].ptr) {
+			smokey_warning("%s:%d: block %u is busy",
+				       path, lineno, id);
+			ret = -EINVAL;
+			break;
+		}
+		slots[id].ptr = heap_alloc(&bh, size);
+		slots[id].size = size;
+	}
+
+	n = heap_close(&bh, slots, nr);
+	ret = ret ?: n;
+out:
+	free(slots);
+	free(line);
+	fclose(fp);
+
+	return ret;
+}
+
+int memcheck_bench(struct memcheck_descriptor *md,
+		   struct smokey_test *t)
+{
+	size_t heap_size = BENCH_HEAP_SIZE;
+	struct sched_param param;
+	int ret;
+
+	if (md->alloc == NULL) {
+		smokey_note("%s: no user-space allocator to benchmark",
+			    md->name);
+		return 0;
+	}
+
+	if (smokey_arg_isset(t, "bench_heap_size"))
+		heap_size = smokey_arg_size(t, "bench_heap_size");
+
+	/* Workloads need room for a couple of blocks at the very least. */
+	if (heap_size < BENCH_HEAP_MIN) {
+		smokey_warning("bench_heap_size too small (min. %d bytes)",
+			       BENCH_HEAP_MIN);
+		return -EINVAL;
+	}
+
+	/* This switches to real-time mode over Cobalt. */
+	param.sched_priority = 1;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	/* Replay the same synthetic sequences from run to run. */
+	srandom(1);
+
+	if (smokey_arg_isset(t, "bench_trace"))
+		return run_trace(md, t, heap_size,
+				 smokey_arg_string(t, "bench_trace"));
+
+	ret = run_random(md, t, "fixed", heap_size, FIXED_BLOCK_SIZE);
+	if (ret)
+		return ret;
+
+	ret = run_random(md, t, "lognormal", heap_size, 0);
+	if (ret)
+		return ret;
+
+	ret = run_fifo(md, t, heap_size);
+	if (ret)
+		return ret;
+
+	return run_longlived(md, t, heap_size);
+}
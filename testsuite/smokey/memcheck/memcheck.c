@@ -30,39 +30,6 @@ static int nrstats;
 
 static int max_results = 4;
 
-#ifdef CONFIG_XENO_COBALT
-
-#include <sys/cobalt.h>
-
-static inline void breathe(int loops)
-{
-	struct timespec idle = {
-		.tv_sec = 0,
-		.tv_nsec = 300000,
-	};
-
-	/*
-	 * There is not rt throttling over Cobalt, so we may need to
-	 * keep the host kernel breathing by napping during the test
-	 * sequences.
-	 */
-	if ((loops % 1000) == 0)
-		__RT(clock_nanosleep(CLOCK_MONOTONIC, 0, &idle, NULL));
-}
-
-static inline void harden(void)
-{
-	cobalt_thread_harden();
-}
-
-#else
-
-static inline void breathe(int loops) { }
-
-static inline void harden(void) { }
-
-#endif
-
 static inline long diff_ts(struct timespec *left, struct timespec *right)
 {
 	return (long long)(left->tv_sec - right->tv_sec) * ONE_BILLION
@@ -860,6 +827,12 @@ int memcheck_run(struct memcheck_descriptor *md,
 		}
 	}
 	
+	if (smokey_bench_mode) {
+		ret = memcheck_bench(md, t);
+		if (ret)
+			return ret;
+	}
+
 	now = time(NULL);
 	smokey_trace("\n== memcheck finished for %s at %s",
 		     md->name, ctime(&now));
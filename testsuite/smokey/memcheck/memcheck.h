@@ -7,6 +7,7 @@
 #define SMOKEY_MEMCHECK_H
 
 #include <sys/types.h>
+#include <time.h>
 #include <boilerplate/ancillaries.h>
 #include <smokey/smokey.h>
 
@@ -66,6 +67,8 @@ struct memcheck_descriptor {
 		SMOKEY_INT(random_alloc_rounds),	\
 		SMOKEY_INT(pattern_check_rounds),	\
 		SMOKEY_INT(max_results),		\
+		SMOKEY_SIZE(bench_heap_size),		\
+		SMOKEY_STRING(bench_trace),		\
 	)
   
 #define MEMCHECK_HELP_STRINGS						\
@@ -74,10 +77,48 @@ struct memcheck_descriptor {
 	"\trandom_alloc_rounds=<N>\t\t# of rounds of random-size allocations\n" \
 	"\tpattern_check_rounds=<N>\t# of rounds of pattern check tests\n" \
 	"\tmax_results=<N>\t# of result lines (worst-case first, -1=all)\n" \
+	"\tbench_heap_size=<size[K|M|G]>\theap size for benchmarks (--bench)\n" \
+	"\tbench_trace=<file>\t\treplay allocation trace (--bench)\n" \
 	"\tSet --verbose=2 for detailed runtime statistics.\n"
 
+#ifdef CONFIG_XENO_COBALT
+
+#include <sys/cobalt.h>
+
+static inline void breathe(int loops)
+{
+	struct timespec idle = {
+		.tv_sec = 0,
+		.tv_nsec = 300000,
+	};
+
+	/*
+	 * There is not rt throttling over Cobalt, so we may need to
+	 * keep the host kernel breathing by napping during the test
+	 * sequences.
+	 */
+	if ((loops % 1000) == 0)
+		__RT(clock_nanosleep(CLOCK_MONOTONIC, 0, &idle, NULL));
+}
+
+static inline void harden(void)
+{
+	cobalt_thread_harden();
+}
+
+#else
+
+static inline void breathe(int loops) { }
+
+static inline void harden(void) { }
+
+#endif
+
 void memcheck_log_stat(struct memcheck_stat *st);
 
+int memcheck_bench(struct memcheck_descriptor *md,
+		   struct smokey_test *t);
+
 int memcheck_run(struct memcheck_descriptor *md,
 		 struct smokey_test *t,
 		 int argc, char *const argv[]);
@@ -723,6 +723,98 @@ static void cond_ppmutex(void)
 	check("cond_destroy", cond_destroy(&cond), 0);
 }
 
+struct cond_bench {
+	pthread_mutex_t mutex;
+	pthread_cond_t ping;
+	pthread_cond_t pong;
+	int pinged;
+	int stop;
+};
+
+static int signal_nowaiter(void *arg)
+{
+	struct cond_bench *cb = arg;
+	int ret;
+
+	ret = mutex_lock(&cb->mutex);
+	if (ret)
+		return ret;
+
+	ret = cond_signal(&cb->ping);
+
+	return mutex_unlock(&cb->mutex) ?: ret;
+}
+
+static void *cond_ponger(void *cookie)
+{
+	struct cond_bench *cb = cookie;
+
+	check("mutex_lock", mutex_lock(&cb->mutex), 0);
+	for (;;) {
+		while (!cb->pinged && !cb->stop)
+			check("cond_wait", cond_wait(&cb->ping, &cb->mutex, 0), 0);
+		if (cb->stop)
+			break;
+		cb->pinged = 0;
+		check("cond_signal", cond_signal(&cb->pong), 0);
+	}
+	check("mutex_unlock", mutex_unlock(&cb->mutex), 0);
+
+	return NULL;
+}
+
+static int ping_pong(void *arg)
+{
+	struct cond_bench *cb = arg;
+	int ret;
+
+	ret = mutex_lock(&cb->mutex);
+	if (ret)
+		return ret;
+
+	cb->pinged = 1;
+	ret = cond_signal(&cb->ping);
+	while (ret == 0 && cb->pinged)
+		ret = cond_wait(&cb->pong, &cb->mutex, 0);
+
+	return mutex_unlock(&cb->mutex) ?: ret;
+}
+
+/*
+ * Time signaling a condvar nobody waits on, which should not involve
+ * any syscall, then a wakeup round-trip with a thread of the same
+ * priority, i.e. two condvar handovers and context switches.
+ */
+static int run_benchmarks(struct smokey_test *t)
+{
+	struct cond_bench cb = { .pinged = 0, .stop = 0 };
+	pthread_t ponger;
+	int ret;
+
+	check("mutex_init", mutex_init(&cb.mutex, PTHREAD_MUTEX_DEFAULT,
+				       PTHREAD_PRIO_NONE), 0);
+	check("cond_init", cond_init(&cb.ping, 0), 0);
+	check("cond_init", cond_init(&cb.pong, 0), 0);
+
+	ret = smokey_bench_run(t, "signal_nowaiter", signal_nowaiter, &cb);
+	if (ret)
+		goto out;
+
+	check("thread_spawn", thread_spawn(&ponger, 2, cond_ponger, &cb), 0);
+	ret = smokey_bench_run(t, "ping_pong", ping_pong, &cb);
+	check("mutex_lock", mutex_lock(&cb.mutex), 0);
+	cb.stop = 1;
+	check("cond_signal", cond_signal(&cb.ping), 0);
+	check("mutex_unlock", mutex_unlock(&cb.mutex), 0);
+	check("thread_join", thread_join(ponger), 0);
+out:
+	check("cond_destroy", cond_destroy(&cb.pong), 0);
+	check("cond_destroy", cond_destroy(&cb.ping), 0);
+	check("mutex_destroy", mutex_destroy(&cb.mutex), 0);
+
+	return ret;
+}
+
 int run_posix_cond(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param sparam;
@@ -745,5 +837,8 @@ int run_posix_cond(struct smokey_test *t, int argc, char *const argv[])
 	cond_destroy_whilewait();
 	cond_ppmutex();
 
+	if (smokey_bench_mode)
+		return run_benchmarks(t);
+
 	return 0;
 }
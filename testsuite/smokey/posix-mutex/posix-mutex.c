@@ -962,6 +962,72 @@ static int check_time_limit(const struct timespec *start,
 	return timespec_scalar(&delta) <= limit_ns;
 }
 
+static int lock_unlock(void *arg)
+{
+	pthread_mutex_t *mutex = arg;
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		return -ret;
+
+	return -pthread_mutex_unlock(mutex);
+}
+
+static int bench_mutex(struct smokey_test *t, const char *name,
+		       pthread_mutex_t *mutex)
+{
+	int ret, bret;
+
+	bret = smokey_bench_run(t, name, lock_unlock, mutex);
+
+	if (!__T(ret, pthread_mutex_destroy(mutex)))
+		return ret;
+
+	return bret;
+}
+
+/*
+ * Time the uncontended lock/unlock fast path for every protocol,
+ * which should not involve any syscall except for PP mutexes.
+ */
+static int run_benchmarks(struct smokey_test *t)
+{
+	pthread_mutex_t mutex;
+	int ret;
+
+	ret = do_init_mutex(&mutex, PTHREAD_MUTEX_NORMAL, PTHREAD_PRIO_NONE);
+	if (ret)
+		return ret;
+
+	ret = bench_mutex(t, "lock_unlock", &mutex);
+	if (ret)
+		return ret;
+
+	ret = do_init_mutex(&mutex, PTHREAD_MUTEX_RECURSIVE, PTHREAD_PRIO_NONE);
+	if (ret)
+		return ret;
+
+	ret = bench_mutex(t, "lock_unlock_recursive", &mutex);
+	if (ret)
+		return ret;
+
+	ret = do_init_mutex(&mutex, PTHREAD_MUTEX_NORMAL, PTHREAD_PRIO_INHERIT);
+	if (ret)
+		return ret;
+
+	ret = bench_mutex(t, "lock_unlock_pi", &mutex);
+	if (ret)
+		return ret;
+
+	ret = do_init_mutex_ceiling(&mutex, PTHREAD_MUTEX_NORMAL,
+				    THREAD_PRIO_HIGH);
+	if (ret)
+		return ret;
+
+	return bench_mutex(t, "lock_unlock_pp", &mutex);
+}
+
 #define do_test(__fn, __limit_ns)					\
 	do {								\
 		struct timespec __start;				\
@@ -1011,5 +1077,8 @@ static int run_posix_mutex(struct smokey_test *t, int argc, char *const argv[])
 	do_test(protect_trylock, MAX_100_MS);
 	do_test(protect_handover, MAX_100_MS);
 
+	if (smokey_bench_mode)
+		return run_benchmarks(t);
+
 	return 0;
 }
@@ -0,0 +1,280 @@
+/*
+ * SCHED_EDF test.
+ *
+ * Released under the terms of GPLv2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <errno.h>
+#include <error.h>
+#include <sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <boilerplate/ancillaries.h>
+#include <boilerplate/atomic.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(sched_edf,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(runtime),
+			   SMOKEY_INT(period),
+		   ),
+   "Check the SCHED_EDF scheduling policy. The code first checks\n"
+   "\tparameter validation and admission control, then estimates how\n"
+   "\tmuch work a SCHED_FIFO thread can perform uninterrupted over\n"
+   "\ta second. The same work loop is re-started afterwards from a\n"
+   "\tSCHED_EDF thread reserving runtime/period (in microseconds)\n"
+   "\tof the CPU bandwidth.\n\n"
+   "\tA successful test shows that the effective percentage of runtime\n"
+   "\tobserved with the SCHED_EDF thread closely matches its reserved\n"
+   "\tbandwidth (barring rounding errors and marginal latency)."
+);
+
+#define TEST_SECS   1
+
+static unsigned long long loops_per_sec;
+
+static unsigned long count;
+
+static sem_t ready;
+
+static atomic_t stop;
+
+static unsigned long __attribute__(( noinline ))
+__do_work(unsigned long count)
+{
+	return count + 1;
+}
+
+static void *thread_body(void *arg)
+{
+	unsigned long *count_r = arg;
+
+	*count_r = 0;
+	sem_post(&ready);
+
+	while (!atomic_read(&stop))
+		*count_r = __do_work(*count_r);
+
+	return NULL;
+}
+
+static inline void ns_to_ts(struct timespec *ts, long long ns)
+{
+	ts->tv_sec = ns / ONE_BILLION;
+	ts->tv_nsec = ns % ONE_BILLION;
+}
+
+static void setup_edf_param(struct sched_param_ex *param_ex,
+			    long long runtime, long long deadline,
+			    long long period)
+{
+	param_ex->sched_priority = 0;
+	ns_to_ts(&param_ex->sched_edf_runtime, runtime);
+	ns_to_ts(&param_ex->sched_edf_deadline, deadline);
+	ns_to_ts(&param_ex->sched_edf_period, period);
+}
+
+static int create_edf_thread(pthread_t *tid, const char *name,
+			     const struct sched_param_ex *param_ex,
+			     unsigned long *count_r)
+{
+	pthread_attr_ex_t attr_ex;
+	int ret;
+
+	pthread_attr_init_ex(&attr_ex);
+	pthread_attr_setdetachstate_ex(&attr_ex, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched_ex(&attr_ex, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy_ex(&attr_ex, SCHED_EDF);
+	pthread_attr_setschedparam_ex(&attr_ex, param_ex);
+	ret = pthread_create_ex(tid, &attr_ex, thread_body, count_r);
+	pthread_attr_destroy_ex(&attr_ex);
+	if (ret == 0)
+		pthread_setname_np(*tid, name);
+
+	return ret;
+}
+
+static void stop_thread(pthread_t tid)
+{
+	atomic_set(&stop, 1);
+	smp_wmb();
+	pthread_join(tid, NULL);
+	atomic_set(&stop, 0);
+}
+
+static int check_admission(void)
+{
+	struct sched_param_ex param_ex, get_ex;
+	unsigned long c1, c2;
+	pthread_t t1, t2;
+	int ret, policy;
+
+	/* Runtime larger than the relative deadline. */
+	setup_edf_param(&param_ex, 2000000, 1000000, 10000000);
+	ret = create_edf_thread(&t1, "edf-inval", &param_ex, &c1);
+	if (ret != EINVAL) {
+		if (ret == 0)
+			stop_thread(t1);
+		smokey_warning("invalid EDF parameters accepted (%d)", ret);
+		return -EPROTO;
+	}
+
+	/* Non-zero priority. */
+	setup_edf_param(&param_ex, 1000000, 0, 10000000);
+	param_ex.sched_priority = 1;
+	ret = create_edf_thread(&t1, "edf-inval", &param_ex, &c1);
+	if (ret != EINVAL) {
+		if (ret == 0)
+			stop_thread(t1);
+		smokey_warning("EDF priority accepted (%d)", ret);
+		return -EPROTO;
+	}
+
+	/* 60% + 60% cannot fit on a single CPU. */
+	setup_edf_param(&param_ex, 6000000, 0, 10000000);
+	ret = create_edf_thread(&t1, "edf-bw1", &param_ex, &c1);
+	if (ret) {
+		smokey_warning("pthread_create_ex(SCHED_EDF): %s",
+			       symerror(-ret));
+		return -ret;
+	}
+	sem_wait(&ready);
+
+	ret = pthread_getschedparam_ex(t1, &policy, &get_ex);
+	if (ret == 0 && (policy != SCHED_EDF ||
+			 get_ex.sched_edf_runtime.tv_nsec != 6000000 ||
+			 get_ex.sched_edf_deadline.tv_nsec != 10000000 ||
+			 get_ex.sched_edf_period.tv_nsec != 10000000)) {
+		smokey_warning("EDF parameters read back differ");
+		ret = EPROTO;
+	}
+
+	if (ret == 0) {
+		ret = create_edf_thread(&t2, "edf-bw2", &param_ex, &c2);
+		if (ret == 0) {
+			sem_wait(&ready);
+			stop_thread(t2);
+			smokey_warning("EDF bandwidth overcommitted");
+			ret = EPROTO;
+		} else if (ret == EBUSY)
+			ret = 0;
+	}
+
+	stop_thread(t1);
+
+	return -ret;
+}
+
+static unsigned long long calibrate(void)
+{
+	struct sched_param param;
+	struct timespec req;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int ret;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	param.sched_priority = 1;
+	pthread_attr_setschedparam(&attr, &param);
+	ret = pthread_create(&tid, &attr, thread_body, &count);
+	if (ret)
+		error(1, ret, "pthread_create(SCHED_FIFO)");
+	pthread_attr_destroy(&attr);
+	sem_wait(&ready);
+
+	req.tv_sec = TEST_SECS;
+	req.tv_nsec = 0;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &req, NULL);
+	pthread_kill(tid, SIGDEMT);
+	stop_thread(tid);
+
+	return count / TEST_SECS;
+}
+
+static double run_edf(long long runtime, long long period)
+{
+	struct sched_param_ex param_ex;
+	struct timespec req;
+	pthread_t tid;
+	int ret;
+
+	setup_edf_param(&param_ex, runtime, 0, period);
+	ret = create_edf_thread(&tid, "edf", &param_ex, &count);
+	if (ret)
+		error(1, ret, "pthread_create_ex(SCHED_EDF)");
+	sem_wait(&ready);
+
+	req.tv_sec = TEST_SECS;
+	req.tv_nsec = 0;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &req, NULL);
+	pthread_kill(tid, SIGDEMT);
+	stop_thread(tid);
+
+	return ((double)count / TEST_SECS) * 100.0 / loops_per_sec;
+}
+
+static int run_sched_edf(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long runtime = 2000, period = 10000;
+	pthread_t me = pthread_self();
+	struct sched_param param;
+	double effective, bw;
+	cpu_set_t affinity;
+	int ret, policies;
+
+	ret = cobalt_corectl(_CC_COBALT_GET_POLICIES, &policies, sizeof(policies));
+	if (ret || (policies & _CC_COBALT_SCHED_EDF) == 0)
+		return -ENOSYS;
+
+	CPU_ZERO(&affinity);
+	CPU_SET(0, &affinity);
+	ret = sched_setaffinity(0, sizeof(affinity), &affinity);
+	if (ret)
+		error(1, errno, "sched_setaffinity");
+
+	smokey_parse_args(t, argc, argv);
+	sem_init(&ready, 0, 0);
+
+	param.sched_priority = 50;
+	ret = pthread_setschedparam(me, SCHED_FIFO, &param);
+	if (ret) {
+		warning("pthread_setschedparam(SCHED_FIFO, 50) failed");
+		return -ret;
+	}
+
+	if (SMOKEY_ARG_ISSET(sched_edf, runtime))
+		runtime = SMOKEY_ARG_INT(sched_edf, runtime);
+	if (SMOKEY_ARG_ISSET(sched_edf, period))
+		period = SMOKEY_ARG_INT(sched_edf, period);
+	if (runtime <= 0 || period <= 0 || runtime > period)
+		error(1, EINVAL, "runtime/period");
+
+	ret = check_admission();
+	if (ret)
+		return ret;
+
+	calibrate();	/* Warming up, ignore result. */
+	loops_per_sec = calibrate();
+
+	smokey_trace("calibrating: %Lu loops/sec", loops_per_sec);
+
+	bw = runtime * 100.0 / period;
+	effective = run_edf(runtime * 1000, period * 1000);
+	smokey_trace("runtime=%Ldus, period=%Ldus: bw=%.1f%%, effective=%.1f%%",
+		     runtime, period, bw, effective);
+
+	if (!smokey_on_vm && fabs(effective - bw) > 1.0) {
+		smokey_warning("out of bandwidth: %.1f%%", effective - bw);
+		return -EPROTO;
+	}
+
+	return 0;
+}
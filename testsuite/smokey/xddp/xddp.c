@@ -14,6 +14,8 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
 #include <smokey/smokey.h>
 #include <rtdm/ipc.h>
 
@@ -216,11 +218,207 @@ static void *regular_thread(void *arg)
 	return NULL;
 }
 
+#define XDDP_ZC_POOLSZ  16384
+
+#define XDDP_ZC_MSGS  3
+
+/*
+ * Receive messages in place from the local pool of a XDDP socket,
+ * which the regular side maps from the pipe device.
+ */
+static int run_zerocopy(void)
+{
+	struct xnpipe_zcdesc desc[XDDP_ZC_MSGS + 1];
+	size_t poolsz = XDDP_ZC_POOLSZ;
+	struct sockaddr_ipc saddr;
+	int ret, s, fd = -1, n;
+	socklen_t addrlen;
+	char *devname;
+	void *pool;
+	long data;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
+	if (s < 0)
+		return -errno;
+
+	if (!__Terrno(ret, setsockopt(s, SOL_XDDP, XDDP_POOLSZ,
+				      &poolsz, sizeof(poolsz))))
+		goto out;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	if (!__Terrno(ret, bind(s, (struct sockaddr *)&saddr, sizeof(saddr))))
+		goto out;
+
+	addrlen = sizeof(saddr);
+	if (!__Terrno(ret, getsockname(s, (struct sockaddr *)&saddr,
+				       &addrlen)))
+		goto out;
+
+	if (asprintf(&devname, "/dev/rtp%d", saddr.sipc_port) < 0) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	fd = open(devname, O_RDWR);
+	free(devname);
+	if (fd < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	pool = mmap(NULL, XDDP_ZC_POOLSZ, PROT_READ, MAP_SHARED, fd, 0);
+	if (pool == MAP_FAILED) {
+		ret = -errno;
+		smokey_warning("cannot map XDDP pool: %s", symerror(ret));
+		goto out;
+	}
+
+	if (!__Terrno(ret, ioctl(fd, XNPIPEIOC_ZCOPY, 1)))
+		goto unmap;
+
+	for (data = 1; data <= XDDP_ZC_MSGS; data++) {
+		if (!__Tassert(sendto(s, &data, sizeof(data), 0,
+				      NULL, 0) == sizeof(data))) {
+			ret = -EIO;
+			goto unmap;
+		}
+	}
+
+	ret = -EINVAL;
+	if (!__Tassert(read(fd, desc, sizeof(desc)) ==
+		       XDDP_ZC_MSGS * sizeof(desc[0])))
+		goto unmap;
+
+	for (n = 0; n < XDDP_ZC_MSGS; n++) {
+		ret = -EINVAL;
+		if (!__Tassert(desc[n].size == sizeof(data)))
+			goto unmap;
+		memcpy(&data, pool + desc[n].offset, sizeof(data));
+		if (!__Tassert(data == n + 1))
+			goto unmap;
+		if (!__Terrno(ret, ioctl(fd, XNPIPEIOC_ZCRELEASE,
+					 desc[n].offset)))
+			goto unmap;
+	}
+
+	/* A message may be released only once. */
+	if (!__Tassert(ioctl(fd, XNPIPEIOC_ZCRELEASE, desc[0].offset) &&
+		       errno == EINVAL))
+		ret = -EINVAL;
+unmap:
+	munmap(pool, XDDP_ZC_POOLSZ);
+out:
+	if (fd >= 0)
+		close(fd);
+	close(s);
+
+	return ret;
+}
+
+#define XDDP_FR_MSGS  3
+
+#define XDDP_FR_FRAMESZ  (XNPIPE_FRAME_HDRSZ + sizeof(long))
+
+/*
+ * Drain several messages with a single read() in framed mode, the
+ * reader being held off until the watermark is reached.
+ */
+static int run_framed(void)
+{
+	char buf[XDDP_FR_MSGS * XDDP_FR_FRAMESZ], *p;
+	struct sockaddr_ipc saddr;
+	int ret, s, fd = -1, n;
+	socklen_t addrlen;
+	char *devname;
+	__u32 hdr;
+	long data;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
+	if (s < 0)
+		return -errno;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	if (!__Terrno(ret, bind(s, (struct sockaddr *)&saddr, sizeof(saddr))))
+		goto out;
+
+	addrlen = sizeof(saddr);
+	if (!__Terrno(ret, getsockname(s, (struct sockaddr *)&saddr,
+				       &addrlen)))
+		goto out;
+
+	if (asprintf(&devname, "/dev/rtp%d", saddr.sipc_port) < 0) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	fd = open(devname, O_RDWR | O_NONBLOCK);
+	free(devname);
+	if (fd < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (!__Terrno(ret, ioctl(fd, XNPIPEIOC_FRAMED, 1)))
+		goto out;
+
+	if (!__Terrno(ret, ioctl(fd, XNPIPEIOC_SETWMARK,
+				 XDDP_FR_MSGS * sizeof(data))))
+		goto out;
+
+	for (data = 1; data <= XDDP_FR_MSGS; data++) {
+		ret = -EINVAL;
+		/* Nothing is readable until the last message is sent. */
+		if (!__Tassert(read(fd, buf, sizeof(buf)) < 0 &&
+			       errno == EAGAIN))
+			goto out;
+		if (!__Tassert(sendto(s, &data, sizeof(data), 0,
+				      NULL, 0) == sizeof(data)))
+			goto out;
+	}
+
+	ret = -EINVAL;
+	if (!__Tassert(read(fd, buf, sizeof(buf)) == sizeof(buf)))
+		goto out;
+
+	for (n = 0, p = buf; n < XDDP_FR_MSGS; n++) {
+		ret = -EINVAL;
+		memcpy(&hdr, p, sizeof(hdr));
+		if (!__Tassert(hdr == sizeof(data)))
+			goto out;
+		memcpy(&data, p + sizeof(hdr), sizeof(data));
+		if (!__Tassert(data == n + 1))
+			goto out;
+		p += XDDP_FR_FRAMESZ;
+	}
+
+	/* A message which does not fit in whole is not truncated. */
+	if (!__Terrno(ret, ioctl(fd, XNPIPEIOC_SETWMARK, 0)))
+		goto out;
+	if (!__Tassert(sendto(s, &data, sizeof(data), 0,
+			      NULL, 0) == sizeof(data))) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if (!__Tassert(read(fd, buf, XDDP_FR_FRAMESZ - 1) < 0 &&
+		       errno == EMSGSIZE))
+		ret = -EINVAL;
+out:
+	if (fd >= 0)
+		close(fd);
+	close(s);
+
+	return ret;
+}
+
 static int run_xddp(struct smokey_test *t, int argc, char *const argv[])
 {
 	struct sched_param param = { .sched_priority = 42 };
 	pthread_attr_t rtattr, regattr;
-	int s;
+	int s, ret;
 
 	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
 	if (s < 0) {
@@ -260,5 +458,9 @@ static int run_xddp(struct smokey_test *t, int argc, char *const argv[])
 	pthread_join(rt1, NULL);
 	pthread_join(nrt, NULL);
 
-	return 0;
+	ret = run_zerocopy();
+	if (ret)
+		return ret;
+
+	return run_framed();
 }
@@ -29,6 +29,7 @@
 #include <semaphore.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <smokey/smokey.h>
@@ -47,6 +48,20 @@ smokey_test_plugin(spi_transfer,
    "\tlatency"
 );
 
+smokey_test_plugin(spi_transfer_list,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_STRING(device),
+			   SMOKEY_INT(speed),
+			   SMOKEY_INT(xfers),
+			   SMOKEY_BOOL(loopback),
+		   ),
+   "Run a list of SPI transfers in a single request.\n"
+   "\tdevice=<device-path>\n"
+   "\tspeed=<speed-hz>\n"
+   "\txfers=<transfer-count>\n"
+   "\tloopback (check input matches output)"
+);
+
 #define ONE_BILLION	1000000000
 #define TEN_MILLIONS	10000000
 
@@ -421,6 +436,118 @@ static int run_spi_transfer(struct smokey_test *t, int argc, char *const argv[])
 	return 0;
 }
 
+static int run_spi_transfer_list(struct smokey_test *t,
+				 int argc, char *const argv[])
+{
+	int fd, ret, speed_hz = 1000000, nr_xfers = 4, loopback = 0, n;
+	struct rtdm_spi_xfer xfers[SPI_XFER_LIST_MAX];
+	struct rtdm_spi_xfer_list list;
+	struct timespec start, now;
+	struct rtdm_spi_config config;
+	struct rtdm_spi_iobufs iobufs;
+	const char *device = NULL;
+	struct sched_param param;
+	unsigned char *ip, *op;
+	void *p;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(spi_transfer_list, speed))
+		speed_hz = SMOKEY_ARG_INT(spi_transfer_list, speed);
+
+	if (SMOKEY_ARG_ISSET(spi_transfer_list, xfers))
+		nr_xfers = SMOKEY_ARG_INT(spi_transfer_list, xfers);
+
+	if (SMOKEY_ARG_ISSET(spi_transfer_list, loopback))
+		loopback = SMOKEY_ARG_BOOL(spi_transfer_list, loopback);
+
+	if (nr_xfers <= 0 || nr_xfers > SPI_XFER_LIST_MAX) {
+		warning("invalid xfers= specification");
+		return -EINVAL;
+	}
+
+	if (!SMOKEY_ARG_ISSET(spi_transfer_list, device)) {
+		warning("missing device= specification");
+		return -EINVAL;
+	}
+
+	device = SMOKEY_ARG_STRING(spi_transfer_list, device);
+	fd = open(device, O_RDWR);
+	if (fd < 0) {
+		ret = -errno;
+		warning("cannot open device %s [%s]",
+			device, symerror(ret));
+		return ret;
+	}
+
+	iobufs.io_len = TRANSFER_SIZE * nr_xfers;
+	if (!__Terrno(ret, ioctl(fd, SPI_RTIOC_SET_IOBUFS, &iobufs)))
+		return ret;
+
+	p = mmap(NULL, iobufs.map_len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (!__Fassert(p == MAP_FAILED))
+		return -EINVAL;
+
+	ip = p + iobufs.i_offset;
+	op = p + iobufs.o_offset;
+
+	config.mode = SPI_MODE_0;
+	config.bits_per_word = 8;
+	config.speed_hz = speed_hz;
+	if (!__Terrno(ret, ioctl(fd, SPI_RTIOC_SET_CONFIG, &config)))
+		return ret;
+
+	/*
+	 * Split the I/O areas in as many back-to-back transfers,
+	 * toggling CS between them. Every other transfer runs at
+	 * half the configured speed.
+	 */
+	for (n = 0; n < nr_xfers; n++) {
+		memset(&xfers[n], 0, sizeof(xfers[n]));
+		xfers[n].offset = n * TRANSFER_SIZE;
+		xfers[n].len = TRANSFER_SIZE;
+		xfers[n].speed_hz = n & 1 ? speed_hz / 2 : 0;
+		xfers[n].cs_change = 1;
+	}
+
+	for (n = 0; n < TRANSFER_SIZE * nr_xfers; n++) {
+		op[n] = n + 1;
+		ip[n] = 0;
+	}
+
+	list.xfers = (unsigned long)xfers;
+	list.nr_xfers = nr_xfers;
+	list.__pad = 0;
+
+	param.sched_priority = 10;
+	if (!__T(ret, pthread_setschedparam(pthread_self(),
+				    SCHED_FIFO, &param)))
+		return ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!__Terrno(ret, ioctl(fd, SPI_RTIOC_TRANSFER_LIST, &list)))
+		return ret;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	smokey_trace("%d transfers of %zu bytes in %Ld ns",
+		     nr_xfers, TRANSFER_SIZE, diff_ts(&now, &start));
+
+	if (loopback && !__Fassert(memcmp(ip, op, TRANSFER_SIZE * nr_xfers)))
+		return -EPROTO;
+
+	/* A transfer list must not exceed the I/O areas. */
+	xfers[0].offset = iobufs.o_offset - iobufs.i_offset;
+	list.nr_xfers = 1;
+	ret = ioctl(fd, SPI_RTIOC_TRANSFER_LIST, &list);
+	if (!__Tassert(ret < 0 && errno == EINVAL))
+		return -EPROTO;
+
+	munmap(p, iobufs.map_len);
+	close(fd);
+
+	return 0;
+}
+
 int main(int argc, char *const argv[])
 {
 	struct smokey_test *t;
@@ -34,6 +34,8 @@
 #include <semaphore.h>
 #include <setjmp.h>
 #include <getopt.h>
+#include <sys/utsname.h>
+#include <boilerplate/histogram.h>
 #include <asm/xenomai/features.h>
 #include <asm/xenomai/uapi/fptest.h>
 #include <cobalt/trace.h>
@@ -92,6 +94,7 @@ struct cpu_tasks {
 	unsigned capacity;
 	unsigned fd;
 	unsigned long last_switches_count;
+	struct rttst_swtest_timing *timings;
 };
 
 static sem_t sleeper_start;
@@ -102,6 +105,8 @@ static unsigned long data_lines = 21;
 static unsigned freeze_on_error;
 static int fp_features;
 static pthread_t main_tid;
+static const char *json_file;
+static int breakdown;
 
 static inline unsigned stack_size(unsigned size)
 {
@@ -280,6 +285,219 @@ static void display_switches_count(struct cpu_tasks *cpu, struct timespec *now)
 	cpu->last_switches_count = switches_count;
 }
 
+static void fetch_timings(struct cpu_tasks *cpu)
+{
+	struct rttst_swtest_timings arg;
+
+	arg.nr_paths = RTTST_SWTEST_NR_PATHS;
+	arg.timings = calloc(arg.nr_paths, sizeof(*arg.timings));
+	if (arg.timings == NULL)
+		return;
+
+	if (ioctl(cpu->fd, RTTST_RTIOC_SWTEST_GET_TIMINGS, &arg)) {
+		perror("ioctl(RTTST_RTIOC_SWTEST_GET_TIMINGS)");
+		free(arg.timings);
+		return;
+	}
+
+	cpu->timings = arg.timings;
+}
+
+static char *path_name(char *buf, size_t sz, unsigned path)
+{
+	static const char *endpoints[] = {
+		[RTTST_SWTEST_KERNEL] = "rtk",
+		[RTTST_SWTEST_PRIMARY] = "rtup",
+		[RTTST_SWTEST_SECONDARY] = "rtus",
+	};
+	unsigned from, to;
+
+	from = path / 2 / RTTST_SWTEST_NR_ENDPOINTS;
+	to = path / 2 % RTTST_SWTEST_NR_ENDPOINTS;
+	snprintf(buf, sz, "%s->%s%s", endpoints[from], endpoints[to],
+		 path & 1 ? "+fpu" : "");
+
+	return buf;
+}
+
+/*
+ * Rebuild the distribution of switch times in nanoseconds from the
+ * cells of the kernel histogram, which are indexed by clock ticks.
+ * The sum and sum of squares both derive from the cells, so that
+ * the mean and deviation are consistent with each other; only the
+ * extrema are exact.
+ */
+static int timing_histogram(struct histogram *h,
+			    const struct rttst_swtest_timing *t)
+{
+	unsigned cell;
+	int ret;
+
+	ret = histogram_init(h, cobalt_ticks_to_ns(t->max) + 1, 8);
+	if (ret)
+		return ret;
+
+	for (cell = 0; cell < RTTST_SWTEST_TIMING_CELLS; cell++)
+		histogram_add_n(h, cobalt_ticks_to_ns(
+				rttst_swtest_timing_base(cell)), t->cells[cell]);
+
+	h->min = cobalt_ticks_to_ns(t->min);
+	h->max = cobalt_ticks_to_ns(t->max);
+
+	return 0;
+}
+
+static void display_timings(struct cpu_tasks *cpus)
+{
+	const struct rttst_swtest_timing *t;
+	struct histogram h;
+	char buffer[32];
+	unsigned i, path;
+
+	printf("== Switch times (ns):\n");
+	printf("RSH|%12s|%16s|%12s|%8s|%8s|%8s|%8s|%8s\n",
+	       "---------cpu", "------------path", "-------count",
+	       "-----min", "-----avg", "-----p99", "---p99.9", "-----max");
+
+	for (i = 0; i < nr_cpus; i++) {
+		if (cpus[i].timings == NULL)
+			continue;
+		for (path = 0; path < RTTST_SWTEST_NR_PATHS; path++) {
+			t = &cpus[i].timings[path];
+			if (t->count == 0 || timing_histogram(&h, t))
+				continue;
+			printf("RSD|%12u|%16s|%12llu|%8lld|%8.0f|%8lld|%8lld|%8lld\n",
+			       cpus[i].index,
+			       path_name(buffer, sizeof(buffer), path),
+			       (unsigned long long)t->count,
+			       (long long)h.min, histogram_mean(&h),
+			       (long long)histogram_percentile(&h, 99.0),
+			       (long long)histogram_percentile(&h, 99.9),
+			       (long long)h.max);
+			histogram_destroy(&h);
+		}
+	}
+}
+
+static void dump_timings_json(FILE *fp, struct cpu_tasks *cpu)
+{
+	const struct rttst_swtest_timing *t;
+	struct histogram h;
+	unsigned path, n = 0;
+	char buffer[32];
+
+	fprintf(fp, ",\n      \"paths\": [");
+
+	for (path = 0; path < RTTST_SWTEST_NR_PATHS; path++) {
+		t = &cpu->timings[path];
+		if (t->count == 0 || timing_histogram(&h, t))
+			continue;
+		fprintf(fp, "%s\n        {\n"
+			"          \"path\": \"%s\",\n"
+			"          \"count\": %llu,\n"
+			"          \"min_ns\": %lld,\n"
+			"          \"avg_ns\": %.1f,\n"
+			"          \"stddev_ns\": %.1f,\n"
+			"          \"p50_ns\": %lld,\n"
+			"          \"p90_ns\": %lld,\n"
+			"          \"p99_ns\": %lld,\n"
+			"          \"p99.9_ns\": %lld,\n"
+			"          \"max_ns\": %lld\n"
+			"        }",
+			n++ ? "," : "",
+			path_name(buffer, sizeof(buffer), path),
+			(unsigned long long)t->count,
+			(long long)h.min, histogram_mean(&h),
+			histogram_stddev(&h),
+			(long long)histogram_percentile(&h, 50.0),
+			(long long)histogram_percentile(&h, 90.0),
+			(long long)histogram_percentile(&h, 99.0),
+			(long long)histogram_percentile(&h, 99.9),
+			(long long)h.max);
+		histogram_destroy(&h);
+	}
+
+	fprintf(fp, "\n      ]");
+}
+
+static FILE *json_open(void)
+{
+	struct utsname un;
+	FILE *fp;
+
+	if (strcmp(json_file, "-") == 0)
+		fp = stdout;
+	else {
+		fp = fopen(json_file, "w");
+		if (fp == NULL) {
+			fprintf(stderr, "switchtest: cannot open %s: %m\n",
+				json_file);
+			return NULL;
+		}
+	}
+
+	if (uname(&un))
+		memset(&un, 0, sizeof(un));
+
+	fprintf(fp, "{\n"
+		"  \"test\": \"switchtest\",\n"
+		"  \"version\": \"%s\",\n"
+		"  \"kernel\": \"%s\",\n"
+		"  \"machine\": \"%s\",\n",
+		CONFIG_XENO_VERSION_STRING, un.release, un.machine);
+
+	return fp;
+}
+
+static void json_close(FILE *fp)
+{
+	fprintf(fp, "}\n");
+	if (fp != stdout)
+		fclose(fp);
+}
+
+static void dump_switches_json(struct cpu_tasks *cpus, struct timespec *now)
+{
+	struct timespec diff;
+	char buffer[64];
+	unsigned i, j;
+	double dt;
+	FILE *fp;
+
+	fp = json_open();
+	if (fp == NULL)
+		return;
+
+	timespec_substract(&diff, now, &start);
+	dt = diff.tv_sec + diff.tv_nsec / 1000000000.0;
+
+	fprintf(fp, "  \"duration_s\": %.3f,\n"
+		"  \"cpus\": [\n", dt);
+
+	for (i = 0; i < nr_cpus; i++) {
+		struct cpu_tasks *cpu = &cpus[i];
+
+		fprintf(fp, "    {\n"
+			"      \"cpu\": %u,\n"
+			"      \"switches\": %lu,\n"
+			"      \"switches_per_s\": %.1f,\n"
+			"      \"threads\": [",
+			cpu->index, cpu->last_switches_count,
+			dt > 0 ? cpu->last_switches_count / dt : 0.0);
+		for (j = 0; j < cpu->tasks_count; j++)
+			fprintf(fp, "%s\"%s\"", j ? ", " : "",
+				task_name(buffer, sizeof(buffer), cpu,
+					  cpu->tasks[j].swt.index));
+		fprintf(fp, "]");
+		if (cpu->timings)
+			dump_timings_json(fp, cpu);
+		fprintf(fp, "\n    }%s\n", i < nr_cpus - 1 ? "," : "");
+	}
+
+	fprintf(fp, "  ]\n");
+	json_close(fp);
+}
+
 static int printout(const char *fmt, ...)
 {
 	va_list ap;
@@ -847,7 +1065,9 @@ static int task_create(struct cpu_tasks *cpu,
 	case RTUO:
 	case SLEEPER:
 	case SWITCHER:
-		param->swt.flags = 0;
+		/* Only used for classifying switch times. */
+		param->swt.flags =
+			param->fp & (UFPP|UFPS) ? RTTST_SWTEST_USE_FPU : 0;
 
 		err=ioctl(cpu->fd,RTTST_RTIOC_SWTEST_REGISTER_UTASK,&param->swt);
 		if (err) {
@@ -1024,7 +1244,12 @@ static void usage(FILE *fd, const char *progname)
 		"--stress <period> or -s <period> enable a stress mode where:\n"
 		"  context switches occur every <period> us;\n"
 		"  a background task uses fpu (and check) fpu all the time.\n"
-		"--freeze trace upon error.\n\n"
+		"--freeze trace upon error.\n"
+		"--json <file> or -J <file>, dump the final switch counts to "
+		"<file> in JSON\nformat.\n"
+		"--breakdown or -b, time each context switch, and report the "
+		"distribution of\nswitch times per path upon exit (ignored "
+		"in stress mode).\n\n"
 		"Each 'threadspec' specifies the characteristics of a "
 		"thread to be created:\n"
 		"threadspec = (rtk|rtup|rtus|rtuo)(_fp|_ufpp|_ufps)*[0-9]*\n"
@@ -1181,16 +1406,22 @@ int main(int argc, const char *argv[])
 			{ "really-quiet", 0, NULL, 'Q' },
 			{ "stress",  1, NULL, 's' },
 			{ "timeout", 1, NULL, 'T' },
+			{ "json",    1, NULL, 'J' },
+			{ "breakdown", 0, NULL, 'b' },
 			{ NULL,      0, NULL, 0   }
 		};
 		int i = 0;
-		int c = getopt_long(argc, (char *const *) argv, "fhl:nqQs:T:",
+		int c = getopt_long(argc, (char *const *) argv, "bfhl:nqQs:T:J:",
 				    long_options, &i);
 
 		if (c == -1)
 			break;
 
 		switch(c) {
+		case 'b':
+			breakdown = 1;
+			break;
+
 		case 'f':
 			freeze_on_error = 1;
 			break;
@@ -1223,6 +1454,10 @@ int main(int argc, const char *argv[])
 			alarm(xatoul(optarg));
 			break;
 
+		case 'J':
+			json_file = optarg;
+			break;
+
 		case '?':
 			usage(stderr, progname);
 			fprintf(stderr, "%s: Invalid option.\n", argv[optind-1]);
@@ -1292,6 +1527,7 @@ int main(int argc, const char *argv[])
 		cpus[n].tasks_count = 1;
 		cpus[n].tasks = (struct task_params *) malloc(size);
 		cpus[n].last_switches_count = 0;
+		cpus[n].timings = NULL;
 
 		if (!cpus[n].tasks) {
 			perror("malloc");
@@ -1417,6 +1653,12 @@ int main(int argc, const char *argv[])
 			goto failure;
 		}
 
+		if (breakdown && !stress &&
+		    ioctl(cpu->fd, RTTST_RTIOC_SWTEST_SET_TIMING, 1)) {
+			perror("ioctl(RTTST_RTIOC_SWTEST_SET_TIMING)");
+			goto failure;
+		}
+
 		for (j = 0; j < cpu->tasks_count + !!stress; j++) {
 			struct task_params *param = &cpu->tasks[j];
 			if (task_create(cpu, param, &rt_attr)) {
@@ -1479,10 +1721,27 @@ int main(int argc, const char *argv[])
 				quiet = 0;
 			display_switches_count(cpu, &now);
 
+			if (breakdown && !stress)
+				fetch_timings(cpu);
+
 			/* Kill the kernel-space tasks. */
 			close(cpu->fd);
 		}
-		free(cpu->tasks);
+	}
+
+	if (breakdown && quiet < 2 && status == EXIT_SUCCESS)
+		display_timings(cpus);
+
+	if (json_file && status == EXIT_SUCCESS) {
+		struct timespec now;
+
+		clock_gettime(CLOCK_REALTIME, &now);
+		dump_switches_json(cpus, &now);
+	}
+
+	for_each_cpu_index(i, n) {
+		free(cpus[n].timings);
+		free(cpus[n].tasks);
 	}
 	free(cpus);
 	__STD(sem_destroy(&sleeper_start));
@@ -0,0 +1,198 @@
+/***
+ *
+ *  tools/rtcapdump.c
+ *  Dumps the RTcap capture ring in pcap format
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <rtcap_chrdev.h>
+
+
+#define PCAP_MAGIC_NSEC     0xa1b23c4d
+#define PCAP_LINKTYPE_EN10MB 1
+
+struct pcap_file_header {
+    __u32 magic;
+    __u16 version_major;
+    __u16 version_minor;
+    __s32 thiszone;
+    __u32 sigfigs;
+    __u32 snaplen;
+    __u32 linktype;
+};
+
+
+static volatile int terminated;
+
+
+static void help(void)
+{
+    fprintf(stderr, "Usage:\n"
+        "\trtcapdump [-w file] [-c count] [-i ifindex] [-p poll_interval_ms]\n"
+        );
+
+    exit(1);
+}
+
+
+
+static int getintopt(int argc, int pos, char *argv[], int min)
+{
+    int result;
+
+
+    if (pos >= argc)
+        help();
+    if ((sscanf(argv[pos], "%u", &result) != 1) || (result < min)) {
+        fprintf(stderr, "invalid parameter: %s %s\n", argv[pos-1], argv[pos]);
+        exit(1);
+    }
+
+    return result;
+}
+
+
+
+static void terminate(int signal)
+{
+    terminated = 1;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    const char              rtcap_dev[] = "/dev/rtcap";
+    struct rtcap_ring_info  info;
+    struct pcap_file_header fhdr;
+    volatile struct rtcap_ring *ring;
+    struct rtcap_slot       *slot;
+    struct timespec         delay;
+    const char              *filename = NULL;
+    FILE                    *out = stdout;
+    unsigned int            count = 0;
+    unsigned int            captured = 0;
+    int                     ifindex = -1;
+    int                     interval = 10;
+    char                    *map;
+    __u32                   tail;
+    int                     f;
+    int                     i;
+
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0) {
+            if (++i >= argc)
+                help();
+            filename = argv[i];
+        } else if (strcmp(argv[i], "-c") == 0)
+            count = getintopt(argc, ++i, argv, 1);
+        else if (strcmp(argv[i], "-i") == 0)
+            ifindex = getintopt(argc, ++i, argv, 0);
+        else if (strcmp(argv[i], "-p") == 0)
+            interval = getintopt(argc, ++i, argv, 1);
+        else
+            help();
+    }
+
+    f = open(rtcap_dev, O_RDWR);
+    if (f < 0) {
+        perror(rtcap_dev);
+        exit(1);
+    }
+
+    if (ioctl(f, RTCAP_IOC_INFO, &info) < 0) {
+        perror("ioctl");
+        exit(1);
+    }
+
+    map = mmap(NULL, info.map_len, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    ring = (volatile struct rtcap_ring *)map;
+
+    if (filename) {
+        out = fopen(filename, "w");
+        if (!out) {
+            perror(filename);
+            exit(1);
+        }
+    }
+
+    memset(&fhdr, 0, sizeof(fhdr));
+    fhdr.magic         = PCAP_MAGIC_NSEC;
+    fhdr.version_major = 2;
+    fhdr.version_minor = 4;
+    fhdr.snaplen       = info.snaplen;
+    fhdr.linktype      = PCAP_LINKTYPE_EN10MB;
+    fwrite(&fhdr, sizeof(fhdr), 1, out);
+
+    signal(SIGINT, terminate);
+    signal(SIGTERM, terminate);
+
+    delay.tv_sec  = interval / 1000;
+    delay.tv_nsec = (interval % 1000) * 1000000;
+
+    tail = ring->tail;
+    while (!terminated && (count == 0 || captured < count)) {
+        if (tail == ring->head) {
+            fflush(out);
+            nanosleep(&delay, NULL);
+            continue;
+        }
+
+        /* read the slot only after having seen the head moving */
+        __sync_synchronize();
+
+        slot = (struct rtcap_slot *)(map + info.data_offset +
+            (tail & (info.nr_slots - 1)) * info.slot_size);
+
+        if ((ifindex < 0) || (slot->ifindex == ifindex)) {
+            fwrite(&slot->hdr, sizeof(slot->hdr), 1, out);
+            fwrite(slot + 1, slot->hdr.caplen, 1, out);
+            captured++;
+        }
+
+        /* hand the slot back to the kernel */
+        __sync_synchronize();
+        ring->tail = ++tail;
+    }
+
+    fflush(out);
+    fprintf(stderr, "%u frames captured, %u dropped by the kernel\n",
+            captured, ring->dropped);
+
+    if (out != stdout)
+        fclose(out);
+    munmap(map, info.map_len);
+    close(f);
+
+    return 0;
+}
@@ -16,37 +16,136 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
  * 02111-1307, USA.
  */
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <string.h>
 #include <stdio.h>
 #include <error.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <linux/types.h>
+#include <boilerplate/atomic.h>
+#include <rtdm/uapi/rtdm.h>
+#include <cobalt/uapi/kernel/heap.h>
+#include <cobalt/uapi/kernel/stat.h>
 
 #define PROC_ACCT  "/proc/xenomai/sched/acct"
 #define PROC_PID  "/proc/%d/cmdline"
+#define STAT_DEV  "/dev/rtdm/" COBALT_MEMDEV_STAT
 
 #define ACCT_FMT_1  "%u %d %lu %lu %lu %lx %Lu %Lu %Lu"
 #define ACCT_FMT_2  ACCT_FMT_1 " %[^\n]"
 #define ACCT_NFMT_1 9
 #define ACCT_NFMT_2 10
 
-int main(int argc, char *argv[])
+static void print_thread(int pid, const char *name,
+			 unsigned long long exectime_total)
+{
+	char cmdpath[sizeof(PROC_PID) + 32], cmdbuf[BUFSIZ];
+	unsigned int hr, min, msec, usec;
+	unsigned long long v;
+	unsigned long sec;
+	FILE *cmdfp;
+
+	snprintf(cmdpath, sizeof(cmdpath), PROC_PID, pid);
+	cmdfp = fopen(cmdpath, "r");
+
+	if (cmdfp == NULL ||
+	    fgets(cmdbuf, sizeof(cmdbuf), cmdfp) == NULL)
+		strcpy(cmdbuf, "-");
+
+	if (cmdfp)
+		fclose(cmdfp);
+
+	v = exectime_total;
+	sec = v / 1000000000LL;
+	v %= 1000000000LL;
+	msec = v / 1000000LL;
+	v %= 1000000LL;
+	usec = v / 1000LL;
+	hr = sec / (60 * 60);
+	sec %= (60 * 60);
+	min = sec / 60;
+	sec %= 60;
+	printf("%-6d %.3u:%.2u:%.2lu.%.3u,%.3u   %-24s %s\n",
+	       pid,
+	       hr, min, sec, msec, usec,
+	       name, cmdbuf);
+}
+
+/*
+ * Sample the binary statistics area exported by the core, which
+ * does not require the nklock to be held while the thread list is
+ * walked. Returns zero if the area is not available, e.g. with
+ * older kernels.
+ */
+static int dump_statarea(void)
 {
-	char cmdpath[sizeof(PROC_PID) + 32], cmdbuf[BUFSIZ], acctbuf[BUFSIZ], name[64];
-	unsigned long ssw, csw, pf, state, sec;
+	struct cobalt_memdev_stat statbuf;
+	struct xnstat_record rec, *p;
+	unsigned long long ns;
+	struct xnstat_area *a;
+	urwstate_t tmp;
+	unsigned int n;
+	int fd, ret;
+
+	fd = open(STAT_DEV, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	ret = ioctl(fd, MEMDEV_RTIOC_STAT, &statbuf);
+	if (ret) {
+		close(fd);
+		return 0;
+	}
+
+	a = mmap(NULL, statbuf.size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (a == MAP_FAILED)
+		return 0;
+
+	if (a->magic != XNSTAT_AREA_MAGIC ||
+	    a->record_size != sizeof(rec) || a->clock_freq == 0) {
+		munmap(a, statbuf.size);
+		return 0;
+	}
+
+	for (n = 0; n < a->nr_records; n++) {
+		p = a->records + n;
+		unsynced_read_block(&tmp, &p->lock)
+			rec = *p;
+		if (rec.serial == 0)
+			continue;
+		rec.name[sizeof(rec.name) - 1] = '\0';
+		ns = rec.exectime / a->clock_freq * 1000000000ULL +
+			rec.exectime % a->clock_freq * 1000000000ULL /
+			a->clock_freq;
+		print_thread(rec.pid, rec.name, ns);
+	}
+
+	munmap(a, statbuf.size);
+
+	return 1;
+}
+
+static void dump_acct(void)
+{
+	unsigned long ssw, csw, pf, state;
 	unsigned long long account_period,
-		exectime_period, exectime_total, v;
-	unsigned int cpu, hr, min, msec, usec;
-	FILE *acctfp, *cmdfp;
+		exectime_period, exectime_total;
+	char acctbuf[BUFSIZ], name[64];
+	unsigned int cpu;
+	FILE *acctfp;
 	int pid;
 
 	acctfp = fopen(PROC_ACCT, "r");
 	if (acctfp == NULL)
 		error(1, errno, "cannot open %s\n", PROC_ACCT);
 
-	printf("%-6s %-17s   %-24s %s\n\n",
-	       "PID", "TIME", "THREAD", "CMD");
-
 	while (fgets(acctbuf, sizeof(acctbuf), acctfp) != NULL) {
 		if (sscanf(acctbuf, ACCT_FMT_2,
 		      &cpu, &pid, &ssw, &csw, &pf, &state,
@@ -61,31 +160,19 @@ int main(int argc, char *argv[])
 			}
 		}
 
-		snprintf(cmdpath, sizeof(cmdpath), PROC_PID, pid);
-		cmdfp = fopen(cmdpath, "r");
-
-		if (cmdfp == NULL ||
-		    fgets(cmdbuf, sizeof(cmdbuf), cmdfp) == NULL)
-			strcpy(cmdbuf, "-");
-
-		if (cmdfp)
-			fclose(cmdfp);
-
-		v = exectime_total;
-		sec = v / 1000000000LL;
-		v %= 1000000000LL;
-		msec = v / 1000000LL;
-		v %= 1000000LL;
-		usec = v / 1000LL;
-		hr = sec / (60 * 60);
-		sec %= (60 * 60);
-		min = sec / 60;
-		sec %= 60;
-		printf("%-6d %.3u:%.2u:%.2lu.%.3u,%.3u   %-24s %s\n",
-		       pid,
-		       hr, min, sec, msec, usec,
-		       name, cmdbuf);
+		print_thread(pid, name, exectime_total);
 	}
 
+	fclose(acctfp);
+}
+
+int main(int argc, char *argv[])
+{
+	printf("%-6s %-17s   %-24s %s\n\n",
+	       "PID", "TIME", "THREAD", "CMD");
+
+	if (!dump_statarea())
+		dump_acct();
+
 	exit(0);
 }